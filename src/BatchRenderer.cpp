@@ -0,0 +1,184 @@
+#include "BatchRenderer.h"
+#include "Utils.h"
+
+//==============================================================================
+class BatchRenderer::Worker
+{
+public:
+    explicit Worker (const Options& o) : options (o), numSamples ((int)(o.sampleRate * o.length))
+    {
+    }
+
+    size_t numRendered = 0;
+    juce::StringArray failed;
+    double busyTime = 0;
+
+    void render (const juce::File& file)
+    {
+        auto start = juce::Time::getMillisecondCounterHiRes();
+
+        if (renderPatch (file))
+            ++numRendered;
+        else
+            failed.add (file.getFileName());
+
+        busyTime += (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0;
+    }
+
+private:
+    const Options& options;
+    int numSamples;
+
+    std::unique_ptr<OfflineEngine> engine;
+    juce::AudioBuffer<float> mix, stems;
+    juce::WavAudioFormat format;
+
+    bool renderPatch (const juce::File& file)
+    {
+        auto state = loadPatch (file);
+        if (!state.isValid())
+            return false;
+
+        auto patch = readPatch (state);
+        if (patch.numChains == 0)
+            return false;
+
+        // made on the worker thread, so its memory is close to the core that uses it
+        if (engine == nullptr || engine->getNumChains() != patch.numChains)
+            engine = std::make_unique<OfflineEngine> (patch.numChains);
+
+        mix.setSize (2, numSamples, false, false, true);
+        mix.clear();
+        if (options.stems)
+            stems.setSize ((int)patch.numChains * 2, numSamples, false, false, true);
+
+        // the random waves are drawn from the name of the patch, so a patch renders the same whatever
+        // worker gets it and whatever it rendered before
+        engine->load (patch, options.sampleRate, (std::uint64_t)file.getFileName().hashCode64());
+        engine->render (mix, options.stems ? &stems : nullptr, 0, numSamples);
+
+        auto name = file.getFileNameWithoutExtension();
+        if (!write (mix, 0, name))
+            return false;
+
+        if (options.stems)
+            for (size_t c = 0; c < patch.numChains; ++c)
+                if (!write (stems, (int)c * 2, name + "_ch" + juce::String (c + 1)))
+                    return false;
+
+        return true;
+    }
+
+    bool write (const juce::AudioBuffer<float>& buffer, int firstChannel, const juce::String& name)
+    {
+        auto file = options.destination.getChildFile (name).withFileExtension (format.getFileExtensions()[0]);
+
+        // an output stream appends to what's there
+        if (!file.deleteFile())
+            return false;
+
+        auto stream = file.createOutputStream();
+        if (stream == nullptr)
+            return false;
+
+        std::unique_ptr<juce::AudioFormatWriter> writer (
+            format.createWriterFor (stream.get(), options.sampleRate, 2, batch_render.bit_depth, {}, 0));
+
+        // the writer owns the stream once it's created
+        if (writer == nullptr)
+            return false;
+
+        stream.release();
+        const float* channels[] = {buffer.getReadPointer (firstChannel), buffer.getReadPointer (firstChannel + 1)};
+        return writer->writeFromFloatArrays (channels, 2, buffer.getNumSamples());
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Worker)
+};
+
+//==============================================================================
+BatchRenderer::BatchRenderer (const Options& o) : options (o)
+{
+    patches = options.source.findChildFiles (juce::File::findFiles, false, "*.xml");
+    patches.sort();
+}
+
+const juce::Array<juce::File>& BatchRenderer::getPatches() const noexcept
+{
+    return patches;
+}
+
+BatchRenderer::Report BatchRenderer::run (size_t numWorkers)
+{
+    Report report;
+    report.numWorkers = numWorkers > 0 ? numWorkers : (size_t)juce::SystemStats::getNumCpus();
+
+    if (!options.destination.createDirectory())
+    {
+        for (auto& patch : patches)
+            report.failed.add (patch.getFileName());
+        return report;
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (size_t i = 0; i < report.numWorkers; ++i)
+        workers.push_back (std::make_unique<Worker> (options));
+
+    juce::ThreadPool pool ((int)report.numWorkers);
+    std::atomic<int> next{0};
+    std::atomic<size_t> running{workers.size()};
+    juce::WaitableEvent done;
+
+    auto start = juce::Time::getMillisecondCounterHiRes();
+
+    for (auto& w : workers)
+    {
+        pool.addJob (
+            [&, worker = w.get()]
+            {
+                for (auto i = next++; i < patches.size(); i = next++)
+                    worker->render (patches.getReference (i));
+
+                if (--running == 0)
+                    done.signal();
+            });
+    }
+
+    done.wait();
+    report.wallTime = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0;
+
+    for (auto& w : workers)
+    {
+        report.numRendered += w->numRendered;
+        report.failed.addArray (w->failed);
+        report.busyTime += w->busyTime;
+    }
+
+    report.audioTime = (double)report.numRendered * options.length;
+    return report;
+}
+
+juce::String BatchRenderer::describe (const Report& report, const Report* single)
+{
+    juce::String s;
+    s << report.numRendered << " patches rendered, " << report.failed.size() << " failed, on " << report.numWorkers
+      << (report.numWorkers == 1 ? " thread" : " threads") << juce::newLine;
+    s << "wall time " << juce::String (report.wallTime, 2) << " s, "
+      << juce::String (report.numRendered / juce::jmax (report.wallTime, 1e-9), 1) << " patches/s" << juce::newLine;
+
+    // how much faster than real time one core renders, what the number of cores multiplies
+    s << "per core " << juce::String (report.audioTime / juce::jmax (report.busyTime, 1e-9), 1)
+      << "x real time" << juce::newLine;
+
+    // without a baseline there's only the busy time, which assumes a thread renders as fast alone as
+    // next to the others. Caches and memory bandwidth are shared, so that's an upper bound
+    if (single != nullptr)
+        s << "speedup " << juce::String (single->wallTime / juce::jmax (report.wallTime, 1e-9), 2)
+          << "x, measured against the single threaded run (" << juce::String (single->wallTime, 2) << " s)";
+    else
+        s << "estimated speedup (not measured) "
+          << juce::String (report.busyTime / juce::jmax (report.wallTime, 1e-9), 2)
+          << "x, busy time of the threads over wall time, an upper bound. --baseline measures it";
+
+    return s;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Constants.h"
+#include "OfflineEngine.h"
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/** Renders every saved patch of a folder to WAV files, to build sample libraries offline.
+
+    Every worker owns an OfflineEngine, its buffers and its audio format, and takes the next patch
+    from a shared counter, which is all the workers share. A worker reads, renders and writes a
+    patch on its own and only rebuilds its engine when a patch has another number of chains.
+*/
+class BatchRenderer
+{
+public:
+    struct Options
+    {
+        juce::File source;      // the folder of saved patches (*.xml)
+        juce::File destination; // where the audio files go, made if needed
+        double sampleRate = batch_render.sample_rate;
+        double length = batch_render.length; // seconds per patch
+        bool stems = false;                  // one more file per chain
+    };
+
+    struct Report
+    {
+        size_t numWorkers = 0;
+        size_t numRendered = 0;
+        juce::StringArray failed; // the patches that couldn't be read or written
+        double wallTime = 0;      // seconds, the whole batch
+        double busyTime = 0;      // seconds, the time every worker spent on patches, summed
+        double audioTime = 0;     // seconds of audio rendered, the stems not counted
+    };
+
+    explicit BatchRenderer (const Options& options);
+
+    /** The patches found in the source folder, sorted by name */
+    const juce::Array<juce::File>& getPatches() const noexcept;
+
+    /** Renders every patch on numWorkers threads (0 for one per core) and blocks until they're done */
+    Report run (size_t numWorkers);
+
+    /** The times and the throughput of a run, and its speedup against single if there is one */
+    static juce::String describe (const Report& report, const Report* single);
+
+private:
+    class Worker;
+
+    Options options;
+    juce::Array<juce::File> patches;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BatchRenderer)
+};
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "Delay.h"
+#include "Filter.h"
 #include "Osc.h"
+#include "Reverb.h"
 #include <JuceHeader.h>
 
 enum ProcIdx
@@ -9,14 +11,27 @@ enum ProcIdx
     OSC,
     FILT,
     DEL,
+    REV,
     CHAN_GAIN,
     MASTER_GAIN
 };
 
 using _Gain = juce::dsp::Gain<float>;
 using _OSC = Osc<float>;
-using _FILT = juce::dsp::LadderFilter<float>;
+using _FILT = Filter<float>; // lanes of a FilterBank shared by all the chains
 using _DEL = Delay<float, 2>;
+using _REV = FdnReverb<float, 8>;
 
-// signal flow: ... ---> Gain (channel) ---> Gain (master) ----> out
-using Chain = juce::dsp::ProcessorChain<_OSC, _FILT, _DEL, _Gain, _Gain>;
+// the processors of a chain, the order they run in and where they send to is set by a RoutingGraph
+// default signal flow: ... ---> Gain (channel) ---> Gain (master) ----> out
+using Chain = juce::dsp::ProcessorChain<_OSC, _FILT, _DEL, _REV, _Gain, _Gain>;
+
+template <typename Type>
+class Lfo;
+
+// what the parameters of one chain are applied to, see param_specs
+struct ParamTarget
+{
+    Chain& chain;
+    Lfo<float>& lfo;
+};
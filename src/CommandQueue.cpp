@@ -0,0 +1,51 @@
+#include "CommandQueue.h"
+
+//==============================================================================
+template <typename Type>
+SpscQueue<Type>::SpscQueue (size_t minCapacity)
+    : buffer ((size_t)juce::nextPowerOfTwo ((int)juce::jmax (minCapacity, (size_t)2))), mask (buffer.size() - 1)
+{
+}
+
+template <typename Type>
+bool SpscQueue<Type>::push (const Type& item) noexcept
+{
+    auto t = tail.load (std::memory_order_relaxed);
+
+    if (t - head.load (std::memory_order_acquire) == buffer.size())
+        return false;
+
+    buffer[t & mask] = item;
+    tail.store (t + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename Type>
+bool SpscQueue<Type>::pop (Type& item) noexcept
+{
+    auto h = head.load (std::memory_order_relaxed);
+
+    if (h == tail.load (std::memory_order_acquire))
+        return false;
+
+    item = buffer[h & mask];
+    head.store (h + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename Type>
+size_t SpscQueue<Type>::getCapacity() const noexcept
+{
+    return buffer.size();
+}
+
+template <typename Type>
+size_t SpscQueue<Type>::getNumReady() const noexcept
+{
+    // head first, it can only catch up with the tail read after it
+    auto h = head.load (std::memory_order_acquire);
+    return tail.load (std::memory_order_acquire) - h;
+}
+
+template class SpscQueue<ParamCommand>;
+template class SpscQueue<Patch*>;
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Parameters.h"
+#include <JuceHeader.h>
+#include <atomic>
+#include <vector>
+
+/** Wait-free single producer / single consumer ring.
+
+    One thread pushes, another one pops (the audio thread, for the ParamCommands at the start of every
+    block). Both ends only do one acquire load and one release store, and the storage is allocated up front.
+*/
+template <typename Type>
+class SpscQueue
+{
+public:
+    /** The capacity is rounded up to a power of two */
+    explicit SpscQueue (size_t minCapacity);
+
+    /** Producer side, false if the queue is full */
+    bool push (const Type& item) noexcept;
+
+    /** Consumer side, false if the queue is empty */
+    bool pop (Type& item) noexcept;
+
+    size_t getCapacity() const noexcept;
+    /** Exact on either side, a snapshot anywhere else */
+    size_t getNumReady() const noexcept;
+
+private:
+    std::vector<Type> buffer;
+    size_t mask;
+
+    // each index on its own cache line, so the two threads don't share one
+    alignas (64) std::atomic<size_t> head{0}; // next slot to read, written by the consumer
+    alignas (64) std::atomic<size_t> tail{0}; // next slot to write, written by the producer
+
+    JUCE_DECLARE_NON_COPYABLE (SpscQueue)
+};
+
+// parameter changes, message thread -> audio thread
+using CommandQueue = SpscQueue<ParamCommand>;
+// whole patches, handed over and back by pointer
+using PatchQueue = SpscQueue<Patch*>;
@@ -1,6 +1,98 @@
 #include "ComponentWrappers.h"
 #include "Constants.h"
 
+//==============================================================================
+class GuiRefresher::Source : public juce::Value::ValueSource, private juce::ValueTree::Listener
+{
+public:
+    Source (const juce::ValueTree& v, const juce::Identifier& prop, juce::UndoManager* um)
+        : tree (v), propertie (prop), undoManager (um), cached (v[prop])
+    {
+        tree.addListener (this);
+    }
+
+    ~Source() override
+    {
+        tree.removeListener (this);
+        refresher->remove (this);
+    }
+
+    juce::var getValue() const override
+    {
+        return cached;
+    }
+
+    void setValue (const juce::var& newValue) override
+    {
+        // from the control, which already shows it
+        cached = newValue;
+        tree.setProperty (propertie, newValue, undoManager);
+    }
+
+    void refresh()
+    {
+        queued = false;
+
+        auto value = tree[propertie];
+        if (value == cached)
+            return;
+
+        cached = value;
+        sendChangeMessage (true);
+    }
+
+private:
+    juce::ValueTree tree;
+    juce::Identifier propertie;
+    juce::UndoManager* undoManager;
+    juce::var cached;
+    bool queued = false;
+    juce::SharedResourcePointer<GuiRefresher> refresher;
+
+    void valueTreePropertyChanged (juce::ValueTree& v, const juce::Identifier& prop) override
+    {
+        // the listener hears the children of the node too
+        if (queued || prop != propertie || v != tree)
+            return;
+
+        queued = true;
+        refresher->markDirty (this);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Source)
+};
+
+GuiRefresher::GuiRefresher()
+{
+    startTimerHz (def_params.gui_refresh_rate);
+}
+
+void GuiRefresher::markDirty (Source* source)
+{
+    dirty.push_back (source);
+}
+
+void GuiRefresher::remove (Source* source)
+{
+    std::replace (dirty.begin(), dirty.end(), source, static_cast<Source*> (nullptr));
+}
+
+void GuiRefresher::timerCallback()
+{
+    // a refresh can mark more, they're taken in the same frame
+    for (size_t i = 0; i < dirty.size(); ++i)
+        if (dirty[i] != nullptr)
+            dirty[i]->refresh();
+
+    dirty.clear();
+}
+
+juce::Value getCoalescedValue (const juce::ValueTree& v, const juce::Identifier& prop, juce::UndoManager* um)
+{
+    return juce::Value (new GuiRefresher::Source (v, prop, um));
+}
+
+//==============================================================================
 BaseComp::BaseComp (const juce::Identifier& prop, const juce::String& labelText)
     : propertie (prop), label ("", labelText)
 {
@@ -24,7 +116,7 @@ SliderComp::SliderComp (juce::ValueTree& v, juce::UndoManager* um, const juce::I
     label.attachToComponent (&slider, false);
     label.setJustificationType (juce::Justification::centredBottom);
 
-    slider.getValueObject().referTo (v.getPropertyAsValue (prop, um));
+    slider.getValueObject().referTo (getCoalescedValue (v, prop, um));
     // slider.setValue (v[prop]);
 }
 
@@ -55,7 +147,7 @@ ComboComp::ComboComp (juce::ValueTree& v, juce::UndoManager* um, const juce::Ide
 {
     comboBox.addItemList (options, 1);
 
-    comboBox.getSelectedIdAsValue().referTo (v.getPropertyAsValue (prop, um));
+    comboBox.getSelectedIdAsValue().referTo (getCoalescedValue (v, prop, um));
     // comboBox.setSelectedId (v[prop], juce::NotificationType::dontSendNotification);
 }
 
@@ -92,7 +184,7 @@ PopupComp::PopupComp (juce::ValueTree& v, juce::UndoManager* um, const juce::Ide
 
         menu.getRootMenu()->addSubMenu (sub_menu_desc, *sub_menus.getLast());
     }
-    menu.getSelectedIdAsValue().referTo (v.getPropertyAsValue (prop, um));
+    menu.getSelectedIdAsValue().referTo (getCoalescedValue (v, prop, um));
 }
 
 juce::Component* PopupComp::getComponent()
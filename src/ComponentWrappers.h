@@ -5,6 +5,34 @@
 
 using PopMenuParameters = std::vector<std::pair<juce::String, std::vector<std::pair<int, juce::String>>>>;
 
+/** Brings the controls up to date with the state at a fixed rate (def_params.gui_refresh_rate).
+
+    The controls bound with getCoalescedValue() only learn that their property changed since the
+    last frame, not about every change, so a patch that changes every parameter costs one update per
+    control per frame however fast the patches come.
+*/
+class GuiRefresher : private juce::Timer
+{
+public:
+    class Source;
+
+    GuiRefresher();
+
+    void markDirty (Source* source);
+    void remove (Source* source);
+
+private:
+    std::vector<Source*> dirty;
+
+    void timerCallback() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GuiRefresher)
+};
+
+/** A Value of a property of v for a control to refer to. Setting it writes the tree right away,
+    changes of the tree reach it on the next GuiRefresher frame */
+juce::Value getCoalescedValue (const juce::ValueTree& v, const juce::Identifier& prop, juce::UndoManager* um);
+
 // It doesn't matter which, but BaseComp need to derive from some juce class
 // it seems that without the inheritance, instances of the derived classes from BaseComp
 // are not properly deleted on app exit, and I get memory leaks
@@ -7,7 +7,21 @@
 //==============================================================================
 
 inline constexpr int NUM_INPUT_CHANNELS = 0;
-inline constexpr int NUM_OUTPUT_CHANNELS = 8;
+// the chains are mixed down to whatever outputs the device has, this is only the request
+inline constexpr int NUM_OUTPUT_CHANNELS = 2;
+
+// the number of chains is picked at launch (--chains=N)
+inline constexpr int DEFAULT_NUM_CHAINS = 4;
+inline constexpr int MAX_NUM_CHAINS = 64;
+// each GUI panel shows the chain picked by its selector
+inline constexpr int NUM_CHAIN_PANELS = 2;
+
+// the delay memory is allocated once, for the highest sample rate we support
+inline constexpr double MAX_SAMPLE_RATE = 192000;
+
+// real-time threads that share the chains with the audio thread, picked at launch (--audio-workers=N),
+// 0 runs everything on the audio thread
+inline constexpr int DEFAULT_NUM_AUDIO_WORKERS = 0;
 
 enum WaveType
 {
@@ -20,34 +34,25 @@ enum WaveType
     WSQR
 };
 
+// the parameters themselves, with their ranges and defaults, are in param_specs (Parameters.h)
 inline constexpr struct _Default_Parameters
 {
     double seq_time = 500;
+    double morph_time = 100; // ms, how long the morph position takes to glide to a new value
+    int pattern_steps = 16;
+    double pattern_time = 125;   // ms per step
+    size_t pattern_locks = 2048; // parameter locks held by a whole pattern
 
-    float master_gain = 0.5; // linear
-    float chan_gain = 0;     // dB
+    size_t lfoUpdateRate = 100; // samples
 
-    WaveType osc_wavetype = WaveType::SIN;
-    float osc_freq = 440;
-    float osc_gain = -25;
-    float osc_fm_freq = 0;
-    float osc_fm_depth = 0;
-    float osc_pan = 0;
+    float del_stereo_offset = 0.2; // right channel delay time = time + offset (seconds)
 
-    WaveType lfo_wavetype = WaveType::SIN;
-    float lfo_freq = 0;
-    float lfo_gain = 0;         // linear
-    size_t lfoUpdateRate = 100; // samples
+    double patch_fade_time = 0.003; // seconds, the output dips for this long on each side of a patch swap
 
-    int filt_type = 1; // LPF12;
-    bool filt_enabled = false;
-    float filt_cutoff = 0.1;
-    float filt_reso = 0;
-    float filt_drive = 1;
+    int gui_refresh_rate = 30; // Hz, how often the controls catch up with the state
 
-    float del_mix = 0;
-    float del_time = 0.7;
-    float del_feedback = 0.5;
+    size_t undo_steps = 256;       // randomizations and gestures that can be undone
+    size_t undo_deltas = 1 << 16; // parameter changes held by all of them together
 
 } def_params;
 
@@ -56,36 +61,84 @@ inline constexpr struct _Parameter_Limits
     // JUCE slider setter/getters are expecting double types
     // combobox expecting int's
 
-    int selector[NUM_OUTPUT_CHANNELS / 2]{1, 2, 3, 4};
+    int selector[NUM_CHAIN_PANELS]{1, 2};
 
     double seq_time_min = 50, seq_time_max = 2000;
-
-    double master_min = 0, master_max = 1;
-    double chan_min = -100.0, chan_max = 0;
+    double morph_time_min = 0, morph_time_max = 10000;
+    int pattern_steps_min = 16, pattern_steps_max = 64;
+    double pattern_time_min = 20, pattern_time_max = 2000;
 
     int C8 = 4186; // highest note on a standard 88-key piano
-    int osc_waveType_min = 1, osc_waveType_max = 7;
-    double osc_freq_min = 0, osc_freq_max = 22000;
-    double osc_gain_min = -100, osc_gain_max = 0;
-    double osc_fm_freq_min = 0, osc_fm_freq_max = 150;
-    double osc_fm_depth_min = 0, osc_fm_depth_max = 1;
-    double osc_pan_min = -1, osc_pan_max = 1;
-
-    int lfo_waveType_min = 1, lfo_waveType_max = 4;
-    double lfo_freq_min = 0, lfo_freq_max = 30;
-    double lfo_gain_min = 0, lfo_gain_max = 1;
-
-    int filt_filtType_min = 1, filt_filtType_max = 6;
-    double filt_cutoff_min = 0.1, filt_cutoff_max = 22000;
-    double filt_reso_min = 0, filt_reso_max = 1;
-    double filt_drive_min = 1, filt_drive_max = 10;
-
-    double delay_mix_min = 0, delay_mix_max = 1;
-    double delay_time_min = 0, delay_time_max = 1.79;
-    double delay_feedback_min = 0, delay_feedback_max = 1;
 
 } param_limits;
 
+// the randomizer draws num_candidates patches and keeps the one that sounds best on a short render
+inline constexpr struct _Screening
+{
+    size_t num_candidates = 8;
+    size_t num_workers = 2;
+    double sample_rate = 24000; // Hz, the snippets don't need the device rate
+    double length = 0.25;       // seconds rendered per candidate
+    double budget = 0.5;        // of the sequencer interval, to render all of them
+    size_t lookahead = 2;       // sequencer steps built ahead of the one playing
+
+    float target_rms = -20;   // dB, the closer the better
+    float silence = -60;      // dB of rms
+    float clip = 1;           // linear peak
+    float runaway = 2;        // rms growth between the second and the last quarter
+    float flatness_cost = 20; // dB of rms distance a fully flat (noise) spectrum is worth
+
+} screening;
+
+// the oscilloscope / spectrum panel
+inline constexpr struct _Scope
+{
+    int decimation = 2;      // samples averaged into one before they're sent
+    int fft_order = 11;      // of the decimated samples
+    size_t wave_size = 512;  // samples drawn, the waveform starts on a rising zero crossing
+    int fifo_size = 1 << 14; // decimated samples between the audio thread and the analyser
+    int refresh_rate = 30;   // Hz
+    float min_db = -90;
+
+} scope;
+
+// the level meters of the output panel
+inline constexpr struct _Meter
+{
+    double rms_time = 0.3; // seconds, the time constant of the rms
+    float peak_fall = 20;  // dB per second, once a peak has been drawn
+    float min_db = -60;    // the bottom of the scale
+    int refresh_rate = 30; // Hz
+
+} meter;
+
+// disk recording, one file per recorded source
+inline constexpr struct _Recording
+{
+    int fifo_size = 1 << 17; // samples per file buffered for the writer thread, about 3 s at 44.1 kHz
+    int bit_depth = 24;
+    int flac_quality = 5;    // of the FLAC compression levels
+
+} recording;
+
+// --render, the offline renders of a folder of saved patches
+inline constexpr struct _Batch_Render
+{
+    double sample_rate = 48000; // Hz
+    double length = 4;          // seconds rendered per patch
+    int bit_depth = 24;
+
+} batch_render;
+
+// what the MIDI input drives, notes transpose every oscillator from its own frequency
+inline constexpr struct _Midi_Map
+{
+    int root_note = 69; // plays the oscillators at the frequency they're set to
+    int cc_morph = 1;   // mod wheel, the A / B position
+    int cc_master = 7;  // volume, the master gain
+
+} midi_map;
+
 inline constexpr struct _Gui_Sizes
 {
     int yGap_between_components = 10;
@@ -106,29 +159,24 @@ DECLARE_ID (ROOT)
 
 DECLARE_ID (OUTPUT_GAIN)
 DECLARE_ID (master)
-DECLARE_ID (CHAN1)
-DECLARE_ID (CHAN2)
-DECLARE_ID (CHAN3)
-DECLARE_ID (CHAN4)
 
 DECLARE_ID (SEQUENCER)
 DECLARE_ID (SEQ1)
 
+DECLARE_ID (MORPH)
+DECLARE_ID (position)
+
+DECLARE_ID (PATTERN)
+DECLARE_ID (steps)
+DECLARE_ID (rec)
+
 DECLARE_ID (OSC_GUI)
 DECLARE_ID (selector)
 DECLARE_ID (OSC)
-DECLARE_ID (OSC1)
-DECLARE_ID (OSC2)
-DECLARE_ID (OSC3)
-DECLARE_ID (OSC4)
 
 DECLARE_ID (LFO_GUI)
 DECLARE_ID (route)
 DECLARE_ID (LFO)
-DECLARE_ID (LFO1)
-DECLARE_ID (LFO2)
-DECLARE_ID (LFO3)
-DECLARE_ID (LFO4)
 
 DECLARE_ID (waveType)
 DECLARE_ID (freq)
@@ -139,10 +187,6 @@ DECLARE_ID (pan)
 
 DECLARE_ID (FILT_GUI)
 DECLARE_ID (FILT)
-DECLARE_ID (FILT1)
-DECLARE_ID (FILT2)
-DECLARE_ID (FILT3)
-DECLARE_ID (FILT4)
 DECLARE_ID (enabled)
 DECLARE_ID (filtType)
 DECLARE_ID (cutOff)
@@ -151,29 +195,55 @@ DECLARE_ID (drive)
 
 DECLARE_ID (DELAY_GUI)
 DECLARE_ID (DELAY)
-DECLARE_ID (DELAY1)
-DECLARE_ID (DELAY2)
-DECLARE_ID (DELAY3)
-DECLARE_ID (DELAY4)
 DECLARE_ID (mix)
 DECLARE_ID (time)
 DECLARE_ID (feedback)
+DECLARE_ID (damping)
+DECLARE_ID (lowCut)
+DECLARE_ID (taps)
+DECLARE_ID (spread)
+DECLARE_ID (pingPong)
+
+DECLARE_ID (REVERB_GUI)
+DECLARE_ID (REVERB)
+DECLARE_ID (size)
+DECLARE_ID (decay)
+
+DECLARE_ID (ROUTING)
+DECLARE_ID (NODE)
+DECLARE_ID (CONNECTION)
+DECLARE_ID (kind)
+DECLARE_ID (stage)
+DECLARE_ID (index)
+DECLARE_ID (source)
+DECLARE_ID (destination)
 
 #undef DECLARE_ID
 
 namespace Group
 {
-    using IdsArray = std::array<std::reference_wrapper<const juce::Identifier>, NUM_OUTPUT_CHANNELS / 2>;
+    // the ids of the per chain nodes, OSC[0] is "OSC1" and so on for any number of chains
+    struct IdsList
+    {
+        const char* prefix;
+
+        juce::Identifier operator[] (size_t i) const
+        {
+            return juce::String (prefix) + juce::String (i + 1);
+        }
+    };
+
+    const IdsList CHAN{"CHAN"};
 
-    const IdsArray CHAN = {IDs::CHAN1, IDs::CHAN2, IDs::CHAN3, IDs::CHAN4};
+    const IdsList OSC{"OSC"};
 
-    const IdsArray OSC = {IDs::OSC1, IDs::OSC2, IDs::OSC3, IDs::OSC4};
+    const IdsList LFO{"LFO"};
 
-    const IdsArray LFO = {IDs::LFO1, IDs::LFO2, IDs::LFO3, IDs::LFO4};
+    const IdsList FILT{"FILT"};
 
-    const IdsArray FILT = {IDs::FILT1, IDs::FILT2, IDs::FILT3, IDs::FILT4};
+    const IdsList DELAY{"DELAY"};
 
-    const IdsArray DELAY = {IDs::DELAY1, IDs::DELAY2, IDs::DELAY3, IDs::DELAY4};
+    const IdsList REVERB{"REVERB"};
 
 }; // namespace Group
 
@@ -1,23 +1,85 @@
 #include "Delay.h"
 #include <JuceHeader.h>
 
+// DELAY ARENA
+//==============================================================================
+template <typename Type>
+size_t DelayArena<Type>::getAlignedSize (size_t numSamples) noexcept
+{
+    constexpr size_t samplesPerLine = alignment / sizeof (Type);
+    return (numSamples + samplesPerLine - 1) / samplesPerLine * samplesPerLine;
+}
+
+template <typename Type>
+void DelayArena<Type>::allocate (size_t totalNumSamples)
+{
+    capacity = getAlignedSize (totalNumSamples);
+    used = 0;
+
+    memory.calloc (capacity * sizeof (Type) + alignment);
+    data = reinterpret_cast<Type*> (juce::snapPointerToAlignment (memory.get(), alignment));
+}
+
+/** Returns a cache-aligned slice of the arena, or nullptr if it doesn't fit */
+template <typename Type>
+Type* DelayArena<Type>::acquire (size_t numSamples) noexcept
+{
+    auto alignedSize = getAlignedSize (numSamples);
+
+    if (used + alignedSize > capacity)
+    {
+        jassertfalse; // the arena was allocated too small
+        return nullptr;
+    }
+
+    auto* slice = data + used;
+    used += alignedSize;
+    return slice;
+}
+
+template <typename Type>
+size_t DelayArena<Type>::getNumSamplesLeft() const noexcept
+{
+    return capacity - used;
+}
+
+// DELAY LINE
+//==============================================================================
+template <typename Type>
+void DelayLine<Type>::setStorage (Type* newData, size_t newCapacity) noexcept
+{
+    rawData = newData;
+    capacity = newData != nullptr ? newCapacity : 0;
+    length = 0;
+    leastRecentIndex = 0;
+}
+
+template <typename Type>
+size_t DelayLine<Type>::getCapacity() const noexcept
+{
+    return capacity;
+}
+
 template <typename Type>
 void DelayLine<Type>::clear() noexcept
 {
-    std::fill (rawData.begin(), rawData.end(), Type (0));
+    std::fill (rawData, rawData + length, Type (0));
 }
 
 template <typename Type>
 size_t DelayLine<Type>::size() const noexcept
 {
-    return rawData.size();
+    return length;
 }
 
+/** Use the first newValue samples of the storage, the storage itself is never reallocated */
 template <typename Type>
-void DelayLine<Type>::resize (size_t newValue)
+void DelayLine<Type>::resize (size_t newValue) noexcept
 {
-    rawData.resize (newValue);
+    jassert (newValue <= capacity);
+    length = juce::jmin (newValue, capacity);
     leastRecentIndex = 0;
+    clear();
 }
 
 template <typename Type>
@@ -49,41 +111,112 @@ void DelayLine<Type>::push (Type valueToAdd) noexcept
     leastRecentIndex = leastRecentIndex == 0 ? size() - 1 : leastRecentIndex - 1;
 }
 
+// DAMPING FILTER
+//==============================================================================
+template <typename Type>
+void DampingFilter<Type>::prepare (double newSampleRate) noexcept
+{
+    sampleRate = newSampleRate;
+    updateCoefficients();
+    reset();
+}
+
+template <typename Type>
+void DampingFilter<Type>::reset() noexcept
+{
+    lowPassState = Vec::expand (Type (0));
+    highPassState = Vec::expand (Type (0));
+}
+
+template <typename Type>
+void DampingFilter<Type>::setLowPassFrequency (Type newValue) noexcept
+{
+    lowPassFreq = newValue;
+    updateCoefficients();
+}
+
+template <typename Type>
+void DampingFilter<Type>::setHighPassFrequency (Type newValue) noexcept
+{
+    highPassFreq = newValue;
+    updateCoefficients();
+}
+
+template <typename Type>
+typename DampingFilter<Type>::Vec DampingFilter<Type>::processSample (Vec input) noexcept
+{
+    lowPassState += (input - lowPassState) * lowPassCoef;
+    highPassState += (lowPassState - highPassState) * highPassCoef;
+    return lowPassState - highPassState;
+}
+
+template <typename Type>
+void DampingFilter<Type>::updateCoefficients() noexcept
+{
+    auto getCoef = [this] (Type freq)
+    {
+        auto nyquist = (Type)sampleRate * Type (0.49);
+        return Type (1) - std::exp (-juce::MathConstants<Type>::twoPi * juce::jmin (freq, nyquist) / (Type)sampleRate);
+    };
+
+    // the edges of the parameter ranges leave the feedback path untouched
+    lowPassCoef = lowPassFreq >= (Type)getSpec (ParamId::DEL_DAMPING).max ? Type (1) : getCoef (lowPassFreq);
+    highPassCoef = highPassFreq <= (Type)getSpec (ParamId::DEL_LOWCUT).min ? Type (0) : getCoef (highPassFreq);
+}
+
 // DELAY CLASS
 //==============================================================================
 template <typename Type, size_t maxNumChannels>
 Delay<Type, maxNumChannels>::Delay()
 {
-    setMaxDelayTime (5.0f);
+    // the right channel runs del_stereo_offset behind the left one
+    setMaxDelayTime ((Type)getSpec (ParamId::DEL_TIME).max + def_params.del_stereo_offset);
+    setTapPattern (1, 0);
     setDelayTime (0, 0.7f);
     setWetLevel (0.8f);
     setFeedback (0.5f);
 }
 
+//==============================================================================
+/** The amount of arena samples needed to run this delay at any rate up to maxSampleRate */
+template <typename Type, size_t maxNumChannels>
+size_t Delay<Type, maxNumChannels>::getArenaSize (double maxSampleRate) const noexcept
+{
+    return maxNumChannels * DelayArena<Type>::getAlignedSize (getDelayLineSize (maxDelayTime, maxSampleRate));
+}
+
+//==============================================================================
+/** Takes getArenaSize (maxSampleRate) samples of arena, prepare() can't go past that rate */
+template <typename Type, size_t maxNumChannels>
+void Delay<Type, maxNumChannels>::setStorage (DelayArena<Type>& arena, double maxSampleRate) noexcept
+{
+    auto lineCapacity = getDelayLineSize (maxDelayTime, maxSampleRate);
+
+    for (auto& dline : delayLines)
+        dline.setStorage (arena.acquire (lineCapacity), lineCapacity);
+
+    updateDelayLineSize();
+    updateDelayTime();
+}
+
 //==============================================================================
 template <typename Type, size_t maxNumChannels>
 void Delay<Type, maxNumChannels>::prepare (const juce::dsp::ProcessSpec& spec)
 {
     jassert (spec.numChannels <= maxNumChannels);
+    jassert (spec.sampleRate <= MAX_SAMPLE_RATE);
     sampleRate = (Type)spec.sampleRate;
     updateDelayLineSize();
     updateDelayTime();
 
-    filterCoefs = juce::dsp::IIR::Coefficients<Type>::makeFirstOrderLowPass (sampleRate, Type (1e3));
-
-    for (auto& f : filters)
-    {
-        f.prepare (spec);
-        f.coefficients = filterCoefs;
-    }
+    damping.prepare (spec.sampleRate);
 }
 
 //==============================================================================
 template <typename Type, size_t maxNumChannels>
 void Delay<Type, maxNumChannels>::reset() noexcept
 {
-    for (auto& f : filters)
-        f.reset();
+    damping.reset();
 
     for (auto& dline : delayLines)
         dline.clear();
@@ -98,7 +231,7 @@ size_t Delay<Type, maxNumChannels>::getNumChannels() const noexcept
 
 //==============================================================================
 template <typename Type, size_t maxNumChannels>
-void Delay<Type, maxNumChannels>::setMaxDelayTime (Type newValue)
+void Delay<Type, maxNumChannels>::setMaxDelayTime (Type newValue) noexcept
 {
     jassert (newValue > Type (0));
     maxDelayTime = newValue;
@@ -121,6 +254,20 @@ void Delay<Type, maxNumChannels>::setWetLevel (Type newValue) noexcept
     wetLevel = newValue;
 }
 
+//==============================================================================
+template <typename Type, size_t maxNumChannels>
+void Delay<Type, maxNumChannels>::setDamping (Type newValue) noexcept
+{
+    damping.setLowPassFrequency (newValue);
+}
+
+//==============================================================================
+template <typename Type, size_t maxNumChannels>
+void Delay<Type, maxNumChannels>::setLowCut (Type newValue) noexcept
+{
+    damping.setHighPassFrequency (newValue);
+}
+
 //==============================================================================
 template <typename Type, size_t maxNumChannels>
 void Delay<Type, maxNumChannels>::setDelayTime (size_t channel, Type newValue)
@@ -145,6 +292,79 @@ void Delay<Type, maxNumChannels>::setDelayTime (Type newValue)
     updateDelayTime();
 }
 
+//==============================================================================
+template <typename Type, size_t maxNumChannels>
+void Delay<Type, maxNumChannels>::setNumTaps (size_t newValue) noexcept
+{
+    setTapPattern (newValue, tapSpread);
+}
+
+//==============================================================================
+template <typename Type, size_t maxNumChannels>
+void Delay<Type, maxNumChannels>::setTapSpread (Type newValue) noexcept
+{
+    setTapPattern (numTaps, newValue);
+}
+
+//==============================================================================
+/** position is the tap time as a fraction of the channel delay time, pan is in the range [-1, 1] */
+template <typename Type, size_t maxNumChannels>
+void Delay<Type, maxNumChannels>::setTap (size_t channel, size_t index, Type position, Type gain, Type pan) noexcept
+{
+    if (channel >= getNumChannels() || index >= maxNumTaps)
+    {
+        jassertfalse;
+        return;
+    }
+
+    auto& tap = taps[channel][index];
+    tap.position = juce::jlimit (Type (0), Type (1), position);
+    tap.gain = gain;
+    tap.pan = juce::jlimit (Type (-1), Type (1), pan);
+
+    updateTapGains (tap);
+    updateDelayTime();
+}
+
+//==============================================================================
+/** Spread numTaps evenly over the delay time, the last tap of every channel sits on the delay time itself.
+    With spread = 0 all the taps of a channel stay on its side, with spread = 1 every other tap
+    jumps to the opposite side.
+*/
+template <typename Type, size_t maxNumChannels>
+void Delay<Type, maxNumChannels>::setTapPattern (size_t newNumTaps, Type spread) noexcept
+{
+    numTaps = juce::jlimit ((size_t)1, maxNumTaps, newNumTaps);
+    tapSpread = juce::jlimit (Type (0), Type (1), spread);
+
+    for (size_t ch = 0; ch < maxNumChannels; ++ch)
+    {
+        auto home = getHomePan (ch);
+
+        for (size_t k = 0; k < numTaps; ++k)
+        {
+            auto& tap = taps[ch][k];
+            auto distanceFromLast = numTaps - 1 - k;
+
+            tap.position = Type (k + 1) / Type (numTaps);
+            tap.gain = tap.position;
+            tap.pan = distanceFromLast % 2 == 0 ? home : home * (Type (1) - Type (2) * tapSpread);
+
+            updateTapGains (tap);
+        }
+    }
+
+    updateDelayTime();
+}
+
+//==============================================================================
+/** Cross the feedback paths, each channel is fed with the repeats of the other one */
+template <typename Type, size_t maxNumChannels>
+void Delay<Type, maxNumChannels>::setPingPong (bool shouldPingPong) noexcept
+{
+    pingPong = shouldPingPong;
+}
+
 //==============================================================================
 template <typename Type, size_t maxNumChannels>
 template <typename ProcessContext>
@@ -159,33 +379,83 @@ void Delay<Type, maxNumChannels>::process (const ProcessContext& context) noexce
     jassert (inputBlock.getNumSamples() == numSamples);
     jassert (inputBlock.getNumChannels() == numChannels);
 
+    // no storage attached, pass the input through
+    if (delayLines[0].size() == 0)
+    {
+        if (context.usesSeparateInputAndOutputBlocks())
+            outputBlock.copyFrom (inputBlock);
+        return;
+    }
+
+    using Vec = typename DampingFilter<Type>::Vec;
+    juce::ScopedNoDenormals noDenormals;
+
+    std::array<const Type*, maxNumChannels> inputs{};
+    std::array<Type*, maxNumChannels> outputs{};
+
     for (size_t ch = 0; ch < numChannels; ++ch)
     {
-        auto* input = inputBlock.getChannelPointer (ch);
-        auto* output = outputBlock.getChannelPointer (ch);
-        auto& dline = delayLines[ch];
-        auto delayTime = delayTimesSample[ch];
-        auto& filter = filters[ch];
+        inputs[ch] = inputBlock.getChannelPointer (ch);
+        outputs[ch] = outputBlock.getChannelPointer (ch);
+    }
+
+    alignas (Vec::SIMDRegisterSize) Type delayed[Vec::SIMDNumElements]{};
+    alignas (Vec::SIMDRegisterSize) Type damped[Vec::SIMDNumElements]{};
+    std::array<Type, maxNumChannels> wet{};
+
+    for (size_t i = 0; i < numSamples; ++i)
+    {
+        for (size_t ch = 0; ch < numChannels; ++ch)
+            delayed[ch] = delayLines[ch].get (delayTimesSample[ch]);
 
-        for (size_t i = 0; i < numSamples; ++i)
+        // the feedback of all the channels is damped in one pass
+        damping.processSample (Vec::fromRawArray (delayed)).copyToRawArray (damped);
+
+        // every tap reads the same lines that are written below, one gather per tap
+        std::fill (wet.begin(), wet.end(), Type (0));
+
+        for (size_t ch = 0; ch < numChannels; ++ch)
+        {
+            for (size_t k = 0; k < numTaps; ++k)
+            {
+                const auto& tap = taps[ch][k];
+                auto tapSample = delayLines[ch].get (tap.delaySamples);
+
+                for (size_t out = 0; out < numChannels; ++out)
+                    wet[out] += tap.outputGains[out] * tapSample;
+            }
+        }
+
+        for (size_t ch = 0; ch < numChannels; ++ch)
         {
-            auto delayedSample = dline.get (delayTime);
-            auto inputSample = input[i];
-            auto dlineInputSample = std::tanh (inputSample + feedback * delayedSample);
-            dline.push (dlineInputSample);
-            auto outputSample = inputSample + wetLevel * delayedSample;
-            output[i] = outputSample;
+            auto inputSample = inputs[ch][i];
+            auto feedbackSample = pingPong ? damped[numChannels - 1 - ch] : damped[ch];
+
+            delayLines[ch].push (std::tanh (inputSample + feedback * feedbackSample));
+            outputs[ch][i] = inputSample + wetLevel * wet[ch];
         }
     }
 }
 
 template <typename Type, size_t maxNumChannels>
-void Delay<Type, maxNumChannels>::updateDelayLineSize()
+size_t Delay<Type, maxNumChannels>::getDelayLineSize (Type time, double rate) noexcept
+{
+    // one extra sample so that a delay of exactly maxDelayTime is still readable
+    return (size_t)std::ceil (time * rate) + 1;
+}
+
+//==============================================================================
+template <typename Type, size_t maxNumChannels>
+void Delay<Type, maxNumChannels>::updateDelayLineSize() noexcept
 {
-    auto delayLineSizeSamples = (size_t)std::ceil (maxDelayTime * sampleRate);
+    auto delayLineSizeSamples = getDelayLineSize (maxDelayTime, sampleRate);
 
     for (auto& dline : delayLines)
-        dline.resize (delayLineSizeSamples);
+    {
+        // the storage is sized for the rate given to setStorage(), it can't grow past it
+        jassert (dline.getCapacity() == 0 || delayLineSizeSamples <= dline.getCapacity());
+        dline.resize (juce::jmin (delayLineSizeSamples, dline.getCapacity()));
+    }
 }
 
 //==============================================================================
@@ -193,9 +463,43 @@ template <typename Type, size_t maxNumChannels>
 void Delay<Type, maxNumChannels>::updateDelayTime() noexcept
 {
     for (size_t ch = 0; ch < maxNumChannels; ++ch)
-        delayTimesSample[ch] = (size_t)juce::roundToInt (delayTimes[ch] * sampleRate);
+    {
+        auto maxDelaySamples = delayLines[ch].size() > 0 ? delayLines[ch].size() - 1 : 0;
+        delayTimesSample[ch] = juce::jmin ((size_t)juce::roundToInt (delayTimes[ch] * sampleRate), maxDelaySamples);
+
+        for (auto& tap : taps[ch])
+            tap.delaySamples = (size_t)juce::roundToInt (tap.position * (Type)delayTimesSample[ch]);
+    }
+}
+
+//==============================================================================
+template <typename Type, size_t maxNumChannels>
+void Delay<Type, maxNumChannels>::updateTapGains (Tap& tap) noexcept
+{
+    if constexpr (maxNumChannels == 1)
+    {
+        tap.outputGains[0] = tap.gain;
+    }
+    else
+    {
+        // balance law, a hard panned tap only reaches its own side
+        for (size_t out = 0; out < maxNumChannels; ++out)
+            tap.outputGains[out] = tap.gain * juce::jmin (Type (1), Type (1) + tap.pan * getHomePan (out));
+    }
+}
+
+//==============================================================================
+/** Where the taps of a channel are panned by default: left for the first channel, right for the last one */
+template <typename Type, size_t maxNumChannels>
+Type Delay<Type, maxNumChannels>::getHomePan (size_t channel) noexcept
+{
+    if constexpr (maxNumChannels == 1)
+        return Type (0);
+    else
+        return juce::jmap ((Type)channel, Type (0), Type (maxNumChannels - 1), Type (-1), Type (1));
 }
 
+template class DelayArena<float>;
 template class DelayLine<float>;
 
 template class Delay<float, 1>;
@@ -1,22 +1,84 @@
+#pragma once
+
+#include "Constants.h"
+#include "Parameters.h"
 #include <JuceHeader.h>
 
+/** One cache-aligned memory block shared by all the delay lines in the app.
+    It is allocated once and then handed out in slices, so preparing the delays
+    for a new sample rate never touches the heap.
+*/
+template <typename Type>
+class DelayArena
+{
+public:
+    static constexpr size_t alignment = 64; // bytes (one cache line)
+
+    static size_t getAlignedSize (size_t numSamples) noexcept;
+
+    void allocate (size_t totalNumSamples);
+    Type* acquire (size_t numSamples) noexcept;
+    size_t getNumSamplesLeft() const noexcept;
+
+private:
+    juce::HeapBlock<char> memory;
+    Type* data = nullptr;
+    size_t capacity = 0;
+    size_t used = 0;
+};
+
+//==============================================================================
 template <typename Type>
 class DelayLine
 {
 public:
+    void setStorage (Type* newData, size_t newCapacity) noexcept;
+    size_t getCapacity() const noexcept;
+
     void clear() noexcept;
     size_t size() const noexcept;
-    void resize (size_t newValue);
+    void resize (size_t newValue) noexcept;
     Type back() const noexcept;
     Type get (size_t delayInSamples) const noexcept;
     void set (size_t delayInSamples, Type newValue) noexcept;
     void push (Type valueToAdd) noexcept;
 
 private:
-    std::vector<Type> rawData;
+    Type* rawData = nullptr;
+    size_t capacity = 0;
+    size_t length = 0;
     size_t leastRecentIndex = 0;
 };
 
+//==============================================================================
+/** One-pole low-pass followed by a one-pole high-pass, used to damp the delay repeats.
+    All the delay channels are filtered at once, one channel per SIMD lane.
+*/
+template <typename Type>
+class DampingFilter
+{
+public:
+    using Vec = juce::dsp::SIMDRegister<Type>;
+
+    void prepare (double newSampleRate) noexcept;
+    void reset() noexcept;
+    void setLowPassFrequency (Type newValue) noexcept;
+    void setHighPassFrequency (Type newValue) noexcept;
+    Vec processSample (Vec input) noexcept;
+
+private:
+    Vec lowPassState = Vec::expand (Type (0));
+    Vec highPassState = Vec::expand (Type (0));
+
+    Type lowPassFreq{(Type)getSpec (ParamId::DEL_DAMPING).def};
+    Type highPassFreq{(Type)getSpec (ParamId::DEL_LOWCUT).def};
+    Type lowPassCoef{Type (1)};
+    Type highPassCoef{Type (0)};
+    double sampleRate{44.1e3};
+
+    void updateCoefficients() noexcept;
+};
+
 //==============================================================================
 template <typename Type, size_t maxNumChannels = 2>
 class Delay
@@ -24,32 +86,65 @@ class Delay
 public:
     //==============================================================================
     Delay();
+    size_t getArenaSize (double maxSampleRate) const noexcept;
+    void setStorage (DelayArena<Type>& arena, double maxSampleRate) noexcept;
     void prepare (const juce::dsp::ProcessSpec& spec);
     void reset() noexcept;
     size_t getNumChannels() const noexcept;
-    void setMaxDelayTime (Type newValue);
+    void setMaxDelayTime (Type newValue) noexcept;
     void setFeedback (Type newValue) noexcept;
     void setWetLevel (Type newValue) noexcept;
+    void setDamping (Type newValue) noexcept;
+    void setLowCut (Type newValue) noexcept;
     void setDelayTime (size_t channel, Type newValue);
     void setDelayTime (Type newValue);
+
+    static constexpr size_t maxNumTaps = 8;
+    void setNumTaps (size_t newValue) noexcept;
+    void setTap (size_t channel, size_t index, Type position, Type gain, Type pan) noexcept;
+    void setTapPattern (size_t numTaps, Type spread) noexcept;
+    void setTapSpread (Type newValue) noexcept;
+    void setPingPong (bool shouldPingPong) noexcept;
+
     template <typename ProcessContext>
     void process (const ProcessContext& context) noexcept;
 
 private:
     //==============================================================================
+    /** A read point on a channel delay line. Its time is a fraction of the channel delay time,
+        and it is mixed into every output channel according to its gain and pan.
+    */
+    struct Tap
+    {
+        Type position{Type (1)};
+        Type gain{Type (1)};
+        Type pan{Type (0)};
+        size_t delaySamples{0};
+        std::array<Type, maxNumChannels> outputGains{};
+    };
+
     std::array<DelayLine<Type>, maxNumChannels> delayLines;
-    std::array<size_t, maxNumChannels> delayTimesSample;
-    std::array<Type, maxNumChannels> delayTimes;
+    std::array<std::array<Tap, maxNumTaps>, maxNumChannels> taps;
+    size_t numTaps{1};
+    Type tapSpread{Type (0)};
+    bool pingPong{false};
+
+    std::array<size_t, maxNumChannels> delayTimesSample{};
+    std::array<Type, maxNumChannels> delayTimes{};
     Type feedback{Type (0)};
     Type wetLevel{Type (0)};
 
-    std::array<juce::dsp::IIR::Filter<Type>, maxNumChannels> filters;
-    typename juce::dsp::IIR::Coefficients<Type>::Ptr filterCoefs;
+    // feedback path damping, one SIMD lane per channel
+    DampingFilter<Type> damping;
+    static_assert (maxNumChannels <= DampingFilter<Type>::Vec::SIMDNumElements);
 
     Type sampleRate{Type (44.1e3)};
     Type maxDelayTime{Type (2)};
 
     //==============================================================================
-    void updateDelayLineSize();
+    static size_t getDelayLineSize (Type time, double rate) noexcept;
+    void updateDelayLineSize() noexcept;
     void updateDelayTime() noexcept;
+    void updateTapGains (Tap& tap) noexcept;
+    static Type getHomePan (size_t channel) noexcept;
 };
@@ -0,0 +1,768 @@
+#include "Filter.h"
+#include "Random.h"
+
+// FILTER BANK
+//==============================================================================
+template <typename Type>
+FilterBank<Type>::FilterBank (size_t numLanes)
+    : groups ((numLanes + lanesPerGroup - 1) / lanesPerGroup), cutoffFreqHz (groups.size() * lanesPerGroup)
+{
+    for (auto& g : groups)
+    {
+        for (auto& s : g.state)
+            s = Vec::expand (Type (0));
+
+        for (auto& s : g.svfState)
+            s = Vec::expand (Type (0));
+
+        g.enabled = Vec::expand (Type (1));
+    }
+
+    rebuildRandomWave();
+
+    for (size_t lane = 0; lane < getNumLanes(); ++lane)
+    {
+        setMode (lane, SvfMode::LPF);
+        setMode (lane, juce::dsp::LadderFilterMode::LPF12);
+        setCutoffFrequencyHz (lane, (Type)getSpec (ParamId::FILT_CUTOFF).def);
+        setResonance (lane, (Type)getSpec (ParamId::FILT_RESO).def);
+        setDrive (lane, (Type)getSpec (ParamId::FILT_DRIVE).def);
+    }
+
+    reset();
+}
+
+template <typename Type>
+size_t FilterBank<Type>::getNumLanes() const noexcept
+{
+    return groups.size() * lanesPerGroup;
+}
+
+template <typename Type>
+void FilterBank<Type>::prepare (double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    invSampleRate = Type (1.0 / sampleRate);
+    cutoffFreqScaler = Type (-2.0 * juce::MathConstants<double>::pi / sampleRate);
+
+    // one-pole smoothing that settles in about 50 ms, like the LadderFilter ramps
+    smoothingCoef = Type (1) - std::exp (Type (-1) / Type (0.01 * sampleRate));
+
+    for (size_t lane = 0; lane < getNumLanes(); ++lane)
+    {
+        setCutoffFrequencyHz (lane, cutoffFreqHz[lane]);
+
+        auto& m = getGroup (lane).mod[lane % lanesPerGroup];
+        m.increment = juce::MathConstants<Type>::twoPi * m.frequency * invSampleRate;
+    }
+
+    reset();
+}
+
+template <typename Type>
+void FilterBank<Type>::reset() noexcept
+{
+    reset (0, getNumLanes());
+}
+
+template <typename Type>
+void FilterBank<Type>::reset (size_t firstLane, size_t numLanesToReset) noexcept
+{
+    for (auto lane = firstLane; lane < firstLane + numLanesToReset && lane < getNumLanes(); ++lane)
+    {
+        auto& g = getGroup (lane);
+        auto l = lane % lanesPerGroup;
+
+        for (auto& s : g.state)
+            s.set (l, Type (0));
+
+        for (auto& s : g.svfState)
+            s.set (l, Type (0));
+
+        g.cutoffTransform.set (l, g.cutoffTransformTarget.get (l));
+        g.scaledResonance.set (l, g.scaledResonanceTarget.get (l));
+        g.svfCutoff.set (l, g.svfCutoffTarget.get (l));
+        g.svfDamping.set (l, g.svfDampingTarget.get (l));
+    }
+}
+
+template <typename Type>
+void FilterBank<Type>::setEnabled (size_t lane, bool isEnabled) noexcept
+{
+    getGroup (lane).enabled.set (lane % lanesPerGroup, isEnabled ? Type (1) : Type (0));
+}
+
+template <typename Type>
+void FilterBank<Type>::setMode (size_t lane, juce::dsp::LadderFilterMode newMode) noexcept
+{
+    using Mode = juce::dsp::LadderFilterMode;
+
+    std::array<Type, 5> A{};
+    Type comp{};
+
+    // clang-format off
+    switch (newMode)
+    {
+    case Mode::LPF12: A = {{Type (0), Type (0),  Type (1),  Type (0),  Type (0)}}; comp = Type (0.5); break;
+    case Mode::HPF12: A = {{Type (1), Type (-2), Type (1),  Type (0),  Type (0)}}; comp = Type (0);   break;
+    case Mode::BPF12: A = {{Type (0), Type (0),  Type (-1), Type (1),  Type (0)}}; comp = Type (0.5); break;
+    case Mode::LPF24: A = {{Type (0), Type (0),  Type (0),  Type (0),  Type (1)}}; comp = Type (0.5); break;
+    case Mode::HPF24: A = {{Type (1), Type (-4), Type (6),  Type (-4), Type (1)}}; comp = Type (0);   break;
+    case Mode::BPF24: A = {{Type (0), Type (0),  Type (1),  Type (-2), Type (1)}}; comp = Type (0.5); break;
+    default: jassertfalse; return;
+    }
+    // clang-format on
+
+    constexpr auto outputGain = Type (1.2);
+    auto& g = getGroup (lane);
+    auto l = lane % lanesPerGroup;
+
+    for (size_t k = 0; k < A.size(); ++k)
+        g.A[k].set (l, A[k] * outputGain);
+
+    g.comp.set (l, comp);
+
+    // start the ladder from silence rather than from whatever it held when it was last used
+    if (std::exchange (g.svf[l], false))
+        for (auto& s : g.state)
+            s.set (l, Type (0));
+}
+
+template <typename Type>
+void FilterBank<Type>::setMode (size_t lane, SvfMode newMode) noexcept
+{
+    // outputs of the TPT state-variable filter, as gains of x, v1, v2 and k * v1,
+    // with the bandpass normalised to unity gain at the cutoff
+    std::array<Type, 4> mix{};
+
+    // clang-format off
+    switch (newMode)
+    {
+    case SvfMode::LPF:   mix = {{Type (0),  Type (0), Type (1),  Type (0)}};  break;
+    case SvfMode::BPF:   mix = {{Type (0),  Type (0), Type (0),  Type (1)}};  break;
+    case SvfMode::HPF:   mix = {{Type (1),  Type (0), Type (-1), Type (-1)}}; break;
+    case SvfMode::NOTCH: mix = {{Type (1),  Type (0), Type (0),  Type (-1)}}; break;
+    case SvfMode::PEAK:  mix = {{Type (-1), Type (0), Type (2),  Type (1)}};  break;
+    default: jassertfalse; return;
+    }
+    // clang-format on
+
+    auto& g = getGroup (lane);
+    auto l = lane % lanesPerGroup;
+
+    for (size_t k = 0; k < mix.size(); ++k)
+        g.svfMix[k].set (l, mix[k]);
+
+    if (! std::exchange (g.svf[l], true))
+        for (auto& s : g.svfState)
+            s.set (l, Type (0));
+}
+
+template <typename Type>
+void FilterBank<Type>::setCutoffFrequencyHz (size_t lane, Type newValue) noexcept
+{
+    jassert (newValue > Type (0));
+    cutoffFreqHz[lane] = newValue;
+
+    auto& g = getGroup (lane);
+    auto l = lane % lanesPerGroup;
+
+    g.cutoffTransformTarget.set (l, std::exp (newValue * cutoffFreqScaler));
+    g.svfCutoffTarget.set (l, newValue);
+}
+
+template <typename Type>
+void FilterBank<Type>::setResonance (size_t lane, Type newValue) noexcept
+{
+    jassert (newValue >= Type (0) && newValue <= Type (1));
+    auto& g = getGroup (lane);
+    auto l = lane % lanesPerGroup;
+
+    g.scaledResonanceTarget.set (l, juce::jmap (newValue, Type (0.1), Type (1.0)));
+
+    // damping k = 1 / Q, from Q = 0.5 down to Q = 25
+    g.svfDampingTarget.set (l, juce::jmap (newValue, Type (2), Type (0.04)));
+}
+
+template <typename Type>
+void FilterBank<Type>::setDrive (size_t lane, Type newValue) noexcept
+{
+    jassert (newValue >= Type (1));
+    auto& g = getGroup (lane);
+    auto l = lane % lanesPerGroup;
+
+    auto drive2 = newValue * Type (0.04) + Type (0.96);
+
+    g.drive.set (l, newValue);
+    g.gain.set (l, std::pow (newValue, Type (-2.642)) * Type (0.6103) + Type (0.3903));
+    g.drive2.set (l, drive2);
+    g.gain2.set (l, std::pow (drive2, Type (-2.642)) * Type (0.6103) + Type (0.3903));
+}
+
+template <typename Type>
+void FilterBank<Type>::setCutoffModulation (size_t lane, size_t wave, Type frequencyHz, Type gain, Type max) noexcept
+{
+    auto& g = getGroup (lane);
+    auto& m = g.mod[lane % lanesPerGroup];
+
+    // a new modulation starts from the top of its wave, the two lanes of a chain stay in phase
+    if (!m.active)
+        m.phase = -juce::MathConstants<Type>::pi;
+
+    m.active = true;
+    m.wave = wave;
+    m.frequency = frequencyHz;
+    m.increment = juce::MathConstants<Type>::twoPi * frequencyHz * invSampleRate;
+    m.gain = gain;
+    m.max = max;
+    g.anyMod = true;
+}
+
+template <typename Type>
+void FilterBank<Type>::clearCutoffModulation (size_t lane) noexcept
+{
+    auto& g = getGroup (lane);
+    g.mod[lane % lanesPerGroup].active = false;
+    g.anyMod = std::any_of (g.mod.begin(), g.mod.end(), [] (const auto& m) { return m.active; });
+
+    // back to the unmodulated cutoff, through the usual smoothing
+    setCutoffFrequencyHz (lane, cutoffFreqHz[lane]);
+}
+
+template <typename Type>
+void FilterBank<Type>::rebuildRandomWave()
+{
+    randomLUT.initialise ([] (Type) { return (Type)Rng::forThread().uniform (-1.0f, 1.0f); },
+                          -juce::MathConstants<Type>::pi, juce::MathConstants<Type>::pi, 2048);
+}
+
+template <typename Type>
+void FilterBank<Type>::process (size_t firstLane, Type* const* channels, size_t numChannels, size_t numSamples) noexcept
+{
+    auto lastLane = firstLane + numChannels;
+    jassert (lastLane <= getNumLanes());
+
+    juce::ScopedNoDenormals noDenormals;
+
+    for (auto groupStart = firstLane - firstLane % lanesPerGroup; groupStart < lastLane; groupStart += lanesPerGroup)
+    {
+        auto& g = groups[groupStart / lanesPerGroup];
+        std::array<Type*, lanesPerGroup> groupChannels{};
+        auto ladderMask = Vec::expand (Type (0));
+        auto svfMask = Vec::expand (Type (0));
+        bool anyLadder = false, anySvf = false;
+
+        // lanes outside the range or disabled keep their state untouched
+        for (size_t l = 0; l < lanesPerGroup; ++l)
+        {
+            auto lane = groupStart + l;
+
+            if (lane < firstLane || lane >= lastLane)
+                continue;
+
+            groupChannels[l] = channels[lane - firstLane];
+
+            if (groupChannels[l] == nullptr || g.enabled.get (l) == Type (0))
+                continue;
+
+            (g.svf[l] ? svfMask : ladderMask).set (l, Type (1));
+            (g.svf[l] ? anySvf : anyLadder) = true;
+        }
+
+        // each model only touches its own lanes, so a mixed group simply takes both passes
+        if (anyLadder)
+            processLadder (g, groupChannels.data(), ladderMask, numSamples);
+
+        if (anySvf)
+            processSvf (g, groupChannels.data(), svfMask, numSamples);
+    }
+}
+
+//==============================================================================
+template <typename Type>
+typename FilterBank<Type>::Group& FilterBank<Type>::getGroup (size_t lane) noexcept
+{
+    jassert (lane < getNumLanes());
+    return groups[lane / lanesPerGroup];
+}
+
+template <typename Type>
+typename FilterBank<Type>::Vec FilterBank<Type>::saturate (Vec input) const noexcept
+{
+    alignas (Vec::SIMDRegisterSize) Type lanes[lanesPerGroup];
+    input.copyToRawArray (lanes);
+
+    for (auto& x : lanes)
+        x = saturationLUT.processSample (x);
+
+    return Vec::fromRawArray (lanes);
+}
+
+/** The cutoff of the sample, the same shape and range as Lfo::process gives at its own rate */
+template <typename Type>
+Type FilterBank<Type>::nextModulatedCutoff (typename Group::CutoffMod& m, Type base) noexcept
+{
+    constexpr auto pi = juce::MathConstants<Type>::pi;
+    auto x = m.phase;
+
+    m.phase += m.increment;
+    if (m.phase >= pi)
+        m.phase -= Type (2) * pi;
+
+    if (m.frequency == Type (0))
+        return base;
+
+    Type w;
+    switch (m.wave)
+    {
+    case 1: w = x / pi; break;
+    case 2: w = x < Type (0) ? Type (-1) : Type (1); break;
+    case 3: w = randomLUT.processSample (x); break;
+    default: w = sineLUT.processSample (x); break;
+    }
+
+    auto cutoff = base + (w + Type (1)) * Type (0.5) * (m.max - base) * m.gain;
+    return juce::jmax ((Type)getSpec (ParamId::FILT_CUTOFF).min, cutoff);
+}
+
+template <typename Type>
+void FilterBank<Type>::processLadder (Group& g, Type* const* channels, Vec laneMask, size_t numSamples) noexcept
+{
+    alignas (Vec::SIMDRegisterSize) Type buffer[lanesPerGroup]{};
+    const auto one = Vec::expand (Type (1));
+    const auto laneSmoothing = laneMask * smoothingCoef;
+    const auto firstLane = (size_t)(&g - groups.data()) * lanesPerGroup;
+    auto& s = g.state;
+
+    for (size_t i = 0; i < numSamples; ++i)
+    {
+        for (size_t l = 0; l < lanesPerGroup; ++l)
+            buffer[l] = channels[l] != nullptr ? channels[l][i] : Type (0);
+
+        auto x = Vec::fromRawArray (buffer);
+
+        g.cutoffTransform += (g.cutoffTransformTarget - g.cutoffTransform) * laneSmoothing;
+        g.scaledResonance += (g.scaledResonanceTarget - g.scaledResonance) * laneSmoothing;
+
+        // the modulated lanes skip the ramp, it would smear the LFO
+        if (g.anyMod)
+            for (size_t l = 0; l < lanesPerGroup; ++l)
+                if (g.mod[l].active && laneMask.get (l) != Type (0))
+                    g.cutoffTransform.set (
+                        l, std::exp (nextModulatedCutoff (g.mod[l], cutoffFreqHz[firstLane + l]) * cutoffFreqScaler));
+
+        const auto a1 = g.cutoffTransform;
+        const auto gCoef = one - a1;
+        const auto b0 = gCoef * Type (0.76923076923);
+        const auto b1 = gCoef * Type (0.23076923076);
+
+        const auto dx = g.gain * saturate (x * g.drive);
+        const auto a = dx + g.scaledResonance * Type (-4) * (g.gain2 * saturate (g.drive2 * s[4]) - dx * g.comp);
+
+        const auto b = b1 * s[0] + a1 * s[1] + b0 * a;
+        const auto c = b1 * s[1] + a1 * s[2] + b0 * b;
+        const auto d = b1 * s[2] + a1 * s[3] + b0 * c;
+        const auto e = b1 * s[3] + a1 * s[4] + b0 * d;
+
+        auto y = a * g.A[0] + b * g.A[1] + c * g.A[2] + d * g.A[3] + e * g.A[4];
+
+        // masked lanes keep their state and pass their input through
+        s[0] += (a - s[0]) * laneMask;
+        s[1] += (b - s[1]) * laneMask;
+        s[2] += (c - s[2]) * laneMask;
+        s[3] += (d - s[3]) * laneMask;
+        s[4] += (e - s[4]) * laneMask;
+
+        y = x + (y - x) * laneMask;
+        y.copyToRawArray (buffer);
+
+        for (size_t l = 0; l < lanesPerGroup; ++l)
+            if (channels[l] != nullptr)
+                channels[l][i] = buffer[l];
+    }
+}
+
+/** Zavalishin's TPT state-variable filter, in Simper's trapezoidal form */
+template <typename Type>
+void FilterBank<Type>::processSvf (Group& g, Type* const* channels, Vec laneMask, size_t numSamples) noexcept
+{
+    alignas (Vec::SIMDRegisterSize) Type buffer[lanesPerGroup]{};
+    alignas (Vec::SIMDRegisterSize) Type cutoffs[lanesPerGroup]{};
+    alignas (Vec::SIMDRegisterSize) Type dampings[lanesPerGroup]{};
+    alignas (Vec::SIMDRegisterSize) Type a1s[lanesPerGroup]{};
+    alignas (Vec::SIMDRegisterSize) Type a2s[lanesPerGroup]{};
+    alignas (Vec::SIMDRegisterSize) Type a3s[lanesPerGroup]{};
+
+    const auto cutoffSmoothing = laneMask * smoothingCoef;
+    const auto dampingSmoothing = laneMask * smoothingCoef;
+    const auto firstLane = (size_t)(&g - groups.data()) * lanesPerGroup;
+    const auto stateMask = laneMask * Type (2);
+    auto& s = g.svfState;
+    auto& m = g.svfMix;
+
+    for (size_t i = 0; i < numSamples; ++i)
+    {
+        for (size_t l = 0; l < lanesPerGroup; ++l)
+            buffer[l] = channels[l] != nullptr ? channels[l][i] : Type (0);
+
+        auto x = Vec::fromRawArray (buffer);
+
+        g.svfCutoff += (g.svfCutoffTarget - g.svfCutoff) * cutoffSmoothing;
+        g.svfDamping += (g.svfDampingTarget - g.svfDamping) * dampingSmoothing;
+
+        // the coefficients need a tan() and a division, done per lane from the lookup table
+        g.svfCutoff.copyToRawArray (cutoffs);
+        g.svfDamping.copyToRawArray (dampings);
+
+        // the modulated lanes skip the smoothing, it would smear the LFO
+        if (g.anyMod)
+            for (size_t l = 0; l < lanesPerGroup; ++l)
+                if (g.mod[l].active && laneMask.get (l) != Type (0))
+                    cutoffs[l] = nextModulatedCutoff (g.mod[l], cutoffFreqHz[firstLane + l]);
+
+        for (size_t l = 0; l < lanesPerGroup; ++l)
+        {
+            auto gCoef = prewarpLUT.processSample (cutoffs[l] * invSampleRate);
+            a1s[l] = Type (1) / (Type (1) + gCoef * (gCoef + dampings[l]));
+            a2s[l] = gCoef * a1s[l];
+            a3s[l] = gCoef * a2s[l];
+        }
+
+        const auto a1 = Vec::fromRawArray (a1s);
+        const auto a2 = Vec::fromRawArray (a2s);
+        const auto a3 = Vec::fromRawArray (a3s);
+
+        const auto v3 = x - s[1];
+        const auto v1 = a1 * s[0] + a2 * v3;
+        const auto v2 = s[1] + a2 * s[0] + a3 * v3;
+
+        auto y = x * m[0] + v1 * m[1] + v2 * m[2] + g.svfDamping * v1 * m[3];
+
+        // ic = 2 * v - ic, masked lanes keep their state and pass their input through
+        s[0] += (v1 - s[0]) * stateMask;
+        s[1] += (v2 - s[1]) * stateMask;
+
+        y = x + (y - x) * laneMask;
+        y.copyToRawArray (buffer);
+
+        for (size_t l = 0; l < lanesPerGroup; ++l)
+            if (channels[l] != nullptr)
+                channels[l][i] = buffer[l];
+    }
+}
+
+// FILTER
+//==============================================================================
+template <typename Type>
+void Filter<Type>::attach (FilterBank<Type>& newBank, size_t newFirstLane) noexcept
+{
+    jassert (newFirstLane + maxNumChannels <= newBank.getNumLanes());
+    bank = &newBank;
+    firstLane = newFirstLane;
+}
+
+template <typename Type>
+size_t Filter<Type>::getFirstLane() const noexcept
+{
+    return firstLane;
+}
+
+template <typename Type>
+void Filter<Type>::setEnabled (bool isEnabled) noexcept
+{
+    jassert (bank != nullptr);
+    if (bank != nullptr)
+        for (size_t ch = 0; ch < maxNumChannels; ++ch)
+            bank->setEnabled (firstLane + ch, isEnabled);
+}
+
+template <typename Type>
+void Filter<Type>::setMode (juce::dsp::LadderFilterMode newMode) noexcept
+{
+    jassert (bank != nullptr);
+    if (bank != nullptr)
+        for (size_t ch = 0; ch < maxNumChannels; ++ch)
+            bank->setMode (firstLane + ch, newMode);
+}
+
+template <typename Type>
+void Filter<Type>::setMode (SvfMode newMode) noexcept
+{
+    jassert (bank != nullptr);
+    if (bank != nullptr)
+        for (size_t ch = 0; ch < maxNumChannels; ++ch)
+            bank->setMode (firstLane + ch, newMode);
+}
+
+template <typename Type>
+void Filter<Type>::setCutoffFrequencyHz (Type newValue) noexcept
+{
+    jassert (bank != nullptr);
+    if (bank != nullptr)
+        for (size_t ch = 0; ch < maxNumChannels; ++ch)
+            bank->setCutoffFrequencyHz (firstLane + ch, newValue);
+}
+
+template <typename Type>
+void Filter<Type>::setResonance (Type newValue) noexcept
+{
+    jassert (bank != nullptr);
+    if (bank != nullptr)
+        for (size_t ch = 0; ch < maxNumChannels; ++ch)
+            bank->setResonance (firstLane + ch, newValue);
+}
+
+template <typename Type>
+void Filter<Type>::setDrive (Type newValue) noexcept
+{
+    jassert (bank != nullptr);
+    if (bank != nullptr)
+        for (size_t ch = 0; ch < maxNumChannels; ++ch)
+            bank->setDrive (firstLane + ch, newValue);
+}
+
+template <typename Type>
+void Filter<Type>::setCutoffModulation (size_t wave, Type frequencyHz, Type gain, Type max) noexcept
+{
+    jassert (bank != nullptr);
+    if (bank != nullptr)
+        for (size_t ch = 0; ch < maxNumChannels; ++ch)
+            bank->setCutoffModulation (firstLane + ch, wave, frequencyHz, gain, max);
+}
+
+template <typename Type>
+void Filter<Type>::clearCutoffModulation() noexcept
+{
+    jassert (bank != nullptr);
+    if (bank != nullptr)
+        for (size_t ch = 0; ch < maxNumChannels; ++ch)
+            bank->clearCutoffModulation (firstLane + ch);
+}
+
+/** The bank itself is prepared by its owner */
+template <typename Type>
+void Filter<Type>::prepare (const juce::dsp::ProcessSpec& spec)
+{
+    jassert (spec.numChannels <= maxNumChannels);
+    numChannels = juce::jmin ((size_t)spec.numChannels, maxNumChannels);
+    reset();
+}
+
+template <typename Type>
+void Filter<Type>::reset() noexcept
+{
+    if (bank != nullptr)
+        bank->reset (firstLane, maxNumChannels);
+}
+
+template <typename Type>
+template <typename ProcessContext>
+void Filter<Type>::process (const ProcessContext& context) noexcept
+{
+    auto& inputBlock = context.getInputBlock();
+    auto& outputBlock = context.getOutputBlock();
+
+    if (context.usesSeparateInputAndOutputBlocks())
+        outputBlock.copyFrom (inputBlock);
+
+    if (bank == nullptr || context.isBypassed)
+        return;
+
+    std::array<Type*, maxNumChannels> channels{};
+    auto n = juce::jmin (outputBlock.getNumChannels(), numChannels);
+
+    for (size_t ch = 0; ch < n; ++ch)
+        channels[ch] = outputBlock.getChannelPointer (ch);
+
+    bank->process (firstLane, channels.data(), n, outputBlock.getNumSamples());
+}
+
+template class FilterBank<float>;
+template class Filter<float>;
+template void
+Filter<float>::process<juce::dsp::ProcessContextReplacing<float>> (const juce::dsp::ProcessContextReplacing<float>& context);
+
+// TESTS
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+/** The ladder lanes against juce::dsp::LadderFilter, which they're meant to reproduce exactly */
+class FilterBankTests : public juce::UnitTest
+{
+public:
+    FilterBankTests() : juce::UnitTest ("FilterBank", "OneButtonKiller")
+    {
+    }
+
+    void runTest() override
+    {
+        using Mode = juce::dsp::LadderFilterMode;
+        constexpr Mode modes[] = {Mode::LPF12, Mode::HPF12, Mode::BPF12, Mode::LPF24, Mode::HPF24, Mode::BPF24};
+        constexpr float cutoffs[] = {40.0f, 500.0f, 2000.0f, 8000.0f, 18000.0f};
+        constexpr float resonances[] = {0.0f, 0.3f, 0.6f, 0.9f};
+        constexpr float drive = 1.5f;
+        constexpr double sampleRate = 48000;
+        constexpr int blockSize = 512, numBlocks = 16;
+
+        beginTest ("Ladder lanes match juce::dsp::LadderFilter");
+
+        // one lane per combination, so the combinations also share SIMD registers
+        struct Case
+        {
+            Mode mode;
+            float cutoff, resonance;
+        };
+
+        std::vector<Case> cases;
+        for (auto mode : modes)
+            for (auto cutoff : cutoffs)
+                for (auto resonance : resonances)
+                    cases.push_back ({mode, cutoff, resonance});
+
+        auto numLanes = cases.size();
+        FilterBank<float> bank (numLanes);
+        std::vector<std::unique_ptr<juce::dsp::LadderFilter<float>>> references;
+
+        for (size_t lane = 0; lane < numLanes; ++lane)
+        {
+            auto& c = cases[lane];
+            bank.setMode (lane, c.mode);
+            bank.setCutoffFrequencyHz (lane, c.cutoff);
+            bank.setResonance (lane, c.resonance);
+            bank.setDrive (lane, drive);
+
+            auto& ladder = *references.emplace_back (std::make_unique<juce::dsp::LadderFilter<float>>());
+            ladder.setEnabled (true);
+            ladder.setMode (c.mode);
+            ladder.setCutoffFrequencyHz (c.cutoff);
+            ladder.setResonance (c.resonance);
+            ladder.setDrive (drive);
+            ladder.prepare ({sampleRate, (juce::uint32)blockSize, 1});
+        }
+
+        // both start at their targets, with nothing to smooth
+        bank.prepare (sampleRate);
+
+        juce::AudioBuffer<float> banked ((int)numLanes, blockSize * numBlocks);
+        auto random = getRandom();
+
+        for (int ch = 0; ch < banked.getNumChannels(); ++ch)
+            for (int i = 0; i < banked.getNumSamples(); ++i)
+                banked.setSample (ch, i, random.nextFloat() * 2.0f - 1.0f);
+
+        juce::AudioBuffer<float> expected (banked);
+        std::vector<float*> channels (numLanes);
+
+        for (int start = 0; start < banked.getNumSamples(); start += blockSize)
+        {
+            for (size_t lane = 0; lane < numLanes; ++lane)
+                channels[lane] = banked.getWritePointer ((int)lane, start);
+
+            bank.process (0, channels.data(), numLanes, (size_t)blockSize);
+
+            for (size_t lane = 0; lane < numLanes; ++lane)
+            {
+                auto block = juce::dsp::AudioBlock<float> (expected)
+                                 .getSingleChannelBlock (lane)
+                                 .getSubBlock ((size_t)start, (size_t)blockSize);
+                references[lane]->process (juce::dsp::ProcessContextReplacing<float> (block));
+            }
+        }
+
+        for (size_t lane = 0; lane < numLanes; ++lane)
+        {
+            auto* actual = banked.getReadPointer ((int)lane);
+            auto* reference = expected.getReadPointer ((int)lane);
+            auto error = 0.0f;
+
+            for (int i = 0; i < banked.getNumSamples(); ++i)
+                error = juce::jmax (error, std::abs (actual[i] - reference[i]));
+
+            auto& c = cases[lane];
+            expectWithinAbsoluteError (error, 0.0f, 1.0e-4f,
+                                       "mode " + juce::String ((int)c.mode) + ", cutoff " + juce::String (c.cutoff)
+                                           + " Hz, resonance " + juce::String (c.resonance));
+        }
+    }
+};
+
+static FilterBankTests filterBankTests;
+
+//==============================================================================
+/** The filter stage of every chain in one bank against one juce::dsp::LadderFilter per chain */
+class FilterBankBenchmark : public juce::UnitTest
+{
+public:
+    FilterBankBenchmark() : juce::UnitTest ("FilterBank throughput", "Benchmarks")
+    {
+    }
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000, seconds = 10;
+        constexpr int blockSize = 256;
+        constexpr auto numBlocks = (int)(sampleRate * seconds) / blockSize;
+
+        for (auto numChains : {(size_t)DEFAULT_NUM_CHAINS, (size_t)16, (size_t)MAX_NUM_CHAINS})
+        {
+            beginTest (juce::String (numChains) + " chains");
+
+            juce::AudioBuffer<float> buffer ((int)numChains * 2, blockSize);
+            auto random = getRandom();
+            auto fill = [&]
+            {
+                for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+                    for (int i = 0; i < blockSize; ++i)
+                        buffer.setSample (ch, i, random.nextFloat() * 2.0f - 1.0f);
+            };
+
+            FilterBank<float> bank (numChains * 2);
+            std::vector<juce::dsp::LadderFilter<float>> ladders (numChains);
+
+            for (size_t lane = 0; lane < bank.getNumLanes(); ++lane)
+            {
+                bank.setMode (lane, juce::dsp::LadderFilterMode::LPF24);
+                bank.setCutoffFrequencyHz (lane, 1000.0f);
+                bank.setResonance (lane, 0.5f);
+            }
+
+            for (auto& ladder : ladders)
+            {
+                ladder.setMode (juce::dsp::LadderFilterMode::LPF24);
+                ladder.setCutoffFrequencyHz (1000.0f);
+                ladder.setResonance (0.5f);
+                ladder.prepare ({sampleRate, (juce::uint32)blockSize, 2});
+            }
+
+            bank.prepare (sampleRate);
+
+            // the noise is written once, both run on whatever the previous block left
+            fill();
+            auto start = juce::Time::getHighResolutionTicks();
+            for (int b = 0; b < numBlocks; ++b)
+                bank.process (0, buffer.getArrayOfWritePointers(), numChains * 2, (size_t)blockSize);
+            auto banked = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+
+            fill();
+            start = juce::Time::getHighResolutionTicks();
+            for (int b = 0; b < numBlocks; ++b)
+            {
+                for (size_t c = 0; c < numChains; ++c)
+                {
+                    auto block = juce::dsp::AudioBlock<float> (buffer).getSubsetChannelBlock (c * 2, 2);
+                    ladders[c].process (juce::dsp::ProcessContextReplacing<float> (block));
+                }
+            }
+            auto single = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+
+            logMessage ("bank " + juce::String (banked / seconds * 100.0, 2) + "% of a core, LadderFilter "
+                        + juce::String (single / seconds * 100.0, 2) + "%, "
+                        + juce::String (single / juce::jmax (banked, 1e-9), 2) + "x faster");
+            expect (std::isfinite (buffer.getSample (0, 0)));
+        }
+    }
+};
+
+static FilterBankBenchmark filterBankBenchmark;
+
+#endif
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "Constants.h"
+#include "Parameters.h"
+#include <JuceHeader.h>
+#include <algorithm>
+#include <vector>
+
+/** Modes of the state-variable model of FilterBank */
+enum class SvfMode
+{
+    LPF,
+    BPF,
+    HPF,
+    NOTCH,
+    PEAK
+};
+
+//==============================================================================
+/** Filters for many channels at once, one channel per SIMD lane.
+
+    Every lane runs either the ladder of juce::dsp::LadderFilter (same algorithm and modes) or a
+    TPT state-variable filter, picked by the kind of mode it is given. Cutoff, resonance, drive,
+    mode and enabled state are set per lane, so the filter stage of all the chains runs in
+    getNumLanes() / SIMDNumElements passes instead of one pass per channel.
+
+    The state-variable lanes get their tan() prewarping from a lookup table, so their coefficients
+    are recomputed every sample. Drive only applies to the ladder.
+
+    An LFO routed to the cutoff runs in here, one per lane, and moves the cutoff of both models
+    every sample instead of once per LFO update, so fast sweeps and LFO shapes stay intact.
+*/
+template <typename Type>
+class FilterBank
+{
+public:
+    using Vec = juce::dsp::SIMDRegister<Type>;
+    static constexpr size_t lanesPerGroup = Vec::SIMDNumElements;
+
+    explicit FilterBank (size_t numLanes);
+    size_t getNumLanes() const noexcept;
+
+    void prepare (double newSampleRate);
+    void reset() noexcept;
+    void reset (size_t firstLane, size_t numLanesToReset) noexcept;
+
+    void setEnabled (size_t lane, bool isEnabled) noexcept;
+    void setMode (size_t lane, juce::dsp::LadderFilterMode newMode) noexcept;
+    void setMode (size_t lane, SvfMode newMode) noexcept;
+    void setCutoffFrequencyHz (size_t lane, Type newValue) noexcept;
+    void setResonance (size_t lane, Type newValue) noexcept;
+    void setDrive (size_t lane, Type newValue) noexcept;
+
+    /** Modulates the cutoff of the lane every sample like Lfo does, from its cutoff up towards max.
+        wave is the index of the LFO wave (sine, saw, square, random), the phase keeps running */
+    void setCutoffModulation (size_t lane, size_t wave, Type frequencyHz, Type gain, Type max) noexcept;
+    void clearCutoffModulation (size_t lane) noexcept;
+    /** Draws the random modulation wave again from the stream of the calling thread, allocates */
+    void rebuildRandomWave();
+
+    /** Filter channels[n] in place as lane firstLane + n, lanes with a null channel are left alone */
+    void process (size_t firstLane, Type* const* channels, size_t numChannels, size_t numSamples) noexcept;
+
+private:
+    //==============================================================================
+    struct Group
+    {
+        std::array<Vec, 5> state;
+        std::array<Vec, 5> A;
+        Vec comp;
+        Vec cutoffTransform, cutoffTransformTarget;
+        Vec scaledResonance, scaledResonanceTarget;
+        Vec drive, gain, drive2, gain2;
+        Vec enabled;
+
+        std::array<bool, Vec::SIMDNumElements> svf{};
+        std::array<Vec, 2> svfState;
+        std::array<Vec, 4> svfMix; // gains of x, bandpass, lowpass and damping * bandpass
+        Vec svfCutoff, svfCutoffTarget;
+        Vec svfDamping, svfDampingTarget;
+
+        struct CutoffMod
+        {
+            bool active = false;
+            size_t wave = 0;
+            Type phase = 0, increment = 0; // radians, in [-pi, pi)
+            Type frequency = 0, gain = 0, max = 0;
+        };
+
+        std::array<CutoffMod, Vec::SIMDNumElements> mod{};
+        bool anyMod = false;
+    };
+
+    std::vector<Group> groups;
+    std::vector<Type> cutoffFreqHz;
+
+    juce::dsp::LookupTableTransform<Type> saturationLUT{[] (Type x) { return std::tanh (x); }, Type (-5), Type (5),
+                                                        128};
+
+    // g = tan (pi * fc / fs), over normalised cutoffs up to just below Nyquist
+    static constexpr Type maxSvfCutoff = Type (0.49);
+    juce::dsp::LookupTableTransform<Type> prewarpLUT{
+        [] (Type x) { return std::tan (juce::MathConstants<Type>::pi * x); }, Type (0), maxSvfCutoff, 4096};
+
+    // the modulation waves over a phase in [-pi, pi), the random one like the table of Lfo
+    juce::dsp::LookupTableTransform<Type> sineLUT{[] (Type x) { return std::sin (x); },
+                                                  -juce::MathConstants<Type>::pi, juce::MathConstants<Type>::pi, 512};
+    juce::dsp::LookupTableTransform<Type> randomLUT;
+
+    double sampleRate{44.1e3};
+    Type cutoffFreqScaler{Type (-2.0 * juce::MathConstants<double>::pi / 44.1e3)};
+    Type smoothingCoef{Type (1)};
+    Type invSampleRate{Type (1 / 44.1e3)};
+
+    //==============================================================================
+    Group& getGroup (size_t lane) noexcept;
+    Vec saturate (Vec input) const noexcept;
+    Type nextModulatedCutoff (typename Group::CutoffMod& m, Type base) noexcept;
+    void processLadder (Group& g, Type* const* channels, Vec laneMask, size_t numSamples) noexcept;
+    void processSvf (Group& g, Type* const* channels, Vec laneMask, size_t numSamples) noexcept;
+};
+
+//==============================================================================
+/** The FILT slot of a Chain.
+
+    It has the juce::dsp::LadderFilter interface plus the SvfMode modes, but its channels are
+    lanes of a FilterBank shared by all the chains. process() filters only this chain, while the
+    owner of the bank can filter every chain in one go with FilterBank::process().
+*/
+template <typename Type>
+class Filter
+{
+public:
+    void attach (FilterBank<Type>& newBank, size_t newFirstLane) noexcept;
+    size_t getFirstLane() const noexcept;
+
+    void setEnabled (bool isEnabled) noexcept;
+    void setMode (juce::dsp::LadderFilterMode newMode) noexcept;
+    void setMode (SvfMode newMode) noexcept;
+    void setCutoffFrequencyHz (Type newValue) noexcept;
+    void setResonance (Type newValue) noexcept;
+    void setDrive (Type newValue) noexcept;
+    void setCutoffModulation (size_t wave, Type frequencyHz, Type gain, Type max) noexcept;
+    void clearCutoffModulation() noexcept;
+
+    void prepare (const juce::dsp::ProcessSpec& spec);
+    void reset() noexcept;
+    template <typename ProcessContext>
+    void process (const ProcessContext& context) noexcept;
+
+private:
+    static constexpr size_t maxNumChannels = 2;
+
+    FilterBank<Type>* bank = nullptr;
+    size_t firstLane = 0;
+    size_t numChannels = maxNumChannels;
+};
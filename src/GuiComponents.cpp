@@ -10,11 +10,55 @@ void setComponentGraphics (juce::Graphics& g, const juce::Rectangle<int>& bounds
     g.drawRect (bounds, 1);
 }
 
+//==============================================================================
+Panel::Panel (const juce::String& panelTitle) : title (panelTitle)
+{
+    // the background covers all of it, whatever is behind doesn't have to repaint with it
+    setOpaque (true);
+}
+
+void Panel::paint (juce::Graphics& g)
+{
+    auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    auto width = juce::jmax (1, juce::roundToInt ((float)getWidth() * scale));
+    auto height = juce::jmax (1, juce::roundToInt ((float)getHeight() * scale));
+
+    if (background.getWidth() != width || background.getHeight() != height)
+    {
+        background = juce::Image (juce::Image::RGB, width, height, false);
+        juce::Graphics bg (background);
+        bg.addTransform (juce::AffineTransform::scale (scale));
+        setComponentGraphics (bg, getLocalBounds(), title);
+    }
+
+    g.drawImage (background, getLocalBounds().toFloat());
+}
+
+/** "1", "2", ... one item per chain, v being the state of any of them */
+juce::StringArray getChainSelectorItems (const juce::ValueTree& v)
+{
+    juce::StringArray items;
+
+    for (int i = 1; i <= v.getParent().getNumChildren(); ++i)
+        items.add (juce::String (i));
+
+    return items;
+}
+
+/** A slider with the range, skew and unit of the parameter */
+std::unique_ptr<SliderComp> makeParamSlider (juce::ValueTree& v, juce::UndoManager* um, const ParamId param,
+                                             const juce::String& labelText)
+{
+    const auto& spec = getSpec (param);
+    return std::make_unique<SliderComp> (v, um, getPropertyId (param), labelText, juce::Range{spec.min, spec.max}, 0.001,
+                                         spec.skew, spec.unit);
+}
+
 //==============================================================================
 ButtonsGui::ButtonsGui (const std::vector<std::function<void()>>& funcs)
 {
 
-    juce::StringArray str{"Magic", "Undo", "Redo", "!"};
+    juce::StringArray str{"Magic", "Undo", "Redo", "Save", "!"};
 
     for (unsigned i = 0; i < comps.size(); ++i)
     {
@@ -48,7 +92,7 @@ void ButtonsGui::resized()
 
 int ButtonsGui::getWidthNeeded()
 {
-    return (btn_width + btn_gap) * 3 + panic_btn_width;
+    return (btn_width + btn_gap) * 4 + panic_btn_width;
 }
 
 int ButtonsGui::getHeightNeeded()
@@ -57,33 +101,28 @@ int ButtonsGui::getHeightNeeded()
 }
 
 //==============================================================================
-OutputGui::OutputGui (juce::ValueTree& v, juce::UndoManager* um)
+OutputGui::OutputGui (juce::ValueTree& v, juce::UndoManager* um, LevelMeters& levelMeters)
+    : Panel ("Output"), meters (levelMeters)
 {
+    peak_db.fill (meter.min_db);
+    rms_db.fill (meter.min_db);
+    startTimerHz (meter.refresh_rate);
 
     for (unsigned i = 0; i < comps.size(); ++i)
     {
         if (i != 0)
         {
             auto ch_node = v.getChildWithName (IDs::Group::CHAN[i - 1]);
-            comps[i] = std::make_unique<SliderComp> (ch_node, um, IDs::gain, "Ch" + std::to_string (i),
-                                                     juce::Range{param_limits.chan_min, param_limits.chan_max}, 0.001,
-                                                     3, "dB");
+            comps[i] = makeParamSlider (ch_node, um, ParamId::CHAN_GAIN, "Ch" + std::to_string (i));
         }
         else
-            comps[i] = std::make_unique<SliderComp> (v, um, IDs::master, "Master",
-                                                     juce::Range{param_limits.master_min, param_limits.master_max},
-                                                     0.001, 1, "%");
+            comps[i] = makeParamSlider (v, um, ParamId::MASTER_GAIN, "Master");
 
         addAndMakeVisible (comps[i]->getComponent());
         addAndMakeVisible (comps[i]->label);
     }
 }
 
-void OutputGui::paint (juce::Graphics& g)
-{
-    setComponentGraphics (g, getLocalBounds(), "Output");
-}
-
 void OutputGui::resized()
 {
     auto bounds = getLocalBounds().reduced (0, gui_sizes.comp_title_font);
@@ -94,6 +133,52 @@ void OutputGui::resized()
         c->getComponent()->setTopLeftPosition (
             bounds.removeFromLeft (c->getPreferredWidth() + 2).getTopLeft().translated (0, 35));
     }
+
+    // a bar under every slider
+    meters_area = {};
+    for (size_t i = 0; i < comps.size(); ++i)
+    {
+        auto slider = comps[i]->getComponent()->getBounds();
+        meter_bounds[i] = {slider.getX() + 5, slider.getBottom() + 2, slider.getWidth() - 10, 5};
+        meters_area = meters_area.getUnion (meter_bounds[i]);
+    }
+}
+
+void OutputGui::paint (juce::Graphics& g)
+{
+    Panel::paint (g);
+
+    for (size_t i = 0; i < comps.size(); ++i)
+    {
+        auto bar = meter_bounds[i].toFloat();
+        auto toX = [&bar] (float db) { return juce::jmap (db, meter.min_db, 0.0f, bar.getX(), bar.getRight()); };
+
+        g.setColour (juce::Colours::black);
+        g.fillRect (bar);
+
+        // the rms as a bar, the peak as a tick that turns red at full scale
+        g.setColour (juce::Colours::lightgreen);
+        g.fillRect (bar.withRight (toX (rms_db[i])));
+
+        g.setColour (peak_db[i] >= 0.0f ? juce::Colours::red : juce::Colours::white);
+        g.fillRect (juce::Rectangle<float> (toX (peak_db[i]) - 1.0f, bar.getY(), 2.0f, bar.getHeight()));
+    }
+}
+
+void OutputGui::timerCallback()
+{
+    auto fall = meter.peak_fall / (float)meter.refresh_rate;
+
+    for (size_t i = 0; i < comps.size(); ++i)
+    {
+        auto reading = meters.read (i);
+        rms_db[i] = juce::jlimit (meter.min_db, 0.0f, juce::Decibels::gainToDecibels (reading.rms, meter.min_db));
+        peak_db[i] = juce::jlimit (meter.min_db, 0.0f,
+                                   juce::jmax (juce::Decibels::gainToDecibels (reading.peak, meter.min_db),
+                                               peak_db[i] - fall));
+    }
+
+    repaint (meters_area);
 }
 
 int OutputGui::getWidthNeeded()
@@ -107,10 +192,10 @@ int OutputGui::getHeightNeeded()
 }
 
 //==============================================================================
-SequencerGui::SequencerGui (juce::ValueTree& v, juce::UndoManager* um)
+SequencerGui::SequencerGui (juce::ValueTree& v, juce::UndoManager* um) : Panel ("Rand Seq")
 {
     juce::ignoreUnused (um);
-    onOff_btn.getToggleStateValue().referTo (v.getPropertyAsValue (IDs::enabled, nullptr));
+    onOff_btn.getToggleStateValue().referTo (getCoalescedValue (v, IDs::enabled, nullptr));
     addAndMakeVisible (onOff_btn);
 
     slider = std::make_unique<SliderComp> (
@@ -120,11 +205,6 @@ SequencerGui::SequencerGui (juce::ValueTree& v, juce::UndoManager* um)
     addAndMakeVisible (slider->label);
 }
 
-void SequencerGui::paint (juce::Graphics& g)
-{
-    setComponentGraphics (g, getLocalBounds(), "Rand Seq");
-}
-
 void SequencerGui::resized()
 {
     auto pos = getLocalBounds().withTrimmedTop (5).withTrimmedRight (5).getTopRight();
@@ -150,31 +230,209 @@ int SequencerGui::getHeightNeeded()
 }
 
 //==============================================================================
-OscGui::OscGui (juce::ValueTree& v, juce::ValueTree& vs, juce::UndoManager* um)
+RecordGui::RecordGui (Recorder& recorder, const juce::File& folder)
+    : Panel ("Record"), rec (recorder), rec_folder (folder)
+{
+    rec_btn.setButtonText ("Rec");
+    rec_btn.setClickingTogglesState (true);
+    rec_btn.setColour (juce::TextButton::buttonOnColourId, juce::Colours::darkred);
+    rec_btn.onClick = [this]
+    {
+        auto format = format_box.getSelectedId() == 2 ? Recorder::Format::FLAC : Recorder::Format::WAV;
+
+        if (!rec_btn.getToggleState())
+            rec.stop();
+        else if (!rec.start (rec_folder, format, chains_btn.getToggleState()))
+            rec_btn.setToggleState (false, juce::dontSendNotification);
+
+        if (rec_btn.getToggleState())
+            startTimerHz (meter.refresh_rate);
+        else
+            stopTimer();
+
+        // the files are chosen when it starts
+        chains_btn.setEnabled (!rec_btn.getToggleState());
+        format_box.setEnabled (!rec_btn.getToggleState());
+    };
+
+    chains_btn.setButtonText ("Chains");
+
+    format_box.addItemList ({"WAV", "FLAC"}, 1);
+    format_box.setSelectedId (1, juce::dontSendNotification);
+
+    dropped_label.setColour (juce::Label::textColourId, juce::Colours::orangered);
+    dropped_label.setFont (juce::Font (12.0f));
+
+    addAndMakeVisible (rec_btn);
+    addAndMakeVisible (chains_btn);
+    addAndMakeVisible (format_box);
+    addAndMakeVisible (dropped_label);
+}
+
+void RecordGui::resized()
+{
+    auto bounds = getLocalBounds().withTrimmedTop (38).reduced (10, 0);
+    rec_btn.setBounds (bounds.removeFromTop (22));
+    bounds.removeFromTop (4);
+    format_box.setBounds (bounds.removeFromTop (22));
+    bounds.removeFromTop (4);
+    chains_btn.setBounds (bounds.removeFromTop (20));
+    dropped_label.setBounds (bounds.removeFromTop (16));
+}
+
+/** The disk couldn't keep up with the samples dropped, they're missing from the files */
+void RecordGui::timerCallback()
+{
+    auto dropped = rec.getNumDropped();
+    dropped_label.setText (dropped > 0 ? "dropped " + juce::String (dropped) : juce::String(),
+                           juce::dontSendNotification);
+}
+
+int RecordGui::getWidthNeeded()
+{
+    return 100;
+}
+
+int RecordGui::getHeightNeeded()
+{
+    return 70 + 60;
+}
+
+//==============================================================================
+
+MorphGui::MorphGui (juce::ValueTree& v, juce::UndoManager* um, const std::function<void (size_t)>& capture)
+    : Panel ("Morph")
+{
+    juce::StringArray str{"A", "B"};
+
+    for (size_t i = 0; i < capture_btns.size(); ++i)
+    {
+        capture_btns[i].setButtonText (str[static_cast<int> (i)]);
+        capture_btns[i].onClick = [capture, i] { capture (i); };
+        addAndMakeVisible (capture_btns[i]);
+    }
+
+    position_slider = std::make_unique<SliderComp> (v, um, IDs::position, "A / B", juce::Range{0.0, 1.0}, 0.001);
+    time_slider = std::make_unique<SliderComp> (
+        v, um, IDs::time, "Glide", juce::Range{param_limits.morph_time_min, param_limits.morph_time_max}, 1, 0.3, "ms");
+
+    for (auto* s : {position_slider.get(), time_slider.get()})
+    {
+        addAndMakeVisible (s->getComponent());
+        addAndMakeVisible (s->label);
+    }
+}
+
+void MorphGui::resized()
+{
+    auto pos = getLocalBounds().withTrimmedTop (5).withTrimmedRight (5).getTopRight();
+    for (auto it = capture_btns.rbegin(); it != capture_btns.rend(); ++it)
+    {
+        it->setSize (btn_width, btn_height);
+        it->setTopRightPosition (pos.x, pos.y);
+        pos.x -= btn_width + 2;
+    }
+
+    auto bounds = getLocalBounds().withTrimmedTop (38);
+    for (auto* s : {position_slider.get(), time_slider.get()})
+    {
+        s->getComponent()->setSize (juce::jmin (bounds.getWidth(), s->getPreferredWidth()), s->getPreferredHeight());
+        auto centre = bounds.removeFromLeft (getWidthNeeded() / 2).getCentre();
+        s->getComponent()->setCentrePosition (centre.x, centre.y);
+    }
+}
+
+int MorphGui::getWidthNeeded()
+{
+    return 72 * 2;
+}
+
+int MorphGui::getHeightNeeded()
+{
+    return 70 + 60;
+}
+
+//==============================================================================
+
+PatternGui::PatternGui (juce::ValueTree& v, juce::UndoManager* um, const std::function<void()>& clear)
+    : Panel ("P-Locks")
+{
+    onOff_btn.getToggleStateValue().referTo (getCoalescedValue (v, IDs::enabled, nullptr));
+
+    // rec locks the parameters changed while it's on onto the step that's playing
+    rec_btn.setButtonText ("R");
+    rec_btn.setClickingTogglesState (true);
+    rec_btn.getToggleStateValue().referTo (getCoalescedValue (v, IDs::rec, nullptr));
+
+    clear_btn.setButtonText ("C");
+    clear_btn.onClick = clear;
+
+    for (auto* b : std::initializer_list<juce::Button*>{&onOff_btn, &rec_btn, &clear_btn})
+        addAndMakeVisible (b);
+
+    steps_slider = std::make_unique<SliderComp> (v, um, IDs::steps, "Steps",
+                                                 juce::Range<double>{param_limits.pattern_steps_min,
+                                                                     param_limits.pattern_steps_max},
+                                                 1);
+    time_slider = std::make_unique<SliderComp> (
+        v, um, IDs::time, "Step", juce::Range{param_limits.pattern_time_min, param_limits.pattern_time_max}, 1, 0.4,
+        "ms");
+
+    for (auto* s : {steps_slider.get(), time_slider.get()})
+    {
+        addAndMakeVisible (s->getComponent());
+        addAndMakeVisible (s->label);
+    }
+}
+
+void PatternGui::resized()
+{
+    auto pos = getLocalBounds().withTrimmedTop (5).withTrimmedRight (5).getTopRight();
+    for (auto* b : std::initializer_list<juce::Button*>{&onOff_btn, &rec_btn, &clear_btn})
+    {
+        b->setSize (btn_width, btn_height);
+        b->setTopRightPosition (pos.x, pos.y);
+        pos.x -= btn_width + 2;
+    }
+
+    auto bounds = getLocalBounds().withTrimmedTop (38);
+    for (auto* s : {steps_slider.get(), time_slider.get()})
+    {
+        s->getComponent()->setSize (juce::jmin (bounds.getWidth(), s->getPreferredWidth()), s->getPreferredHeight());
+        auto centre = bounds.removeFromLeft (getWidthNeeded() / 2).getCentre();
+        s->getComponent()->setCentrePosition (centre.x, centre.y);
+    }
+}
+
+int PatternGui::getWidthNeeded()
+{
+    return 72 * 2;
+}
+
+int PatternGui::getHeightNeeded()
+{
+    return 70 + 60;
+}
+
+//==============================================================================
+OscGui::OscGui (juce::ValueTree& v, juce::ValueTree& vs, juce::UndoManager* um) : Panel ("OSC")
 {
     unsigned i = 0;
 
-    comps[i++] = std::make_unique<ComboComp> (vs, um, IDs::selector, "", juce::StringArray{"1", "2", "3", "4"});
+    comps[i++] = std::make_unique<ComboComp> (vs, um, IDs::selector, "", getChainSelectorItems (v));
 
     comps[i++] = std::make_unique<ComboComp> (
         v, um, IDs::waveType, "", juce::StringArray{"sine", "saw", "square", "rand", "wsine", "wsaw", "wsqr"});
 
-    comps[i++] = std::make_unique<SliderComp> (
-        v, um, IDs::freq, "Freq", juce::Range{param_limits.osc_freq_min, param_limits.osc_freq_max}, 0.001, 0.4, "Hz");
+    comps[i++] = makeParamSlider (v, um, ParamId::OSC_FREQ, "Freq");
 
-    comps[i++] = std::make_unique<SliderComp> (
-        v, um, IDs::gain, "Gain", juce::Range{param_limits.osc_gain_min, param_limits.osc_gain_max}, 0.001, 3.0, "dB");
+    comps[i++] = makeParamSlider (v, um, ParamId::OSC_GAIN, "Gain");
 
-    comps[i++] = std::make_unique<SliderComp> (v, um, IDs::fm_freq, "FM freq",
-                                               juce::Range{param_limits.osc_fm_freq_min, param_limits.osc_fm_freq_max},
-                                               0.001, 1, "Hz");
+    comps[i++] = makeParamSlider (v, um, ParamId::OSC_FM_FREQ, "FM freq");
 
-    comps[i++] = std::make_unique<SliderComp> (v, um, IDs::fm_depth, "FM depth",
-                                               juce::Range{param_limits.osc_fm_depth_min, param_limits.osc_fm_depth_max},
-                                               0.001, 0.3);
+    comps[i++] = makeParamSlider (v, um, ParamId::OSC_FM_DEPTH, "FM depth");
 
-    comps[i] = std::make_unique<SliderComp> (v, um, IDs::pan, "Pan",
-                                             juce::Range{param_limits.osc_pan_min, param_limits.osc_pan_max}, 0.001, 1);
+    comps[i] = makeParamSlider (v, um, ParamId::OSC_PAN, "Pan");
 
     for (auto& c : comps)
     {
@@ -186,11 +444,6 @@ OscGui::OscGui (juce::ValueTree& v, juce::ValueTree& vs, juce::UndoManager* um)
     }
 }
 
-void OscGui::paint (juce::Graphics& g)
-{
-    setComponentGraphics (g, getLocalBounds(), "OSC");
-}
-
 void OscGui::resized()
 {
     // juce::Component a;
@@ -233,10 +486,10 @@ void OscGui::setSelector (juce::ValueTree v, juce::UndoManager* um)
             continue;
 
         if (auto slider = dynamic_cast<juce::Slider*> (c->getComponent()))
-            slider->getValueObject().referTo (v.getPropertyAsValue (c->propertie, um));
+            slider->getValueObject().referTo (getCoalescedValue (v, c->propertie, um));
 
         else if (auto comboBox = dynamic_cast<juce::ComboBox*> (c->getComponent()))
-            comboBox->getSelectedIdAsValue().referTo (v.getPropertyAsValue (c->propertie, um));
+            comboBox->getSelectedIdAsValue().referTo (getCoalescedValue (v, c->propertie, um));
     }
 }
 
@@ -251,7 +504,7 @@ int OscGui::getHeightNeeded()
 }
 
 //==============================================================================
-LfoGui::LfoGui (juce::ValueTree& v, juce::ValueTree& vs, juce::UndoManager* um)
+LfoGui::LfoGui (juce::ValueTree& v, juce::ValueTree& vs, juce::UndoManager* um) : Panel ("LFO")
 {
     size_t i = 0;
 
@@ -262,18 +515,16 @@ LfoGui::LfoGui (juce::ValueTree& v, juce::ValueTree& vs, juce::UndoManager* um)
         {"Filter", {{itemId++, "cutoff"}, {itemId++, "Reso"}, {itemId++, "Drive"}}},
     };
 
-    comps[i++] = std::make_unique<ComboComp> (vs, um, IDs::selector, "", juce::StringArray{"1", "2", "3", "4"});
+    comps[i++] = std::make_unique<ComboComp> (vs, um, IDs::selector, "", getChainSelectorItems (v));
 
     comps[i++] =
         std::make_unique<ComboComp> (v, um, IDs::waveType, "", juce::StringArray{"sine", "saw", "square", "rand"});
 
     comps[i++] = std::make_unique<PopupComp> (v, um, IDs::route, "", routing_options);
 
-    comps[i++] = std::make_unique<SliderComp> (
-        v, um, IDs::freq, "Freq", juce::Range{param_limits.lfo_freq_min, param_limits.lfo_freq_max}, 0.001, 0.6, "Hz");
+    comps[i++] = makeParamSlider (v, um, ParamId::LFO_FREQ, "Freq");
 
-    comps[i++] = std::make_unique<SliderComp> (
-        v, um, IDs::gain, "Gain", juce::Range{param_limits.lfo_gain_min, param_limits.lfo_gain_max}, 0.001, 0.3);
+    comps[i++] = makeParamSlider (v, um, ParamId::LFO_GAIN, "Gain");
 
     for (auto& c : comps)
     {
@@ -285,11 +536,6 @@ LfoGui::LfoGui (juce::ValueTree& v, juce::ValueTree& vs, juce::UndoManager* um)
     }
 }
 
-void LfoGui::paint (juce::Graphics& g)
-{
-    setComponentGraphics (g, getLocalBounds(), "LFO");
-}
-
 void LfoGui::resized()
 {
     auto boxes_bounds = getLocalBounds().withTrimmedLeft (gui_sizes.comp_title_font * 3);
@@ -342,10 +588,10 @@ void LfoGui::setSelector (juce::ValueTree v, juce::UndoManager* um)
             continue;
 
         if (auto slider = dynamic_cast<juce::Slider*> (c->getComponent()))
-            slider->getValueObject().referTo (v.getPropertyAsValue (c->propertie, um));
+            slider->getValueObject().referTo (getCoalescedValue (v, c->propertie, um));
 
         else if (auto comboBox = dynamic_cast<juce::ComboBox*> (c->getComponent()))
-            comboBox->getSelectedIdAsValue().referTo (v.getPropertyAsValue (c->propertie, um));
+            comboBox->getSelectedIdAsValue().referTo (getCoalescedValue (v, c->propertie, um));
     }
 }
 
@@ -360,7 +606,7 @@ int LfoGui::getHeightNeeded()
 }
 
 //==============================================================================
-FiltGui::FiltGui (juce::ValueTree& v, juce::ValueTree& vs, juce::UndoManager* um)
+FiltGui::FiltGui (juce::ValueTree& v, juce::ValueTree& vs, juce::UndoManager* um) : Panel ("Filter")
 {
     size_t i = 0;
 
@@ -369,21 +615,19 @@ FiltGui::FiltGui (juce::ValueTree& v, juce::ValueTree& vs, juce::UndoManager* um
         {"LP", {{itemID++, "LP12"}, {itemID++, "LP24"}}},
         {"BP", {{itemID++, "BP12"}, {itemID++, "BP24"}}},
         {"HP", {{itemID++, "HP12"}, {itemID++, "HP24"}}},
+        {"SVF",
+         {{itemID++, "SVF LP"}, {itemID++, "SVF BP"}, {itemID++, "SVF HP"}, {itemID++, "SVF Notch"}, {itemID++, "SVF Peak"}}},
     };
 
-    comps[i++] = std::make_unique<ComboComp> (vs, um, IDs::selector, "", juce::StringArray{"1", "2", "3", "4"});
+    comps[i++] = std::make_unique<ComboComp> (vs, um, IDs::selector, "", getChainSelectorItems (v));
 
     comps[i++] = std::make_unique<PopupComp> (v, um, IDs::filtType, "", popParams);
 
-    comps[i++] = std::make_unique<SliderComp> (v, um, IDs::cutOff, "Cutoff",
-                                               juce::Range{param_limits.filt_cutoff_min, param_limits.filt_cutoff_max},
-                                               0.001, 0.4, "Hz");
+    comps[i++] = makeParamSlider (v, um, ParamId::FILT_CUTOFF, "Cutoff");
 
-    comps[i++] = std::make_unique<SliderComp> (
-        v, um, IDs::reso, "Reso", juce::Range{param_limits.filt_reso_min, param_limits.filt_reso_max}, 0.001, 1);
+    comps[i++] = makeParamSlider (v, um, ParamId::FILT_RESO, "Reso");
 
-    comps[i++] = std::make_unique<SliderComp> (
-        v, um, IDs::drive, "Drive", juce::Range{param_limits.filt_drive_min, param_limits.filt_drive_max}, 0.001, 0.7);
+    comps[i++] = makeParamSlider (v, um, ParamId::FILT_DRIVE, "Drive");
 
     for (auto& c : comps)
     {
@@ -394,15 +638,10 @@ FiltGui::FiltGui (juce::ValueTree& v, juce::ValueTree& vs, juce::UndoManager* um
         addAndMakeVisible (c->getComponent());
     }
 
-    onOff_btn.getToggleStateValue().referTo (v.getPropertyAsValue (IDs::enabled, um));
+    onOff_btn.getToggleStateValue().referTo (getCoalescedValue (v, IDs::enabled, um));
     addAndMakeVisible (onOff_btn);
 }
 
-void FiltGui::paint (juce::Graphics& g)
-{
-    setComponentGraphics (g, getLocalBounds(), "Filter");
-}
-
 void FiltGui::resized()
 {
     auto boxes_bounds = getLocalBounds().withTrimmedLeft (gui_sizes.comp_title_font * 3);
@@ -443,7 +682,7 @@ void FiltGui::resized()
 void FiltGui::setSelector (juce::ValueTree v, juce::UndoManager* um)
 {
 
-    onOff_btn.getToggleStateValue().referTo (v.getPropertyAsValue (IDs::enabled, um));
+    onOff_btn.getToggleStateValue().referTo (getCoalescedValue (v, IDs::enabled, um));
 
     for (auto& c : comps)
     {
@@ -451,10 +690,10 @@ void FiltGui::setSelector (juce::ValueTree v, juce::UndoManager* um)
             continue;
 
         if (auto slider = dynamic_cast<juce::Slider*> (c->getComponent()))
-            slider->getValueObject().referTo (v.getPropertyAsValue (c->propertie, um));
+            slider->getValueObject().referTo (getCoalescedValue (v, c->propertie, um));
 
         else if (auto comboBox = dynamic_cast<juce::ComboBox*> (c->getComponent()))
-            comboBox->getSelectedIdAsValue().referTo (v.getPropertyAsValue (c->propertie, um));
+            comboBox->getSelectedIdAsValue().referTo (getCoalescedValue (v, c->propertie, um));
     }
 }
 
@@ -469,21 +708,27 @@ int FiltGui::getHeightNeeded()
 }
 
 //==============================================================================
-DelayGui::DelayGui (juce::ValueTree& v, juce::ValueTree& vs, juce::UndoManager* um)
+DelayGui::DelayGui (juce::ValueTree& v, juce::ValueTree& vs, juce::UndoManager* um) : Panel ("DELAY")
 {
     unsigned i = 0;
 
-    comps[i++] = std::make_unique<ComboComp> (vs, um, IDs::selector, "", juce::StringArray{"1", "2", "3", "4"});
+    comps[i++] = std::make_unique<ComboComp> (vs, um, IDs::selector, "", getChainSelectorItems (v));
+
+    comps[i++] = makeParamSlider (v, um, ParamId::DEL_MIX, "Dry/wet");
+
+    comps[i++] = makeParamSlider (v, um, ParamId::DEL_TIME, "Time");
+
+    comps[i++] = makeParamSlider (v, um, ParamId::DEL_FEEDBACK, "Feedback");
+
+    comps[i++] = makeParamSlider (v, um, ParamId::DEL_DAMPING, "Damp");
 
-    comps[i++] = std::make_unique<SliderComp> (
-        v, um, IDs::mix, "Dry/wet", juce::Range{param_limits.delay_mix_min, param_limits.delay_mix_max}, 0.001, 1);
+    comps[i++] = makeParamSlider (v, um, ParamId::DEL_LOWCUT, "Low cut");
 
-    comps[i++] = std::make_unique<SliderComp> (
-        v, um, IDs::time, "Time", juce::Range{param_limits.delay_time_min, param_limits.delay_time_max}, 0.001, 1);
+    comps[i++] = std::make_unique<ComboComp> (v, um, IDs::taps, "",
+                                              juce::StringArray{"1 tap", "2 taps", "3 taps", "4 taps", "5 taps",
+                                                                "6 taps", "7 taps", "8 taps"});
 
-    comps[i++] = std::make_unique<SliderComp> (
-        v, um, IDs::feedback, "Feedback", juce::Range{param_limits.delay_feedback_min, param_limits.delay_feedback_max},
-        0.001, 1);
+    comps[i++] = makeParamSlider (v, um, ParamId::DEL_SPREAD, "Spread");
 
     for (auto& c : comps)
     {
@@ -493,11 +738,9 @@ DelayGui::DelayGui (juce::ValueTree& v, juce::ValueTree& vs, juce::UndoManager*
         addAndMakeVisible (c->label);
         addAndMakeVisible (c->getComponent());
     }
-}
 
-void DelayGui::paint (juce::Graphics& g)
-{
-    setComponentGraphics (g, getLocalBounds(), "DELAY");
+    pingPong_btn.getToggleStateValue().referTo (getCoalescedValue (v, IDs::pingPong, um));
+    addAndMakeVisible (pingPong_btn);
 }
 
 void DelayGui::resized()
@@ -507,6 +750,10 @@ void DelayGui::resized()
     auto slider_bounds = getLocalBounds().removeFromTop (5);
     int slider_xGap = 10;
 
+    auto btn_pos = getLocalBounds().withTrimmedTop (5).withTrimmedRight (5).getTopRight();
+    pingPong_btn.setSize (btn_width, btn_height);
+    pingPong_btn.setTopRightPosition (btn_pos.x, btn_pos.y);
+
     for (auto& c : comps)
     {
         if (c == nullptr)
@@ -520,6 +767,14 @@ void DelayGui::resized()
             continue;
         }
 
+        if (c->propertie == IDs::taps)
+        {
+            c->getComponent()->setSize (juce::jmin (boxes_bounds.getWidth(), c->getPreferredWidth()),
+                                        c->getPreferredHeight());
+            c->getComponent()->setTopLeftPosition (boxes_bounds.removeFromLeft (c->getPreferredWidth()).getTopLeft());
+            continue;
+        }
+
         c->getComponent()->setSize (juce::jmin (slider_bounds.getWidth(), c->getPreferredWidth()), c->getPreferredHeight());
         slider_bounds.removeFromLeft (slider_xGap);
         c->getComponent()->setTopLeftPosition (
@@ -529,22 +784,101 @@ void DelayGui::resized()
 
 void DelayGui::setSelector (juce::ValueTree v, juce::UndoManager* um)
 {
+    pingPong_btn.getToggleStateValue().referTo (getCoalescedValue (v, IDs::pingPong, um));
+
     for (auto& c : comps)
     {
         if (c->propertie == IDs::selector)
             continue;
 
         if (auto slider = dynamic_cast<juce::Slider*> (c->getComponent()))
-            slider->getValueObject().referTo (v.getPropertyAsValue (c->propertie, um));
+            slider->getValueObject().referTo (getCoalescedValue (v, c->propertie, um));
+
+        else if (auto comboBox = dynamic_cast<juce::ComboBox*> (c->getComponent()))
+            comboBox->getSelectedIdAsValue().referTo (getCoalescedValue (v, c->propertie, um));
     }
 }
 
 int DelayGui::getWidthNeeded()
 {
-    return 72 * 3 + 30;
+    return 72 * 6 + 60;
 }
 
 int DelayGui::getHeightNeeded()
 {
     return 70 + 60 + 15;
 }
+
+//==============================================================================
+ReverbGui::ReverbGui (juce::ValueTree& v, juce::ValueTree& vs, juce::UndoManager* um) : Panel ("REVERB")
+{
+    unsigned i = 0;
+
+    comps[i++] = std::make_unique<ComboComp> (vs, um, IDs::selector, "", getChainSelectorItems (v));
+
+    comps[i++] = makeParamSlider (v, um, ParamId::REV_MIX, "Dry/wet");
+
+    comps[i++] = makeParamSlider (v, um, ParamId::REV_SIZE, "Size");
+
+    comps[i++] = makeParamSlider (v, um, ParamId::REV_DECAY, "Decay");
+
+    comps[i++] = makeParamSlider (v, um, ParamId::REV_DAMPING, "Damp");
+
+    for (auto& c : comps)
+    {
+        if (c == nullptr)
+            continue;
+
+        addAndMakeVisible (c->label);
+        addAndMakeVisible (c->getComponent());
+    }
+}
+
+void ReverbGui::resized()
+{
+    auto boxes_bounds = getLocalBounds().withTrimmedLeft (gui_sizes.comp_title_font * 5);
+    boxes_bounds.removeFromTop (5);
+    auto slider_bounds = getLocalBounds().removeFromTop (5);
+    int slider_xGap = 10;
+
+    for (auto& c : comps)
+    {
+        if (c == nullptr)
+            continue;
+
+        if (c->propertie == IDs::selector)
+        {
+            c->getComponent()->setSize (juce::jmin (boxes_bounds.getWidth(), gui_sizes.selector_box_width),
+                                        c->getPreferredHeight());
+            c->getComponent()->setTopLeftPosition (boxes_bounds.removeFromLeft (gui_sizes.selector_box_width).getTopLeft());
+            continue;
+        }
+
+        c->getComponent()->setSize (juce::jmin (slider_bounds.getWidth(), c->getPreferredWidth()), c->getPreferredHeight());
+        slider_bounds.removeFromLeft (slider_xGap);
+        c->getComponent()->setTopLeftPosition (
+            slider_bounds.removeFromLeft (c->getPreferredWidth()).getTopLeft().translated (0, 35 + 30));
+    }
+}
+
+void ReverbGui::setSelector (juce::ValueTree v, juce::UndoManager* um)
+{
+    for (auto& c : comps)
+    {
+        if (c->propertie == IDs::selector)
+            continue;
+
+        if (auto slider = dynamic_cast<juce::Slider*> (c->getComponent()))
+            slider->getValueObject().referTo (getCoalescedValue (v, c->propertie, um));
+    }
+}
+
+int ReverbGui::getWidthNeeded()
+{
+    return 72 * 4 + 40;
+}
+
+int ReverbGui::getHeightNeeded()
+{
+    return 70 + 60 + 15;
+}
@@ -2,6 +2,9 @@
 
 #include "ComponentWrappers.h"
 #include "Constants.h"
+#include "Meters.h"
+#include "Parameters.h"
+#include "Recorder.h"
 #include <JuceHeader.h>
 #include <array>
 #include <functional>
@@ -9,6 +12,25 @@
 // Helpers
 //==============================================================================
 void setComponentGraphics (juce::Graphics& g, const juce::Rectangle<int>& bounds, const juce::String& text);
+juce::StringArray getChainSelectorItems (const juce::ValueTree& v);
+std::unique_ptr<SliderComp> makeParamSlider (juce::ValueTree& v, juce::UndoManager* um, const ParamId param,
+                                             const juce::String& labelText);
+
+//==============================================================================
+/** A panel of the GUI. The frame and the title are drawn once per size into an image, the controls
+    repainting on top of it only cost a copy of the area under them */
+class Panel : public juce::Component
+{
+public:
+    explicit Panel (const juce::String& panelTitle);
+    void paint (juce::Graphics& g) override;
+
+private:
+    juce::String title;
+    juce::Image background;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Panel)
+};
 
 //==============================================================================
 class ButtonsGui : public juce::Component
@@ -24,17 +46,18 @@ private:
     int btn_gap = 5;
     int btn_width = 50, btn_height = 20;
     int panic_btn_width = 20;
-    static constexpr int NUM_OF_COMPONENTS = 4;
+    static constexpr int NUM_OF_COMPONENTS = 5;
     std::array<std::unique_ptr<juce::TextButton>, NUM_OF_COMPONENTS> comps;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ButtonsGui)
 };
 
 //==============================================================================
-class OutputGui : public juce::Component
+class OutputGui : public Panel, private juce::Timer
 {
 public:
-    OutputGui (juce::ValueTree& v, juce::UndoManager* um);
+    /** The master and the first chains, each with a level meter under its gain */
+    OutputGui (juce::ValueTree& v, juce::UndoManager* um, LevelMeters& levelMeters);
     void paint (juce::Graphics& g) override;
     void resized() override;
     int getWidthNeeded();
@@ -44,15 +67,21 @@ private:
     static constexpr int NUM_OF_COMPONENTS = 5;
     std::array<std::unique_ptr<SliderComp>, NUM_OF_COMPONENTS> comps;
 
+    LevelMeters& meters;
+    std::array<juce::Rectangle<int>, NUM_OF_COMPONENTS> meter_bounds;
+    std::array<float, NUM_OF_COMPONENTS> peak_db, rms_db; // what's drawn
+    juce::Rectangle<int> meters_area;
+
+    void timerCallback() override;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OutputGui)
 };
 
 //==============================================================================
-class SequencerGui : public juce::Component
+class SequencerGui : public Panel
 {
 public:
     SequencerGui (juce::ValueTree& v, juce::UndoManager* um);
-    void paint (juce::Graphics& g) override;
     void resized() override;
     int getWidthNeeded();
     int getHeightNeeded();
@@ -66,11 +95,73 @@ private:
 };
 
 //==============================================================================
-class OscGui : public juce::Component
+class RecordGui : public Panel, private juce::Timer
+{
+public:
+    /** Starts and stops recorder, the files go to folder. Shows the samples dropped while recording */
+    RecordGui (Recorder& recorder, const juce::File& folder);
+    void resized() override;
+    int getWidthNeeded();
+    int getHeightNeeded();
+
+private:
+    Recorder& rec;
+    juce::File rec_folder;
+
+    juce::TextButton rec_btn;
+    juce::ToggleButton chains_btn;
+    juce::ComboBox format_box;
+    juce::Label dropped_label;
+
+    void timerCallback() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RecordGui)
+};
+
+//==============================================================================
+class MorphGui : public Panel
+{
+public:
+    /** capture is called with 0 for A and 1 for B */
+    MorphGui (juce::ValueTree& v, juce::UndoManager* um, const std::function<void (size_t)>& capture);
+    void resized() override;
+    int getWidthNeeded();
+    int getHeightNeeded();
+
+private:
+    std::array<juce::TextButton, 2> capture_btns;
+    std::unique_ptr<SliderComp> position_slider;
+    std::unique_ptr<SliderComp> time_slider;
+    int btn_width = 25, btn_height = 20;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MorphGui)
+};
+
+//==============================================================================
+class PatternGui : public Panel
+{
+public:
+    /** clear is called by the clear button, the pattern itself isn't in the tree */
+    PatternGui (juce::ValueTree& v, juce::UndoManager* um, const std::function<void()>& clear);
+    void resized() override;
+    int getWidthNeeded();
+    int getHeightNeeded();
+
+private:
+    juce::ToggleButton onOff_btn;
+    juce::TextButton rec_btn, clear_btn;
+    std::unique_ptr<SliderComp> steps_slider;
+    std::unique_ptr<SliderComp> time_slider;
+    int btn_width = 25, btn_height = 20;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PatternGui)
+};
+
+//==============================================================================
+class OscGui : public Panel
 {
 public:
     OscGui (juce::ValueTree& v, juce::ValueTree& vs, juce::UndoManager* um);
-    void paint (juce::Graphics& g) override;
     void resized() override;
     void setSelector (juce::ValueTree v, juce::UndoManager* um);
     int getWidthNeeded();
@@ -84,11 +175,10 @@ private:
 };
 
 //==============================================================================
-class LfoGui : public juce::Component
+class LfoGui : public Panel
 {
 public:
     LfoGui (juce::ValueTree& v, juce::ValueTree& vs, juce::UndoManager* um);
-    void paint (juce::Graphics& g) override;
     void resized() override;
     void setSelector (juce::ValueTree v, juce::UndoManager* um);
     int getWidthNeeded();
@@ -102,11 +192,10 @@ private:
 };
 
 //==============================================================================
-class FiltGui : public juce::Component
+class FiltGui : public Panel
 {
 public:
     FiltGui (juce::ValueTree& v, juce::ValueTree& vs, juce::UndoManager* um);
-    void paint (juce::Graphics& g) override;
     void resized() override;
     void setSelector (juce::ValueTree v, juce::UndoManager* um);
     int getWidthNeeded();
@@ -122,19 +211,37 @@ private:
 };
 
 //==============================================================================
-class DelayGui : public juce::Component
+class DelayGui : public Panel
 {
 public:
     DelayGui (juce::ValueTree& v, juce::ValueTree& vs, juce::UndoManager* um);
-    void paint (juce::Graphics& g) override;
     void resized() override;
     void setSelector (juce::ValueTree v, juce::UndoManager* um);
     int getWidthNeeded();
     int getHeightNeeded();
 
 private:
-    static constexpr int NUM_OF_COMPONENTS = 4;
+    static constexpr int NUM_OF_COMPONENTS = 8;
+    juce::ToggleButton pingPong_btn{"Ping-pong"};
+    int btn_width = 90, btn_height = 20;
     std::array<std::unique_ptr<BaseComp>, NUM_OF_COMPONENTS> comps;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DelayGui)
 };
+
+//==============================================================================
+class ReverbGui : public Panel
+{
+public:
+    ReverbGui (juce::ValueTree& v, juce::ValueTree& vs, juce::UndoManager* um);
+    void resized() override;
+    void setSelector (juce::ValueTree v, juce::UndoManager* um);
+    int getWidthNeeded();
+    int getHeightNeeded();
+
+private:
+    static constexpr int NUM_OF_COMPONENTS = 5;
+    std::array<std::unique_ptr<BaseComp>, NUM_OF_COMPONENTS> comps;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReverbGui)
+};
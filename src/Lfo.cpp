@@ -1,63 +1,49 @@
 #include "Lfo.h"
 #include "Constants.h"
+#include "Random.h"
 
 template <typename Type>
-Lfo<Type>::Lfo (std::unique_ptr<Chain>& _chain, const size_t _id, const juce::ValueTree& _state)
-    : chain (_chain), chain_id (_id), state (_state)
+Lfo<Type>::Lfo (Chain& _chain, const ParamValues& _values) : chain (_chain), values (_values)
 {
-    setLfoRoute (IDs::OSC, IDs::freq, param_limits.osc_freq_max);
+    waves[0].initialise ([] (Type x) { return std::sin (x); });
+    waves[1].initialise ([] (Type x) { return x / juce::MathConstants<Type>::pi; });
+    waves[2].initialise ([] (Type x) { return x < 0.0f ? -1.0f : 1.0f; });
+    rebuildRandomWave();
+
+    setRoute (2); // osc freq
 }
 
 template <typename Type>
-void Lfo<Type>::setWaveType (const WaveType choice)
+void Lfo<Type>::rebuildRandomWave()
 {
-    switch (choice)
-    {
-    case WaveType::SIN:
-        lfo.initialise ([] (Type x) { return std::sin (x); });
-        return;
-
-    case WaveType::SAW:
-        lfo.initialise ([] (Type x) { return x / juce::MathConstants<Type>::pi; });
-        return;
-
-    case WaveType::SQR:
-        lfo.initialise ([] (Type x) { return x < 0.0f ? -1.0f : 1.0f; });
-        return;
-
-    case WaveType::RAND:
-        lfo.initialise (
-            [] (Type x)
-            {
-                juce::ignoreUnused (x);
-                static std::random_device rd;
-                static std::mt19937 gen (rd());
-                static std::uniform_real_distribution<Type> dist (-1.0f, 1.0f);
-                return dist (gen);
-            },
-            2048);
-        return;
+    waves[3].initialise (
+        [] (Type x)
+        {
+            juce::ignoreUnused (x);
+            return (Type)Rng::forThread().uniform (-1.0f, 1.0f);
+        },
+        2048);
+}
 
-    case WaveType::WSIN:
-    case WaveType::WSAW:
-    case WaveType::WSQR:
-    default:
-        lfo.initialise ([] (Type x) { return std::sin (x); });
-        return;
-    }
+template <typename Type>
+void Lfo<Type>::setWaveType (const WaveType choice)
+{
+    auto idx = static_cast<size_t> (choice) - 1;
+    wave = idx < waves.size() ? idx : 0;
+    waves[wave].setFrequency (frequency, true);
 }
 
 template <typename Type>
 void Lfo<Type>::setFrequency (const Type newValue)
 {
     frequency = newValue;
-    lfo.setFrequency (newValue);
+    waves[wave].setFrequency (newValue);
 }
 
 template <typename Type>
 Type Lfo<Type>::getFrequency() const
 {
-    return lfo.getFrequency();
+    return frequency;
 }
 
 template <typename Type>
@@ -74,118 +60,88 @@ Type Lfo<Type>::getGain() const
 }
 
 template <typename Type>
-void Lfo<Type>::setComp (const juce::Identifier& comp_type)
+typename Lfo<Type>::Setter Lfo<Type>::getSetter (const ParamId param)
 {
-    if (comp_state.isValid())
-        comp_state.sendPropertyChangeMessage (prop);
-
-    comp_state = state.getChildWithName (comp_type).getChild (chain_id);
+    switch (param)
+    {
+    case ParamId::CHAN_GAIN:
+        return [] (Chain& c, Type v) { c.get<ProcIdx::CHAN_GAIN>().setGainDecibels (v); };
+    case ParamId::OSC_FREQ:
+        return [] (Chain& c, Type v) { c.get<ProcIdx::OSC>().setBaseFrequency (v); };
+    case ParamId::OSC_GAIN:
+        return [] (Chain& c, Type v) { c.get<ProcIdx::OSC>().setGainDecibels (v); };
+    case ParamId::OSC_FM_FREQ:
+        return [] (Chain& c, Type v) { c.get<ProcIdx::OSC>().setFmFreq (v); };
+    case ParamId::OSC_FM_DEPTH:
+        return [] (Chain& c, Type v) { c.get<ProcIdx::OSC>().setFmDepth (v); };
+    case ParamId::FILT_CUTOFF:
+        return [] (Chain& c, Type v) { c.get<ProcIdx::FILT>().setCutoffFrequencyHz (v); };
+    case ParamId::FILT_RESO:
+        return [] (Chain& c, Type v) { c.get<ProcIdx::FILT>().setResonance (v); };
+    case ParamId::FILT_DRIVE:
+        return [] (Chain& c, Type v) { c.get<ProcIdx::FILT>().setDrive (v); };
+    default:
+        return nullptr;
+    }
 }
 
 template <typename Type>
-void Lfo<Type>::setProp (const juce::Identifier& _prop, Type _max)
+void Lfo<Type>::setRoute (const size_t route)
 {
-    prop = _prop;
-    max = _max;
-
-    if (comp_state.getParent().getType() == IDs::OUTPUT_GAIN)
-    {
-        if (prop == IDs::gain)
-        {
-            chain_func = std::bind (&juce::dsp::Gain<Type>::setGainDecibels, &chain->get<ProcIdx::CHAN_GAIN>(),
-                                    std::placeholders::_1);
-            return;
-        }
-    }
+    if (target == ParamId::FILT_CUTOFF)
+        chain.get<ProcIdx::FILT>().clearCutoffModulation();
 
-    if (comp_state.getParent().getType() == IDs::OSC)
-    {
-        if (prop == IDs::gain)
-        {
-            chain_func = std::bind (&Osc<Type>::setGainDecibels, &chain->get<ProcIdx::OSC>(), std::placeholders::_1);
-            return;
-        }
-
-        if (prop == IDs::freq)
-        {
-            chain_func = std::bind (&Osc<Type>::setBaseFrequency, &chain->get<ProcIdx::OSC>(), std::placeholders::_1);
-            return;
-        }
+    if (setter != nullptr)
+        setter (chain, values[target]);
 
-        if (prop == IDs::fm_freq)
-        {
-            chain_func = std::bind (&Osc<Type>::setFmFreq, &chain->get<ProcIdx::OSC>(), std::placeholders::_1);
-            return;
-        }
-
-        if (prop == IDs::fm_depth)
-        {
-            chain_func = std::bind (&Osc<Type>::setFmDepth, &chain->get<ProcIdx::OSC>(), std::placeholders::_1);
-            return;
-        }
-    }
-
-    if (comp_state.getParent().getType() == IDs::FILT)
+    if (route < 1 || route > lfo_routes.size())
     {
-        if (prop == IDs::cutOff)
-        {
-            chain_func = std::bind (&juce::dsp::LadderFilter<Type>::setCutoffFrequencyHz, &chain->get<ProcIdx::FILT>(),
-                                    std::placeholders::_1);
-            return;
-        }
-
-        if (prop == IDs::reso)
-        {
-            chain_func = std::bind (&juce::dsp::LadderFilter<Type>::setResonance, &chain->get<ProcIdx::FILT>(),
-                                    std::placeholders::_1);
-            return;
-        }
-
-        if (prop == IDs::drive)
-        {
-            chain_func =
-                std::bind (&juce::dsp::LadderFilter<Type>::setDrive, &chain->get<ProcIdx::FILT>(), std::placeholders::_1);
-            return;
-        }
+        target = ParamId::NUM_PARAMS;
+        setter = nullptr;
+        return;
     }
-}
 
-template <typename Type>
-void Lfo<Type>::setLfoRoute (const juce::Identifier& comp_type, const juce::Identifier& _prop, Type _max)
-{
-    setComp (comp_type);
-    setProp (_prop, _max);
-
-    if (prop == IDs::gain)
-        mod_func = [this]() { return juce::jmap (lfo_val, -1.f, 1.f, 0.f, -1 * cur + max); };
-    else
-        mod_func = [this]() { return juce::jmap (lfo_val, -1.f, 1.f, 0.f, cur_max); };
+    target = lfo_routes[route - 1].param;
+    max = static_cast<Type> (lfo_routes[route - 1].limit);
+    setter = getSetter (target);
 }
 
 template <typename Type>
 void Lfo<Type>::reset() noexcept
 {
-    lfo.reset();
+    waves[wave].reset();
 }
 
 template <typename Type>
 void Lfo<Type>::process()
 {
-    lfo_val = lfo.processSample (0.0f);
-    cur = comp_state.getProperty (prop);
-    cur_max = max - cur;
+    Type lfo_val = waves[wave].processSample (0.0f);
 
-    Type mod = getFrequency() != 0 ? mod_func() : 0;
+    if (setter == nullptr)
+        return;
 
-    chain_func (cur + mod * gain);
+    // the filter bank runs its own copy of this LFO on the cutoff, every sample
+    if (target == ParamId::FILT_CUTOFF)
+    {
+        chain.get<ProcIdx::FILT>().setCutoffModulation (wave, frequency, gain, max);
+        return;
+    }
+
+    Type cur = values[target];
+    Type mod = frequency != 0 ? juce::jmap (lfo_val, Type (-1), Type (1), Type (0), max - cur) : 0;
+
+    setter (chain, cur + mod * gain);
 }
 
 template <typename Type>
 void Lfo<Type>::prepare (const juce::dsp::ProcessSpec& spec)
 {
-    setWaveType (WaveType::SIN);
+    for (auto& w : waves)
+        w.prepare (spec);
+
+    wave = 0;
+    frequency = 0;
     gain = 0;
-    lfo.prepare (spec);
 }
 
 template class Lfo<float>;
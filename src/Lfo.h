@@ -3,17 +3,20 @@
 #include "Chain.h"
 #include "Constants.h"
 #include "Osc.h"
+#include "Parameters.h"
 #include <JuceHeader.h>
-#include <functional>
-#include <random>
+#include <array>
 
 template <typename Type>
 class Lfo
 {
 public:
-    Lfo (std::unique_ptr<Chain>& _chain, const size_t _id, const juce::ValueTree& _state);
+    /** values are the last parameter values applied to the chain, the LFO modulates around them */
+    Lfo (Chain& _chain, const ParamValues& _values);
 
     void setWaveType (const WaveType choice);
+    /** Draws the random wave again from the stream of the calling thread, allocates */
+    void rebuildRandomWave();
 
     void setFrequency (const Type newValue);
     Type getFrequency() const;
@@ -21,30 +24,33 @@ public:
     void setGain (const Type newValue);
     Type getGain() const;
 
-    void setComp (const juce::Identifier& comp_type);
-    void setProp (const juce::Identifier& _prop, Type _max);
-    void setLfoRoute (const juce::Identifier& comp_type, const juce::Identifier& _prop, Type _max);
+    /** Index into lfo_routes plus one, anything else leaves the LFO unrouted.
+        The previous target is put back to its unmodulated value first.
+    */
+    void setRoute (const size_t route);
 
     void reset() noexcept;
     void process();
     void prepare (const juce::dsp::ProcessSpec& spec);
 
 private:
-    juce::dsp::Oscillator<Type> lfo;
+    using Setter = void (*) (Chain&, Type);
+    static Setter getSetter (const ParamId param);
 
-    Type frequency;
-    Type gain;
+    // the LFO only uses the first waves, the wavetable types fall back to a sine
+    static constexpr size_t numWaves = WaveType::RAND;
+    std::array<juce::dsp::Oscillator<Type>, numWaves> waves;
+    size_t wave = 0;
 
-    std::unique_ptr<Chain>& chain;
-    std::function<void (const Type)> chain_func;
+    Type frequency = 0;
+    Type gain = 0;
 
-    const size_t chain_id;
-    juce::ValueTree state;
-    juce::ValueTree comp_state;
-    juce::Identifier prop;
+    Chain& chain;
+    const ParamValues& values;
 
-    Type lfo_val, cur, cur_max, max;
-    std::function<const Type()> mod_func;
+    ParamId target = ParamId::NUM_PARAMS;
+    Setter setter = nullptr;
+    Type max = 0;
 
     Lfo (const Lfo&) = delete;
     Lfo& operator= (const Lfo&) = delete;
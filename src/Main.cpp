@@ -6,9 +6,84 @@
   ==============================================================================
 */
 
+#include "BatchRenderer.h"
 #include "MainComponent.h"
 #include <JuceHeader.h>
 
+namespace
+{
+/** The value of --name=value, quotes allowed around it */
+juce::String getOption (const juce::String& commandLine, const juce::String& name)
+{
+    for (auto& token : juce::StringArray::fromTokens (commandLine, true))
+        if (token.startsWith ("--" + name + "="))
+            return token.fromFirstOccurrenceOf ("=", false, false).unquoted();
+
+    return {};
+}
+
+/** Whether --name is one of the arguments on its own */
+bool hasFlag (const juce::String& commandLine, const juce::String& name)
+{
+    return juce::StringArray::fromTokens (commandLine, true).contains ("--" + name);
+}
+
+/** --render=<folder> renders every patch in it and quits, see the README for the other options */
+bool renderPatches (const juce::String& commandLine)
+{
+    BatchRenderer::Options options;
+    options.source = juce::File::getCurrentWorkingDirectory().getChildFile (getOption (commandLine, "render"));
+
+    auto out = getOption (commandLine, "out");
+    options.destination = out.isNotEmpty() ? juce::File::getCurrentWorkingDirectory().getChildFile (out)
+                                           : options.source.getChildFile ("renders");
+
+    if (auto length = getOption (commandLine, "length").getDoubleValue(); length > 0)
+        options.length = length;
+
+    if (auto rate = getOption (commandLine, "rate").getDoubleValue(); rate > 0)
+        options.sampleRate = juce::jmin (rate, MAX_SAMPLE_RATE);
+
+    options.stems = hasFlag (commandLine, "stems");
+
+    BatchRenderer renderer (options);
+    if (renderer.getPatches().isEmpty())
+    {
+        juce::Logger::writeToLog ("No patches (*.xml) in " + options.source.getFullPathName());
+        return false;
+    }
+
+    auto report = renderer.run ((size_t)juce::jmax (0, getOption (commandLine, "workers").getIntValue()));
+
+    // the same batch again on one thread, as the reference for the speedup
+    std::unique_ptr<BatchRenderer::Report> single;
+    if (hasFlag (commandLine, "baseline"))
+        single = std::make_unique<BatchRenderer::Report> (renderer.run (1));
+
+    juce::Logger::writeToLog (BatchRenderer::describe (report, single.get()));
+    for (auto& name : report.failed)
+        juce::Logger::writeToLog ("failed: " + name);
+
+    return report.failed.isEmpty();
+}
+
+#if JUCE_UNIT_TESTS
+/** --test runs the tests of the project, --bench the benchmarks, both print to the log */
+bool runTests (const juce::String& category)
+{
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure (false);
+    runner.runTestsInCategory (category);
+
+    for (int i = 0; i < runner.getNumResults(); ++i)
+        if (runner.getResult (i)->failures > 0)
+            return false;
+
+    return true;
+}
+#endif
+} // namespace
+
 //==============================================================================
 class OneButtonKillerApplication : public juce::JUCEApplication
 {
@@ -35,10 +110,42 @@ public:
     void initialise (const juce::String& commandLine) override
     {
         // This method is where you should put your application's initialisation code..
-        juce::ignoreUnused (commandLine);
-        state = createDefaultTree();
-        selectors_state = createSelectorsTree();
-        mainWindow.reset (new MainWindow (getApplicationName(), state, selectors_state));
+        auto num_chains = getOption (commandLine, "chains").getIntValue();
+        if (num_chains <= 0)
+            num_chains = DEFAULT_NUM_CHAINS;
+
+        num_chains = juce::jlimit (1, MAX_NUM_CHAINS, num_chains);
+
+        // one worker per core at most, the audio thread keeps one for itself
+        auto workers = getOption (commandLine, "audio-workers");
+        auto num_audio_workers = workers.isNotEmpty() ? workers.getIntValue() : DEFAULT_NUM_AUDIO_WORKERS;
+        num_audio_workers = juce::jlimit (0, juce::jmax (0, juce::SystemStats::getNumCpus() - 1), num_audio_workers);
+
+        // the same seed gives the same random waves and the same run of patches
+        auto seed = getOption (commandLine, "seed");
+        if (seed.isNotEmpty())
+            Rng::setGlobalSeed ((std::uint64_t)seed.getLargeIntValue());
+
+        if (getOption (commandLine, "render").isNotEmpty())
+        {
+            setApplicationReturnValue (renderPatches (commandLine) ? 0 : 1);
+            quit();
+            return;
+        }
+
+#if JUCE_UNIT_TESTS
+        if (hasFlag (commandLine, "test") || hasFlag (commandLine, "bench"))
+        {
+            auto category = hasFlag (commandLine, "bench") ? "Benchmarks" : "OneButtonKiller";
+            setApplicationReturnValue (runTests (category) ? 0 : 1);
+            quit();
+            return;
+        }
+#endif
+
+        state = createDefaultTree ((size_t)num_chains);
+        selectors_state = createSelectorsTree ((size_t)num_chains);
+        mainWindow.reset (new MainWindow (getApplicationName(), state, selectors_state, (size_t)num_audio_workers));
     }
 
     void shutdown() override
@@ -72,14 +179,14 @@ public:
     class MainWindow : public juce::DocumentWindow
     {
     public:
-        MainWindow (juce::String name, juce::ValueTree state, juce::ValueTree selectors_state)
+        MainWindow (juce::String name, juce::ValueTree state, juce::ValueTree selectors_state, size_t numAudioWorkers)
             : DocumentWindow (name,
                               juce::Desktop::getInstance().getDefaultLookAndFeel().findColour (
                                   juce::ResizableWindow::backgroundColourId),
                               DocumentWindow::allButtons)
         {
             setUsingNativeTitleBar (true);
-            setContentOwned (new MainComponent (state, selectors_state), true);
+            setContentOwned (new MainComponent (state, selectors_state, numAudioWorkers), true);
 
 #if JUCE_IOS || JUCE_ANDROID
             setFullScreen (true);
@@ -1,16 +1,113 @@
 #include "MainComponent.h"
 
+namespace
+{
+size_t getNumChains (const juce::ValueTree& st)
+{
+    return (size_t)st.getChildWithName (IDs::OSC).getNumChildren();
+}
+
+/** A value drawn from range, clamped to the spec range so a range can never push it out */
+float drawRandomValue (Rng& rng, const ParamSpec& spec, const RandomRange& range) noexcept
+{
+    auto min = juce::jlimit (spec.min, spec.max, range.min);
+    auto max = juce::jlimit (spec.min, spec.max, range.max);
+
+    switch (spec.kind)
+    {
+    case ParamKind::TOGGLE:
+        return rng.chance ((float)max) ? 1.0f : 0.0f;
+
+    case ParamKind::CHOICE:
+    {
+        // one item less to draw from, everything from skip on moves up by one
+        auto skip = (int)range.skip;
+        auto skipped = skip >= (int)min && skip <= (int)max ? 1 : 0;
+        auto item = rng.uniformInt ((int)min, (int)max - skipped);
+        return (float)(skipped != 0 && item >= skip ? item + 1 : item);
+    }
+
+    case ParamKind::REAL:
+    default:
+        return rng.uniform ((float)min, (float)max);
+    }
+}
+
+void clearValues (std::vector<ParamValues>& values)
+{
+    // NaN never compares equal, so the next value of every parameter gets sent
+    for (auto& v : values)
+        v.values.fill (std::numeric_limits<float>::quiet_NaN());
+}
+} // namespace
+
 //==============================================================================
-MainComponent::MainComponent (juce::ValueTree st, juce::ValueTree selectors_st)
-    : seq ([this]() { generateRandomParameters(); }), state (st), selectors_state (selectors_st), gen (rd()), rand (gen)
+MainComponent::MainComponent (juce::ValueTree st, juce::ValueTree selectors_st, size_t numAudioWorkers)
+    : filter_bank (getNumChains (st) * 2), chains (getNumChains (st)), level_meters (getNumChains (st) + 1),
+      recorder (getNumChains (st) + 1), param_values (getNumChains (st)), message_values (getNumChains (st)),
+      lfo (getNumChains (st)), seq ([this]() { updateSequence(); }), state (st), selectors_state (selectors_st),
+      rng (Rng::createStream())
 // adsc (deviceManager, 0, NUM_INPUT_CHANNELS, 0, NUM_OUTPUT_CHANNELS, false, false, true, false)
 {
+    jassert (chains.size() > 0 && chains.size() <= MAX_NUM_CHAINS);
+
+    targets.reserve (chains.size());
+
     for (size_t i = 0; i < chains.size(); i++)
     {
         chains[i] = std::make_unique<Chain>();
-        lfo[i] = std::make_unique<Lfo<float>> (chains[i], i, st);
+        chains[i]->get<ProcIdx::FILT>().attach (filter_bank, i * 2);
+        lfo[i] = std::make_unique<Lfo<float>> (*chains[i], param_values[i]);
+        targets.push_back ({*chains[i], *lfo[i]});
+    }
+
+    block_commands.reserve (command_queue.getCapacity());
+    pattern_commands.reserve (2 * StepPattern::max_locks);
+    screener = std::make_unique<PatchScreener> (chains.size(), screening.num_workers);
+    clearValues (message_values);
+    played_backlog.reserve (sequence_played.getCapacity());
+
+    size_t delay_arena_size = 0;
+    for (auto& chain : chains)
+    {
+        delay_arena_size += chain->get<ProcIdx::DEL>().getArenaSize (MAX_SAMPLE_RATE);
+        delay_arena_size += chain->get<ProcIdx::REV>().getArenaSize (MAX_SAMPLE_RATE);
+    }
+
+    delay_arena.allocate (delay_arena_size);
+    for (auto& chain : chains)
+    {
+        chain->get<ProcIdx::DEL>().setStorage (delay_arena, MAX_SAMPLE_RATE);
+        chain->get<ProcIdx::REV>().setStorage (delay_arena, MAX_SAMPLE_RATE);
+    }
+
+    std::vector<Chain*> routed_chains;
+    for (auto& chain : chains)
+        routed_chains.push_back (chain.get());
+
+    routing = std::make_unique<RoutingProcessor> (routed_chains, filter_bank);
+    routing->addTap (&scope_analyser);
+    routing->addTap (&level_meters);
+    routing->addTap (&recorder);
+
+    if (numAudioWorkers > 0)
+    {
+        worker_pool = std::make_unique<WorkerPool> (numAudioWorkers);
+        routing->setWorkerPool (worker_pool.get());
     }
 
+    // a routing saved as routing.xml in the user folder replaces the default one
+    auto routing_file = getUserFolder().getChildFile ("routing.xml");
+    if (routing_file.existsAsFile())
+    {
+        auto xml = juce::parseXML (routing_file);
+        auto graph = xml != nullptr ? RoutingGraph::fromValueTree (juce::ValueTree::fromXml (*xml)) : RoutingGraph();
+
+        if (graph.getNumNodes() == 0 || !setRoutingGraph (graph))
+            juce::Logger::writeToLog ("Ignored the routing in " + routing_file.getFullPathName());
+    }
+
+
     // Some platforms require permissions to open input channels so request that here
     if (juce::RuntimePermissions::isRequired (juce::RuntimePermissions::recordAudio)
         && !juce::RuntimePermissions::isGranted (juce::RuntimePermissions::recordAudio))
@@ -23,7 +120,10 @@ MainComponent::MainComponent (juce::ValueTree st, juce::ValueTree selectors_st)
         setAudioChannels (NUM_INPUT_CHANNELS, NUM_OUTPUT_CHANNELS);
     }
 
-    jassert (NUM_OUTPUT_CHANNELS == deviceManager.getAudioDeviceSetup().outputChannels.countNumberOfSetBits());
+
+    // every MIDI input there is, through the collector
+    for (const auto& input : juce::MidiInput::getAvailableDevices())
+        deviceManager.setMidiInputDeviceEnabled (input.identifier, true);
 
     addKeyListener (this);
     initGuiComponents (state, selectors_st);
@@ -32,8 +132,8 @@ MainComponent::MainComponent (juce::ValueTree st, juce::ValueTree selectors_st)
     int main_comp_width = 0, main_comp_height = 0;
     for (size_t i = 0; i < osc_comp.size(); i++)
     {
-        main_comp_width +=
-            std::max ({getComponentWidth (osc_comp[i]), getComponentWidth (lfo_comp[i]), getComponentWidth (del_comp[i])});
+        main_comp_width += std::max ({getComponentWidth (osc_comp[i]), getComponentWidth (lfo_comp[i]),
+                                      getComponentWidth (del_comp[i]), getComponentWidth (rev_comp[i])});
     }
 
     main_comp_height += getComponentHeight (btn_comp) + gui_sizes.yGap_top;
@@ -42,6 +142,11 @@ MainComponent::MainComponent (juce::ValueTree st, juce::ValueTree selectors_st)
     main_comp_height += getComponentHeight (filt_comp.back()) + gui_sizes.yGap_between_components;
     main_comp_height += getComponentHeight (lfo_comp.back()) + gui_sizes.yGap_between_components;
     main_comp_height += getComponentHeight (del_comp.back()) + gui_sizes.yGap_between_components;
+    main_comp_height += getComponentHeight (rev_comp.back()) + gui_sizes.yGap_between_components;
+    main_comp_height += getComponentHeight (scope_comp) + gui_sizes.yGap_between_components;
+
+    updateBuilderBase();
+    patch_builder.startThread();
 
     setSize (main_comp_width + 30, main_comp_height + 15);
 }
@@ -50,7 +155,24 @@ MainComponent::~MainComponent()
 {
     // This shuts down the audio device and clears the audio source.
     removeKeyListener (this);
+    deviceManager.removeMidiInputDeviceCallback ({}, this);
+    patch_builder.stopThread (4000);
     shutdownAudio();
+
+    delete pending_patch.exchange (nullptr);
+    delete retired_patch.exchange (nullptr);
+    delete pending_morph.exchange (nullptr);
+    delete retired_morph.exchange (nullptr);
+    delete active_morph;
+    delete dip.patch;
+
+    Patch* patch = nullptr;
+    while (sequence_ready.pop (patch))
+        delete patch;
+    while (sequence_played.pop (patch))
+        delete patch;
+    for (auto* played : played_backlog)
+        delete played;
 }
 
 //==============================================================================
@@ -62,6 +184,32 @@ void MainComponent::prepareToPlay (int samplesPerBlockExpected, double sampleRat
     spec.maximumBlockSize = static_cast<juce::uint32> (samplesPerBlockExpected);
     spec.numChannels = 2;
 
+    filter_bank.prepare (sampleRate);
+    routing->prepare (spec);
+    patch_fade_samples = static_cast<juce::uint32> (sampleRate * def_params.patch_fade_time);
+    seq.prepare (sampleRate);
+    pattern.prepare (sampleRate);
+    sample_rate = sampleRate;
+    midi_collector.reset (sampleRate);
+    // only once the collector has the rate, registered again on every restart but never twice
+    deviceManager.removeMidiInputDeviceCallback ({}, this);
+    deviceManager.addMidiInputDeviceCallback ({}, this);
+    scope_analyser.prepare (sampleRate);
+    level_meters.prepare (sampleRate);
+    recorder.prepare (sampleRate);
+    midi_note = -1;
+
+    // the chains are spread over the output pairs the device actually has
+    auto* device = deviceManager.getCurrentAudioDevice();
+    auto num_outputs = device != nullptr ? device->getActiveOutputChannels().countNumberOfSetBits() : NUM_OUTPUT_CHANNELS;
+
+    output_latency = device != nullptr ? device->getOutputLatencyInSamples() : 0;
+
+    if (!custom_routing)
+        routing_graph = RoutingGraph::createDefault (chains.size(), (size_t)juce::jmax (1, num_outputs / 2));
+
+    routing->setPlan (routing_graph.compile (RoutingProcessor::maxNumNodes));
+
     jassert (chains.size() == lfo.size());
     for (size_t i = 0; i < chains.size(); i++)
     {
@@ -70,18 +218,183 @@ void MainComponent::prepareToPlay (int samplesPerBlockExpected, double sampleRat
     }
 
     oscOff();
+    // preparing put the processors back to their own defaults
+    clearValues (message_values);
     setDefaultParameterValues();
 }
 
 void MainComponent::getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill)
 {
+    if (reset_pending.exchange (false))
+        for (auto& chain : chains)
+            chain->reset();
+
+    auto numSamples = static_cast<juce::uint32> (bufferToFill.numSamples);
+    // it's heard after the block the device is playing now, and the device adds its own latency
+    block_heard = juce::Time::getMillisecondCounterHiRes() * 0.001 + (numSamples + output_latency) / sample_rate;
+    drainCommands (numSamples);
+    recorder.update();
+
+    // what arrived during the last block, at the same positions
+    midi_block.clear();
+    midi_collector.removeNextBlockOfMessages (midi_block, bufferToFill.numSamples);
+
+    // a patch from the randomize button dips at the top of the block. Only take it when the previous one
+    // has been collected, so there's never more than one to hand back
+    if (dip.stage == Dip::NONE && pending_patch.load() != nullptr && retired_patch.load() == nullptr)
+        startDip (pending_patch.exchange (nullptr), false, false);
+
+    // a morph switching a discrete parameter swaps at the silent point of a dip, the running one if it
+    // hasn't got there yet. One that's fading in waits for it to end, a morph without switches goes right away
+    if (!updateMorph (numSamples))
+        applyMorph();
+    else if (dip.stage == Dip::NONE)
+        startDip (nullptr, false, true);
+    else if (dip.stage == Dip::OUT)
+        dip.morph = true;
+
+    // a step that's due waits for the dip in progress, into the next block if it has to
+    auto step_at = seq.advance (numSamples);
+    if (step_at < numSamples)
+        step_pending = true;
+    else if (step_pending)
+        step_at = 0;
+
+    // the p-lock steps don't wait for anything
+    auto lock_at = pattern.advance (numSamples);
+
+    // render up to the offset of each command, step and dip stage, so every change lands on its own sample
+    auto next = block_commands.cbegin();
+    auto next_midi = midi_block.cbegin();
+    juce::uint32 pos = 0;
+
+    while (true)
+    {
+        for (; next != block_commands.cend() && next->sampleOffset <= pos; ++next)
+            applyParam (*next);
+
+        for (; next_midi != midi_block.cend() && (juce::uint32)(*next_midi).samplePosition <= pos; ++next_midi)
+            applyMidi ((*next_midi).getMessage(), pos);
+
+        if (lock_at < numSamples && pos >= lock_at)
+        {
+            pattern.step (param_values, pattern_commands);
+            for (const auto& command : pattern_commands)
+            {
+                applyParam (command);
+                reportParam (command);
+            }
+
+            lock_at = numSamples;
+        }
+
+        if (step_pending && pos >= step_at && dip.stage == Dip::NONE)
+        {
+            step_pending = false;
+
+            // the builder didn't keep up, this step is skipped
+            Patch* patch = nullptr;
+            if (sequence_ready.pop (patch))
+                startDip (patch, true, false);
+
+            // refill the lookahead. It's a short lock in the event, only contended while the builder goes to sleep
+            patch_builder.notify();
+        }
+
+        while (dip.stage != Dip::NONE && dip.done == dip.length)
+            advanceDip();
+
+        if (pos == numSamples)
+            break;
+
+        auto end = next != block_commands.cend() ? next->sampleOffset : numSamples;
+
+        if (step_pending && step_at > pos)
+            end = juce::jmin (end, step_at);
+
+        end = juce::jmin (end, lock_at);
+
+        if (next_midi != midi_block.cend())
+            end = juce::jmin (end, (juce::uint32)juce::jmax (0, (*next_midi).samplePosition));
+
+        if (dip.stage != Dip::NONE)
+            end = juce::jmin (end, pos + dip.length - dip.done);
+
+        auto start = bufferToFill.startSample + (int)pos;
+        renderSegment (*bufferToFill.buffer, start, (int)(end - pos));
+
+        if (dip.stage != Dip::NONE)
+        {
+            auto from = (float)dip.done / (float)dip.length;
+            dip.done += end - pos;
+            auto to = (float)dip.done / (float)dip.length;
+
+            if (dip.stage == Dip::OUT)
+                bufferToFill.buffer->applyGainRamp (start, (int)(end - pos), 1.0f - from, 1.0f - to);
+            else
+                bufferToFill.buffer->applyGainRamp (start, (int)(end - pos), from, to);
+        }
+
+        pos = end;
+    }
+}
+
+void MainComponent::startDip (Patch* patch, const bool sequenced, const bool morph) noexcept
+{
+    dip = {Dip::OUT, 0, patch_fade_samples, patch, sequenced, morph};
+}
 
-    juce::dsp::AudioBlock<float> audioBlock{*bufferToFill.buffer};
+void MainComponent::advanceDip() noexcept
+{
+    if (dip.stage == Dip::IN)
+    {
+        dip.stage = Dip::NONE;
+        return;
+    }
 
-    for (size_t i = 0, j = 0; i < audio_blocks.size(); ++i, j += 2)
-        audio_blocks[i] = audioBlock.getSubsetChannelBlock (j, 2);
+    // silent: swap every parameter at once and fade the new sound in
+    if (dip.patch != nullptr)
+    {
+        applyPatch (*dip.patch);
+
+        // the message thread updates the GUI with the played ones and frees them. The builder empties
+        // sequence_played at every step and only builds lookahead steps ahead, so it never fills up
+        if (!dip.sequenced)
+            retired_patch.store (dip.patch);
+        else if (sequence_played.push (dip.patch))
+            patch_builder.notify();
+        else
+            jassertfalse;
+    }
+
+    if (dip.morph)
+        applyMorph();
+
+    dip = {Dip::IN, 0, dip.length, nullptr, false, false};
+}
+
+void MainComponent::drainCommands (const juce::uint32 numSamples) noexcept
+{
+    block_commands.clear();
 
-    for (auto samp = 0; samp < bufferToFill.numSamples; ++samp)
+    // whatever doesn't fit stays in the queue for the next block
+    ParamCommand command;
+    while (block_commands.size() < block_commands.capacity() && command_queue.pop (command))
+    {
+        // there's no lookahead, anything later than this block is applied at its end
+        command.sampleOffset = juce::jmin (command.sampleOffset, numSamples);
+
+        // insertion sort, upper_bound keeps the commands of the same sample in the order they were pushed
+        auto pos = std::upper_bound (block_commands.begin(), block_commands.end(), command,
+                                     [] (const ParamCommand& a, const ParamCommand& b)
+                                     { return a.sampleOffset < b.sampleOffset; });
+        block_commands.insert (pos, command);
+    }
+}
+
+void MainComponent::renderSegment (juce::AudioBuffer<float>& buffer, const int startSample, const int numSamples) noexcept
+{
+    for (auto samp = 0; samp < numSamples; ++samp)
     {
         if (lfoUpdateCounter == 0)
         {
@@ -92,10 +405,7 @@ void MainComponent::getNextAudioBlock (const juce::AudioSourceChannelInfo& buffe
         --lfoUpdateCounter;
     }
 
-    jassert (chains.size() == audio_blocks.size());
-
-    for (size_t i = 0; i < chains.size(); i++)
-        chains[i]->process (juce::dsp::ProcessContextReplacing<float> (audio_blocks[i]));
+    routing->process (buffer, startSample, numSamples);
 }
 
 void MainComponent::releaseResources()
@@ -135,59 +445,53 @@ void MainComponent::changeListenerCallback (juce::ChangeBroadcaster* source)
     auto comp = dynamic_cast<Broadcaster*> (source);
     auto comp_state = comp->getState();
     auto comp_type = comp_state.getParent().getType();
-    auto comp_id = comp_state.getType();
     auto prop = comp->propertie;
 
-    if (prop == IDs::master)
+    if (comp_type == IDs::SEQUENCER)
     {
-        setParam (0, IDs::OUTPUT_GAIN, prop, comp_state[prop]);
+        setParam (comp_type, prop, comp_state[prop]);
         return;
     }
 
-    if (comp_type == IDs::SEQUENCER)
+    if (comp_state.getType() == IDs::MORPH || comp_state.getType() == IDs::PATTERN)
     {
-        setParam (0, comp_type, prop, comp_state[prop]);
+        setParam (comp_state.getType(), prop, comp_state[prop]);
         return;
     }
 
     size_t idx = static_cast<size_t> (comp_state.getParent().indexOf (comp_state));
 
-    if (comp_type == IDs::OUTPUT_GAIN || comp_type == IDs::OSC || comp_type == IDs::LFO || comp_type == IDs::FILT
-        || comp_type == IDs::DELAY)
-    {
-        setParam (idx, comp_type, prop, comp_state[prop]);
-        return;
-    }
-
     if (prop == IDs::selector)
     {
         int state_idx = static_cast<int> (comp_state[prop]) - 1;
 
         if (comp_type == IDs::OSC_GUI)
         {
-            osc_comp[idx]->setSelector (state.getChildWithName (IDs::OSC).getChild (state_idx),
-                                        undoManager.getManagerPtr());
+            osc_comp[idx]->setSelector (state.getChildWithName (IDs::OSC).getChild (state_idx), nullptr);
             return;
         }
 
         if (comp_type == IDs::LFO_GUI)
         {
-            lfo_comp[idx]->setSelector (state.getChildWithName (IDs::LFO).getChild (state_idx),
-                                        undoManager.getManagerPtr());
+            lfo_comp[idx]->setSelector (state.getChildWithName (IDs::LFO).getChild (state_idx), nullptr);
             return;
         }
 
         if (comp_type == IDs::FILT_GUI)
         {
-            filt_comp[idx]->setSelector (state.getChildWithName (IDs::FILT).getChild (state_idx),
-                                         undoManager.getManagerPtr());
+            filt_comp[idx]->setSelector (state.getChildWithName (IDs::FILT).getChild (state_idx), nullptr);
             return;
         }
 
         if (comp_type == IDs::DELAY_GUI)
         {
-            del_comp[idx]->setSelector (state.getChildWithName (IDs::DELAY).getChild (state_idx),
-                                        undoManager.getManagerPtr());
+            del_comp[idx]->setSelector (state.getChildWithName (IDs::DELAY).getChild (state_idx), nullptr);
+            return;
+        }
+
+        if (comp_type == IDs::REVERB_GUI)
+        {
+            rev_comp[idx]->setSelector (state.getChildWithName (IDs::REVERB).getChild (state_idx), nullptr);
             return;
         }
     }
@@ -197,9 +501,10 @@ void MainComponent::initGuiComponents (const juce::ValueTree& v, const juce::Val
 {
     // clang-format off
     std::vector<std::function<void()>> btn_funcs { [this] { generateRandomParameters(); },
-                                                   [this] { undoManager.undo(); },
-                                                   [this] { undoManager.redo(); },
-                                                   [this] { releaseResources(); }
+                                                   [this] { undo(); },
+                                                   [this] { redo(); },
+                                                   [this] { saveCurrentPatch(); },
+                                                   [this] { reset_pending.store (true); }
     };
     // clang-format on
 
@@ -207,121 +512,105 @@ void MainComponent::initGuiComponents (const juce::ValueTree& v, const juce::Val
     if (btn_comp.get() != nullptr)
         addAndMakeVisible (btn_comp.get());
 
+    // no juce::UndoManager on the tree, the parameter changes are recorded by undoManager as they're sent
     auto output_state = v.getChildWithName (IDs::OUTPUT_GAIN);
-    output_comp = std::make_unique<OutputGui> (output_state, undoManager.getManagerPtr());
+    output_comp = std::make_unique<OutputGui> (output_state, nullptr, level_meters);
     if (output_comp.get() != nullptr)
         addAndMakeVisible (output_comp.get());
 
     auto seq_state = v.getChildWithName (IDs::SEQUENCER).getChildWithName (IDs::SEQ1);
-    seq_comp = std::make_unique<SequencerGui> (seq_state, undoManager.getManagerPtr());
+    seq_comp = std::make_unique<SequencerGui> (seq_state, nullptr);
     if (seq_comp.get() != nullptr)
         addAndMakeVisible (seq_comp.get());
 
+    auto morph_state = v.getChildWithName (IDs::MORPH);
+    morph_comp = std::make_unique<MorphGui> (morph_state, nullptr, [this] (size_t slot) { captureMorph (slot); });
+    if (morph_comp.get() != nullptr)
+        addAndMakeVisible (morph_comp.get());
+
+    auto pattern_state = v.getChildWithName (IDs::PATTERN);
+    pattern_comp = std::make_unique<PatternGui> (pattern_state, nullptr,
+                                                 [this]
+                                                 {
+                                                     pattern_edit.clear();
+                                                     pattern.setPattern (pattern_edit);
+                                                 });
+    if (pattern_comp.get() != nullptr)
+        addAndMakeVisible (pattern_comp.get());
+
+    record_comp = std::make_unique<RecordGui> (recorder, getUserFolder());
+    if (record_comp.get() != nullptr)
+        addAndMakeVisible (record_comp.get());
+
+    scope_comp = std::make_unique<ScopeGui> (scope_analyser, chains.size());
+    if (scope_comp.get() != nullptr)
+        addAndMakeVisible (scope_comp.get());
+
     for (size_t i = 0; i < osc_comp.size(); i++)
     {
-        auto osc_state = v.getChildWithName (IDs::OSC).getChildWithName (IDs::Group::OSC[i]);
         auto osc_selector_state = vs.getChildWithName (IDs::OSC_GUI).getChildWithName (IDs::Group::OSC[i]);
+        auto osc_state = v.getChildWithName (IDs::OSC).getChild ((int)osc_selector_state[IDs::selector] - 1);
 
-        osc_comp[i] = std::make_unique<OscGui> (osc_state, osc_selector_state, undoManager.getManagerPtr());
+        osc_comp[i] = std::make_unique<OscGui> (osc_state, osc_selector_state, nullptr);
         if (osc_comp[i].get() != nullptr)
             addAndMakeVisible (osc_comp[i].get());
 
-        auto lfo_state = v.getChildWithName (IDs::LFO).getChildWithName (IDs::Group::LFO[i]);
         auto lfo_selector_state = vs.getChildWithName (IDs::LFO_GUI).getChildWithName (IDs::Group::LFO[i]);
+        auto lfo_state = v.getChildWithName (IDs::LFO).getChild ((int)lfo_selector_state[IDs::selector] - 1);
 
-        lfo_comp[i] = std::make_unique<LfoGui> (lfo_state, lfo_selector_state, undoManager.getManagerPtr());
+        lfo_comp[i] = std::make_unique<LfoGui> (lfo_state, lfo_selector_state, nullptr);
         if (lfo_comp[i].get() != nullptr)
             addAndMakeVisible (lfo_comp[i].get());
 
-        auto filt_state = v.getChildWithName (IDs::FILT).getChildWithName (IDs::Group::FILT[i]);
         auto filt_selector_state = vs.getChildWithName (IDs::FILT_GUI).getChildWithName (IDs::Group::FILT[i]);
+        auto filt_state = v.getChildWithName (IDs::FILT).getChild ((int)filt_selector_state[IDs::selector] - 1);
 
-        filt_comp[i] = std::make_unique<FiltGui> (filt_state, filt_selector_state, undoManager.getManagerPtr());
+        filt_comp[i] = std::make_unique<FiltGui> (filt_state, filt_selector_state, nullptr);
         if (filt_comp[i].get() != nullptr)
             addAndMakeVisible (filt_comp[i].get());
 
-        auto del_state = v.getChildWithName (IDs::DELAY).getChildWithName (IDs::Group::DELAY[i]);
         auto del_selector_state = vs.getChildWithName (IDs::DELAY_GUI).getChildWithName (IDs::Group::DELAY[i]);
+        auto del_state = v.getChildWithName (IDs::DELAY).getChild ((int)del_selector_state[IDs::selector] - 1);
 
-        del_comp[i] = std::make_unique<DelayGui> (del_state, del_selector_state, undoManager.getManagerPtr());
+        del_comp[i] = std::make_unique<DelayGui> (del_state, del_selector_state, nullptr);
         if (del_comp[i].get() != nullptr)
             addAndMakeVisible (del_comp[i].get());
-    }
-}
-
-void MainComponent::setLfoRoute (const size_t lfo_idx, const size_t val)
-{
-    struct RouteParameters
-    {
-        const juce::Identifier& comp;
-        const juce::Identifier& prop;
-        const double limit;
-    };
-
-    size_t itemId = 1;
-    static const std::map<size_t, RouteParameters> rp{
-        // ch
-        {itemId++, {IDs::OUTPUT_GAIN, IDs::gain, param_limits.chan_min}},
-        // osc
-        {itemId++, {IDs::OSC, IDs::freq, param_limits.osc_freq_max}},
-        {itemId++, {IDs::OSC, IDs::gain, param_limits.osc_gain_min}},
-        {itemId++, {IDs::OSC, IDs::fm_freq, param_limits.osc_fm_freq_max}},
-        {itemId++, {IDs::OSC, IDs::fm_depth, param_limits.osc_fm_depth_max}},
-        // filter
-        {itemId++, {IDs::FILT, IDs::cutOff, param_limits.filt_cutoff_max}},
-        {itemId++, {IDs::FILT, IDs::reso, param_limits.filt_reso_max}},
-        {itemId++, {IDs::FILT, IDs::drive, param_limits.filt_drive_max}}
-        //
-    };
-
-    if (val > rp.size() || lfo_idx > lfo.size())
-        return;
 
-    const auto& opt = rp.at (val);
+        auto rev_selector_state = vs.getChildWithName (IDs::REVERB_GUI).getChildWithName (IDs::Group::REVERB[i]);
+        auto rev_state = v.getChildWithName (IDs::REVERB).getChild ((int)rev_selector_state[IDs::selector] - 1);
 
-    lfo[lfo_idx]->setLfoRoute (opt.comp, opt.prop, opt.limit);
+        rev_comp[i] = std::make_unique<ReverbGui> (rev_state, rev_selector_state, nullptr);
+        if (rev_comp[i].get() != nullptr)
+            addAndMakeVisible (rev_comp[i].get());
+    }
 }
 
 void MainComponent::initBroadcasters (const juce::ValueTree& v, const juce::ValueTree& vs)
 {
-
-    broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::OUTPUT_GAIN), IDs::master));
-
     broadcasters.push_back (
         std::make_unique<Broadcaster> (v.getChildWithName (IDs::SEQUENCER).getChildWithName (IDs::SEQ1), IDs::enabled));
     broadcasters.push_back (
         std::make_unique<Broadcaster> (v.getChildWithName (IDs::SEQUENCER).getChildWithName (IDs::SEQ1), IDs::time));
+    broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::MORPH), IDs::position));
+    broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::MORPH), IDs::time));
 
-    for (size_t i = 0; i < NUM_OUTPUT_CHANNELS / 2; i++)
-    {
-        broadcasters.push_back (
-            std::make_unique<Broadcaster> (v.getChildWithName (IDs::OUTPUT_GAIN).getChild (i), IDs::gain));
-
-        broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::OSC).getChild (i), IDs::waveType));
-        broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::OSC).getChild (i), IDs::freq));
-        broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::OSC).getChild (i), IDs::gain));
-        broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::OSC).getChild (i), IDs::fm_freq));
-        broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::OSC).getChild (i), IDs::fm_depth));
-        broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::OSC).getChild (i), IDs::pan));
-
-        broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::LFO).getChild (i), IDs::waveType));
-        broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::LFO).getChild (i), IDs::freq));
-        broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::LFO).getChild (i), IDs::gain));
-        broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::LFO).getChild (i), IDs::route));
+    for (const auto& prop : {IDs::enabled, IDs::rec, IDs::steps, IDs::time})
+        broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::PATTERN), prop));
 
-        broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::FILT).getChild (i), IDs::enabled));
-        broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::FILT).getChild (i), IDs::filtType));
-        broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::FILT).getChild (i), IDs::cutOff));
-        broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::FILT).getChild (i), IDs::reso));
-        broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::FILT).getChild (i), IDs::drive));
+    // one listener per module node, the master and the channels share one
+    for (size_t m = 0; m < (size_t)Module::NUM_MODULES; ++m)
+    {
+        const auto& id = getModuleId (static_cast<Module> (m));
+        if (m > 0 && id == getModuleId (static_cast<Module> (m - 1)))
+            continue;
 
-        broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::DELAY).getChild (i), IDs::mix));
-        broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::DELAY).getChild (i), IDs::time));
-        broadcasters.push_back (std::make_unique<Broadcaster> (v.getChildWithName (IDs::DELAY).getChild (i), IDs::feedback));
+        param_listeners.push_back (std::make_unique<ParamListener> (
+            v.getChildWithName (id),
+            [this] (size_t chain, ParamId param, const juce::var& value) { sendParam (chain, param, value); }));
     }
 
     // selectros broadcasters
-    for (size_t i = 0; i < NUM_OUTPUT_CHANNELS / 4; ++i)
+    for (size_t i = 0; i < NUM_CHAIN_PANELS; ++i)
     {
         broadcasters.push_back (std::make_unique<Broadcaster> (
             vs.getChildWithName (IDs::OSC_GUI).getChildWithName (IDs::Group::OSC[i]), IDs::selector));
@@ -331,6 +620,8 @@ void MainComponent::initBroadcasters (const juce::ValueTree& v, const juce::Valu
             vs.getChildWithName (IDs::FILT_GUI).getChildWithName (IDs::Group::FILT[i]), IDs::selector));
         broadcasters.push_back (std::make_unique<Broadcaster> (
             vs.getChildWithName (IDs::DELAY_GUI).getChildWithName (IDs::Group::DELAY[i]), IDs::selector));
+        broadcasters.push_back (std::make_unique<Broadcaster> (
+            vs.getChildWithName (IDs::REVERB_GUI).getChildWithName (IDs::Group::REVERB[i]), IDs::selector));
     }
 
     for (auto& b : broadcasters)
@@ -345,30 +636,14 @@ juce::var MainComponent::getStateParamValue (const juce::ValueTree& v, const juc
 }
 
 template <typename T>
-void MainComponent::setParam (const size_t idx, const juce::Identifier& comp_type, const juce::Identifier& propertie, T val)
+void MainComponent::setParam (const juce::Identifier& comp_type, const juce::Identifier& propertie, T val)
 {
-
-    if (idx > chains.size())
-        return;
-
-    if (propertie == IDs::master)
-    {
-        for (auto& chain : chains)
-            chain->get<ProcIdx::MASTER_GAIN>().setGainLinear (val);
-        return;
-    }
-
-    if (comp_type == IDs::OUTPUT_GAIN)
-    {
-        chains[idx]->get<ProcIdx::CHAN_GAIN>().setGainDecibels (val);
-        return;
-    }
-
     if (comp_type == IDs::SEQUENCER)
     {
         if (propertie == IDs::enabled)
         {
             seq.setEnabled (val);
+            patch_builder.notify();
             return;
         }
 
@@ -379,315 +654,567 @@ void MainComponent::setParam (const size_t idx, const juce::Identifier& comp_typ
         }
     }
 
-    if (comp_type == IDs::OSC)
+    if (comp_type == IDs::MORPH)
     {
+        if (propertie == IDs::position)
+            morph_target.store (juce::jlimit (0.0f, 1.0f, static_cast<float> (val)));
 
-        if (propertie == IDs::waveType)
-        {
-            chains[idx]->get<ProcIdx::OSC>().setWaveType (static_cast<WaveType> ((int)val));
-            return;
-        }
-
-        if (propertie == IDs::freq)
-        {
-            chains[idx]->get<ProcIdx::OSC>().setBaseFrequency (val);
-            return;
-        }
+        if (propertie == IDs::time)
+            morph_time.store (static_cast<float> (val) / 1000.0f);
+    }
 
-        if (propertie == IDs::gain)
-        {
-            chains[idx]->get<ProcIdx::OSC>().setGainDecibels (val);
-            return;
-        }
+    if (comp_type == IDs::PATTERN)
+    {
+        if (propertie == IDs::enabled)
+            pattern.clock.setEnabled (val);
 
-        if (propertie == IDs::fm_freq)
-        {
-            chains[idx]->get<ProcIdx::OSC>().setFmFreq (val);
-            return;
-        }
+        if (propertie == IDs::rec)
+            pattern_recording = val;
 
-        if (propertie == IDs::fm_depth)
-        {
-            chains[idx]->get<ProcIdx::OSC>().setFmDepth (val);
-            return;
-        }
+        if (propertie == IDs::time)
+            pattern.clock.setTime (val);
 
-        if (propertie == IDs::pan)
+        if (propertie == IDs::steps)
         {
-            chains[idx]->get<ProcIdx::OSC>().setPanner (val);
-            return;
+            pattern_edit.setNumSteps (static_cast<size_t> (static_cast<int> (val)));
+            pattern.setPattern (pattern_edit);
         }
     }
+}
+
+void MainComponent::sendParam (const size_t idx, const ParamId param, const float val)
+{
+    // a change the audio thread already has, like the tree echoing a committed patch
+    if (idx >= chains.size() || param == ParamId::NUM_PARAMS || message_values[idx][param] == val)
+        return;
+
+    // the first value of a parameter (NaN before it) isn't something to undo
+    auto before = message_values[idx][param];
+    if (!restoring && !std::isnan (before))
+        undoManager.record (idx, param, before, val);
+
+    // with rec on, a change is also locked on the step that's playing
+    if (pattern_recording && pattern.clock.isEnabled() && !restoring
+        && pattern_edit.setLock (pattern.getPlayingStep(), {static_cast<juce::uint16> (idx), param, val}))
+        pattern.setPattern (pattern_edit);
+
+    pushParam (idx, param, val);
+}
+
+juce::ValueTree MainComponent::getParamNode (const size_t idx, const ParamId param) const
+{
+    auto node = state.getChildWithName (getModuleId (getSpec (param).module));
+    return isPerChain (param) ? node.getChild ((int)idx) : node;
+}
+
+void MainComponent::restoreParam (const size_t idx, const ParamId param, const float val)
+{
+    // through the tree, so the GUI follows, and from there to sendParam
+    getParamNode (idx, param).setProperty (getPropertyId (param), toVar (param, val), nullptr);
+}
 
-    if (comp_type == IDs::FILT)
+void MainComponent::undo()
+{
+    const juce::ScopedValueSetter<bool> svs (restoring, true);
+    undoManager.undo ([this] (size_t idx, ParamId param, float val) { restoreParam (idx, param, val); });
+}
+
+void MainComponent::redo()
+{
+    const juce::ScopedValueSetter<bool> svs (restoring, true);
+    undoManager.redo ([this] (size_t idx, ParamId param, float val) { restoreParam (idx, param, val); });
+}
+
+bool MainComponent::setRoutingGraph (const RoutingGraph& graph)
+{
+    auto plan = graph.compile (RoutingProcessor::maxNumNodes);
+    if (plan == nullptr)
+        return false;
+
+    routing_graph = graph;
+    custom_routing = true;
+    routing->setPlan (std::move (plan));
+    return true;
+}
+
+void MainComponent::saveCurrentPatch()
+{
+    auto name = juce::Time::getCurrentTime().formatted ("%Y-%m-%d_%H-%M-%S");
+    auto file = getUserFolder().getChildFile ("Patches").getChildFile (name).withFileExtension ("xml");
+
+    if (!savePatch (state, file))
+        juce::Logger::writeToLog ("Couldn't save the patch to " + file.getFullPathName());
+}
+
+void MainComponent::pushParam (const size_t idx, const ParamId param, const float val, const juce::uint32 sampleOffset)
+{
+    auto pushed = command_queue.push ({sampleOffset, static_cast<juce::uint16> (idx), param, val});
+    message_values[idx][param] = val;
+
+    // the audio thread isn't draining the queue, or it's too small for a whole randomize
+    jassert (pushed);
+    juce::ignoreUnused (pushed);
+}
+
+void MainComponent::applyParam (const ParamCommand& command) noexcept
+{
+    if (command.chain >= chains.size() || command.param == ParamId::NUM_PARAMS)
+        return;
+
+    param_values[command.chain][command.param] = command.value;
+
+    const auto& spec = getSpec (command.param);
+
+    if (isPerChain (command.param))
     {
+        spec.apply (targets[command.chain], command.value);
+        return;
+    }
 
-        if (propertie == IDs::enabled)
-        {
-            chains[idx]->get<ProcIdx::FILT>().setEnabled (val);
-            return;
-        }
+    for (auto& target : targets)
+        spec.apply (target, command.value);
+}
 
-        if (propertie == IDs::filtType)
-        {
-            static std::map<int, juce::dsp::LadderFilterMode> types{
-                {1, juce::dsp::LadderFilterMode::LPF12}, {2, juce::dsp::LadderFilterMode::LPF24},
-                {3, juce::dsp::LadderFilterMode::BPF12}, {4, juce::dsp::LadderFilterMode::BPF24},
-                {5, juce::dsp::LadderFilterMode::HPF12}, {6, juce::dsp::LadderFilterMode::HPF24}};
+void MainComponent::handleIncomingMidiMessage (juce::MidiInput* source, const juce::MidiMessage& message)
+{
+    if (message.isNoteOn())
+        note_arrival.store (message.getTimeStamp(), std::memory_order_relaxed);
 
-            size_t k = static_cast<size_t> ((int)val);
+    midi_collector.handleIncomingMidiMessage (source, message);
+}
 
-            chains[idx]->get<ProcIdx::FILT>().setMode (types.at (k));
-            return;
-        }
+void MainComponent::applyMidi (const juce::MidiMessage& message, const juce::uint32 samplePosition) noexcept
+{
+    if (message.isNoteOn())
+    {
+        midi_note = message.getNoteNumber();
 
-        if (propertie == IDs::cutOff)
+        if (auto arrival = note_arrival.exchange (0, std::memory_order_relaxed); arrival > 0)
         {
-            chains[idx]->get<ProcIdx::FILT>().setCutoffFrequencyHz (val);
-            return;
+            auto ms = (float)((block_heard + samplePosition / sample_rate - arrival) * 1000.0);
+            latency_last.store (ms, std::memory_order_relaxed);
+            // the only writer
+            if (ms > latency_max.load (std::memory_order_relaxed))
+                latency_max.store (ms, std::memory_order_relaxed);
+            latency_count.fetch_add (1, std::memory_order_relaxed);
         }
+        auto ratio = (float)std::exp2 ((midi_note - midi_map.root_note) / 12.0);
 
-        if (propertie == IDs::reso)
+        for (auto& chain : chains)
         {
-            chains[idx]->get<ProcIdx::FILT>().setResonance (val);
-            return;
+            chain->get<ProcIdx::OSC>().setNote (ratio, message.getFloatVelocity());
+            chain->get<ProcIdx::OSC>().setBypass (false);
         }
 
-        if (propertie == IDs::drive)
-        {
-            chains[idx]->get<ProcIdx::FILT>().setDrive (val);
-            return;
-        }
+        return;
     }
 
-    if (comp_type == IDs::LFO)
+    // only the note playing stops the sound, an earlier one let go after it doesn't
+    if ((message.isNoteOff() && message.getNoteNumber() == midi_note) || message.isAllNotesOff()
+        || message.isAllSoundOff())
     {
-        if (propertie == IDs::route)
+        midi_note = -1;
+        for (auto& chain : chains)
+            chain->get<ProcIdx::OSC>().setBypass (true);
+
+        return;
+    }
+
+    if (message.isController())
+    {
+        auto value = (float)message.getControllerValue() / 127.0f;
+
+        // back to the message thread too, so the morph slider follows
+        if (message.getControllerNumber() == midi_map.cc_morph)
         {
-            setLfoRoute (idx, static_cast<size_t> ((int)val));
-            return;
+            morph_target.store (value);
+            morph_reported.store (true);
         }
 
-        if (propertie == IDs::waveType)
+        // right away, and back to the message thread so the knob follows
+        if (message.getControllerNumber() == midi_map.cc_master)
         {
-            lfo[idx]->setWaveType (static_cast<WaveType> ((int)val));
-            return;
+            constexpr auto& master = getSpec (ParamId::MASTER_GAIN);
+            ParamCommand command{0, 0, ParamId::MASTER_GAIN, mapRange (value, (float)master.min, (float)master.max)};
+            applyParam (command);
+            reportParam (command);
         }
+    }
+}
+
+void MainComponent::applyPatch (const Patch& patch) noexcept
+{
+    auto numChains = juce::jmin (patch.numChains, chains.size());
 
-        if (propertie == IDs::freq)
+    // the master gain isn't part of a patch
+    for (size_t c = 0; c < numChains; ++c)
+    {
+        for (auto p = (size_t)ParamId::CHAN_GAIN; p < (size_t)ParamId::NUM_PARAMS; ++p)
         {
-            lfo[idx]->setFrequency (val);
-            return;
+            auto param = static_cast<ParamId> (p);
+            auto value = patch.chains[c][param];
+
+            if (!std::isnan (value) && value != param_values[c][param])
+                applyParam ({0, static_cast<juce::uint16> (c), param, value});
         }
+    }
+}
+
+void MainComponent::commitPatch (const Patch& patch)
+{
+    // the audio thread gets it first, in one swap. Also collect the patch it handed back last time,
+    // and a pending one it never picked up
+    delete retired_patch.exchange (nullptr);
+    delete pending_patch.exchange (new Patch (patch));
+
+    publishPatch (patch);
+}
+
+void MainComponent::publishPatch (const Patch& patch)
+{
+    auto numChains = juce::jmin (patch.numChains, chains.size());
+
+    // one undo step, with only what the patch changed
+    undoManager.beginNewTransaction();
 
-        if (propertie == IDs::gain)
+    for (size_t c = 0; c < numChains; ++c)
+    {
+        for (auto p = (size_t)ParamId::CHAN_GAIN; p < (size_t)ParamId::NUM_PARAMS; ++p)
         {
-            lfo[idx]->setGain (val);
-            return;
+            auto param = static_cast<ParamId> (p);
+            auto value = patch.chains[c][param];
+            auto before = message_values[c][param];
+
+            if (std::isnan (value) || value == before)
+                continue;
+
+            if (!std::isnan (before))
+                undoManager.record (c, param, before, value);
+
+            message_values[c][param] = value;
         }
     }
 
-    if (comp_type == IDs::DELAY)
+    undoManager.beginNewTransaction();
+
+    // then the tree, for the GUI. The listeners' echoes match message_values
+    for (size_t c = 0; c < numChains; ++c)
     {
-        if (propertie == IDs::mix)
+        for (auto p = (size_t)ParamId::CHAN_GAIN; p < (size_t)ParamId::NUM_PARAMS; ++p)
         {
-            chains[idx]->get<ProcIdx::DEL>().setWetLevel (val);
-            return;
+            auto param = static_cast<ParamId> (p);
+            auto value = patch.chains[c][param];
+            const auto& prop = getPropertyId (param);
+            auto node = getParamNode (c, param);
+
+            if (!std::isnan (value) && (float)node[prop] != value)
+                node.setProperty (prop, toVar (param, value), nullptr);
         }
+    }
+}
 
-        if (propertie == IDs::time)
+bool MainComponent::updateMorph (const juce::uint32 numSamples) noexcept
+{
+    if (pending_morph.load() != nullptr && retired_morph.load() == nullptr)
+    {
+        if (auto* morph = pending_morph.exchange (nullptr))
         {
-            chains[idx]->get<ProcIdx::DEL>().setDelayTime (0, val);
-            chains[idx]->get<ProcIdx::DEL>().setDelayTime (1, (float)val + 0.2);
-            return;
+            retired_morph.store (active_morph);
+            active_morph = morph;
         }
+    }
+
+    if (active_morph == nullptr)
+        return false;
+
+    // a linear glide to the target, nothing to do once it's there
+    auto target = morph_target.load (std::memory_order_relaxed);
+    auto glide = (double)morph_time.load (std::memory_order_relaxed) * sample_rate;
+    auto step = glide > 1.0 ? (float)(numSamples / glide) : 1.0f;
+    auto next = morph_position + juce::jlimit (-step, step, target - morph_position);
 
-        if (propertie == IDs::feedback)
+    if (next == morph_position)
+    {
+        // settled: the message thread gets the values it ends on
+        if (morph_moving)
         {
-            chains[idx]->get<ProcIdx::DEL>().setFeedback (val);
-            return;
+            morph_moving = false;
+            auto numChains = juce::jmin (active_morph->a.numChains, chains.size());
+
+            for (size_t c = 0; c < numChains; ++c)
+                for (auto p = (size_t)ParamId::CHAN_GAIN; p < (size_t)ParamId::NUM_PARAMS; ++p)
+                    if (!std::isnan (morph_values[c].values[p]))
+                        reportParam ({0, static_cast<juce::uint16> (c), static_cast<ParamId> (p),
+                                      morph_values[c].values[p]});
         }
+
+        // what's left of a morph that waited for a dip
+        return morph_changed && morph_switches;
     }
-}
 
-void MainComponent::setDefaultParameterValues()
-{
-    // master gain
-    setParam (0, IDs::OUTPUT_GAIN, IDs::master, def_params.master_gain);
+    morph_position = next;
+    morph_changed = true;
+    morph_moving = true;
 
-    // seq
-    setParam (0, IDs::SEQUENCER, IDs::enabled, false);
-    setParam (0, IDs::SEQUENCER, IDs::time, def_params.seq_time);
+    auto switches = false;
+    auto numChains = juce::jmin (active_morph->a.numChains, chains.size());
+    constexpr auto numParams = (int)ParamId::NUM_PARAMS;
 
-    for (size_t i = 0; i < chains.size(); i++)
+    for (size_t c = 0; c < numChains; ++c)
     {
-        // channels gain
-        setParam (i, IDs::OUTPUT_GAIN, IDs::gain, def_params.chan_gain);
-        // OSC
-        setParam (i, IDs::OSC, IDs::waveType, def_params.osc_wavetype);
-        setParam (i, IDs::OSC, IDs::freq, def_params.osc_freq + 10 * i);
-        setParam (i, IDs::OSC, IDs::gain, def_params.osc_gain);
-        setParam (i, IDs::OSC, IDs::fm_freq, def_params.osc_fm_freq);
-        setParam (i, IDs::OSC, IDs::fm_depth, def_params.osc_fm_depth);
-        setParam (i, IDs::OSC, IDs::pan, def_params.osc_pan);
-        // LFO
-        setParam (i, IDs::LFO, IDs::waveType, def_params.lfo_wavetype);
-        setParam (i, IDs::LFO, IDs::freq, def_params.lfo_freq);
-        setParam (i, IDs::LFO, IDs::gain, def_params.lfo_gain);
-        setParam (i, IDs::LFO, IDs::route, i + 2);
-        // filter
-        setParam (i, IDs::FILT, IDs::enabled, false);
-        setParam (i, IDs::FILT, IDs::filtType, def_params.filt_type);
-        setParam (i, IDs::FILT, IDs::cutOff, def_params.filt_cutoff);
-        setParam (i, IDs::FILT, IDs::reso, def_params.filt_reso);
-        setParam (i, IDs::FILT, IDs::drive, def_params.filt_drive);
-        // delay
-        setParam (i, IDs::DELAY, IDs::mix, def_params.del_mix);
-        setParam (i, IDs::DELAY, IDs::time, def_params.del_time);
-        setParam (i, IDs::DELAY, IDs::feedback, def_params.del_feedback);
+        auto* values = morph_values[c].values.data();
+        const auto& a = active_morph->a.chains[c];
+        const auto& delta = active_morph->delta[c];
+
+        juce::FloatVectorOperations::copy (values, a.values.data(), numParams);
+        juce::FloatVectorOperations::addWithMultiply (values, delta.values.data(), morph_position, numParams);
+
+        // the discrete ones can't be in between, they switch half way
+        for (const auto& spec : param_specs)
+        {
+            if (spec.kind == ParamKind::REAL)
+                continue;
+
+            auto& value = morph_values[c][spec.id];
+            value = morph_position < 0.5f ? a[spec.id] : a[spec.id] + delta[spec.id];
+            switches |= spec.id >= ParamId::CHAN_GAIN && !std::isnan (value) && value != param_values[c][spec.id];
+        }
     }
+
+    morph_switches = switches;
+    return switches;
 }
 
-void MainComponent::generateRandomParameters()
+void MainComponent::reportParam (const ParamCommand& command) noexcept
 {
-    std::array<int, NUM_OUTPUT_CHANNELS / 2> indexs_range;
-    std::iota (indexs_range.begin(), indexs_range.end(), 0);
-    std::shuffle (indexs_range.begin(), indexs_range.end(), gen);
-    std::array<int, NUM_OUTPUT_CHANNELS / 4> indexes;
-    std::copy (indexs_range.begin(), indexs_range.begin() + NUM_OUTPUT_CHANNELS / 4, indexes.begin());
+    // the message thread collects it 30 times a second, see feedback_queue
+    if (!feedback_queue.push (command))
+        jassertfalse;
+}
 
-    for (size_t i = 0; i < NUM_OUTPUT_CHANNELS / 2; i++)
+void MainComponent::applyMorph() noexcept
+{
+    if (!std::exchange (morph_changed, false))
+        return;
+
+    auto numChains = juce::jmin (active_morph->a.numChains, chains.size());
+
+    // like a patch, the master gain isn't morphed
+    for (size_t c = 0; c < numChains; ++c)
     {
-        if (std::find (indexes.begin(), indexes.end(), i) != indexes.end())
-        {
-            generateRandomOscParameters (i, true);
-            generateRandomLfoParameters (i, true);
-        }
-        else
+        for (auto p = (size_t)ParamId::CHAN_GAIN; p < (size_t)ParamId::NUM_PARAMS; ++p)
         {
-            generateRandomOscParameters (i);
-            generateRandomLfoParameters (i);
+            auto param = static_cast<ParamId> (p);
+            auto value = morph_values[c][param];
+
+            if (!std::isnan (value) && value != param_values[c][param])
+                applyParam ({0, static_cast<juce::uint16> (c), param, value});
         }
-        // generateRandomFilterParameters (i);
-        generateRandomDelayParameters (i);
     }
 }
 
-void MainComponent::generateRandomOscParameters (const int index, const bool suppressed)
+void MainComponent::captureMorph (const size_t slot)
 {
-    static std::uniform_int_distribution<> osc_type (param_limits.osc_waveType_min, 3);
-    static std::uniform_real_distribution<> osc_freq (param_limits.osc_freq_min, param_limits.C8);
-    static std::uniform_real_distribution<> osc_fm_freq (param_limits.osc_fm_freq_min, param_limits.osc_fm_freq_max);
-    static std::uniform_real_distribution<> osc_fm_depth (param_limits.osc_fm_depth_min, param_limits.osc_fm_depth_max);
-    static std::uniform_real_distribution<> osc_pan (param_limits.osc_pan_min, param_limits.osc_pan_max);
-    static std::bernoulli_distribution b_dist (0.5);
+    auto& snapshot = morph_snapshots[slot];
+    snapshot.numChains = chains.size();
+    std::copy (message_values.begin(), message_values.end(), snapshot.chains.begin());
+    morph_captured[slot] = true;
 
-    juce::ValueTree osc_state = state.getChildWithName (IDs::OSC).getChild (index);
+    if (!morph_captured[0] || !morph_captured[1])
+        return;
 
-    osc_state.setProperty (IDs::waveType, osc_type (gen), undoManager.getManagerPtr());
+    auto* morph = new MorphPair();
+    morph->a = morph_snapshots[0];
 
-    if (suppressed)
-    {
-        float pan = b_dist (gen) ? rand.getSup (param_limits.osc_pan_min, 10) : rand.getSup (param_limits.osc_pan_max, 10);
-        osc_state.setProperty (IDs::pan, pan, undoManager.getManagerPtr());
-        osc_state.setProperty (IDs::freq, rand.getSup (param_limits.C8, 5), undoManager.getManagerPtr());
-        osc_state.setProperty (IDs::fm_freq, rand.getSup (param_limits.osc_fm_freq_max, 10), undoManager.getManagerPtr());
-        osc_state.setProperty (IDs::fm_depth, rand.getSup (param_limits.osc_fm_depth_max, 5), undoManager.getManagerPtr());
-    }
-    else
+    for (size_t c = 0; c < morph->a.numChains; ++c)
+        juce::FloatVectorOperations::subtract (morph->delta[c].values.data(), morph_snapshots[1].chains[c].values.data(),
+                                               morph_snapshots[0].chains[c].values.data(), (int)ParamId::NUM_PARAMS);
+
+    // the current sound stays until the position moves
+    delete retired_morph.exchange (nullptr);
+    delete pending_morph.exchange (morph);
+}
+
+void MainComponent::setDefaultParameterValues()
+{
+    // seq
+    setParam (IDs::SEQUENCER, IDs::enabled, false);
+    setParam (IDs::SEQUENCER, IDs::time, def_params.seq_time);
+
+    // morph
+    setParam (IDs::MORPH, IDs::position, 0.0);
+    setParam (IDs::MORPH, IDs::time, def_params.morph_time);
+
+    // p-lock pattern
+    setParam (IDs::PATTERN, IDs::enabled, false);
+    setParam (IDs::PATTERN, IDs::rec, false);
+    setParam (IDs::PATTERN, IDs::steps, def_params.pattern_steps);
+    setParam (IDs::PATTERN, IDs::time, def_params.pattern_time);
+
+    for (const auto& spec : param_specs)
     {
-        osc_state.setProperty (IDs::pan, osc_pan (gen), undoManager.getManagerPtr());
-        osc_state.setProperty (IDs::freq, osc_freq (gen), undoManager.getManagerPtr());
-        osc_state.setProperty (IDs::fm_freq, rand.getSup (param_limits.osc_fm_freq_max, 50), undoManager.getManagerPtr());
-        osc_state.setProperty (IDs::fm_depth, rand.getSup (param_limits.osc_fm_depth_max, 25), undoManager.getManagerPtr());
+        auto numChains = isPerChain (spec.id) ? chains.size() : 1;
+
+        for (size_t i = 0; i < numChains; i++)
+            sendParam (i, spec.id, getDefaultValue (spec.id, i));
     }
 }
 
-void MainComponent::generateRandomLfoParameters (const int index, const bool suppressed)
+void MainComponent::generateRandomParameters()
 {
-    static std::uniform_int_distribution<> lfo_type (param_limits.lfo_waveType_min, 4);
-    static std::uniform_real_distribution<> lfo_freq (param_limits.lfo_freq_min, param_limits.lfo_freq_max);
-    static std::uniform_real_distribution<> lfo_gain (param_limits.lfo_gain_min, param_limits.lfo_gain_max);
-    static std::uniform_int_distribution<> lfo_route (2, 5);
+    // start from what the audio thread has, only the randomized parameters change
+    updateBuilderBase();
+    random_requested = true;
+    patch_builder.notify();
+}
 
-    juce::ValueTree lfo_state = state.getChildWithName (IDs::LFO).getChild (index);
+void MainComponent::updateSequence()
+{
+    collectFeedback();
+    logMidiLatency();
 
-    int route = lfo_route (gen);
-    lfo_state.setProperty (IDs::route, route, undoManager.getManagerPtr());
+    // the GUI and the undo history catch up with what the audio thread played
+    std::vector<Patch*> played;
+    played.reserve (sequence_played.getCapacity());
+    {
+        const juce::ScopedLock sl (builder_lock);
+        played.swap (played_backlog);
+    }
 
-    float freq = 0, gain = 0;
-    if (suppressed)
+    for (auto* patch : played)
     {
-        int lfo_t = lfo_type (gen);
-        lfo_t = lfo_t <= 2 ? lfo_t : 4; // avoid squear on low freqs
-        lfo_state.setProperty (IDs::waveType, lfo_t, undoManager.getManagerPtr());
+        publishPatch (*patch);
+        delete patch;
+    }
 
-        freq = rand.getSup (param_limits.lfo_freq_max, 1);
-        if (route == 3) // osc gain
-            gain = rand.getVal (param_limits.lfo_gain_max);
-        else
-            gain = rand.getSup (param_limits.lfo_gain_max, 50);
+    updateBuilderBase();
+}
 
-        lfo_state.setProperty (IDs::freq, freq, undoManager.getManagerPtr());
-        lfo_state.setProperty (IDs::gain, gain, undoManager.getManagerPtr());
-    }
-    else
+void MainComponent::logMidiLatency()
+{
+    auto count = latency_count.load (std::memory_order_relaxed);
+    if (count == latency_logged)
+        return;
+
+    latency_logged = count;
+    juce::Logger::writeToLog ("MIDI note to sound latency: " + juce::String (latency_last.load(), 1) + " ms, max "
+                              + juce::String (latency_max.load(), 1) + " ms over " + juce::String (count) + " notes");
+}
+
+void MainComponent::collectFeedback()
+{
+    // not an edit, so nothing to undo. The tree's echo matches message_values and stops in sendParam
+    ParamCommand command;
+    while (feedback_queue.pop (command))
     {
-        freq = rand.getSup (param_limits.lfo_freq_max, 50);
-        if (route == 3) // osc gain
-            gain = rand.getVal (param_limits.lfo_gain_max);
-        else
-            gain = rand.getSup (param_limits.lfo_gain_max, 5);
+        message_values[command.chain][command.param] = command.value;
 
-        lfo_state.setProperty (IDs::waveType, lfo_type (gen), undoManager.getManagerPtr());
-        lfo_state.setProperty (IDs::freq, freq, undoManager.getManagerPtr());
-        lfo_state.setProperty (IDs::gain, gain, undoManager.getManagerPtr());
+        auto node = getParamNode (command.chain, command.param);
+        const auto& prop = getPropertyId (command.param);
+        if ((float)node[prop] != command.value)
+            node.setProperty (prop, toVar (command.param, command.value), nullptr);
     }
+
+    // the morph position isn't a parameter of the schema, only the latest one matters
+    if (morph_reported.exchange (false))
+        state.getChildWithName (IDs::MORPH).setProperty (IDs::position, morph_target.load(), nullptr);
 }
 
-void MainComponent::generateRandomFilterParameters (const int index, const bool suppressed)
+void MainComponent::updateBuilderBase()
 {
-    // static std::uniform_int_distribution<> filt_enabled (0, 1);
-    static std::uniform_int_distribution<> filt_type (param_limits.filt_filtType_min, param_limits.filt_filtType_max);
-    static std::uniform_real_distribution<> filt_cutOff (param_limits.filt_cutoff_min, param_limits.filt_cutoff_max);
-    static std::uniform_real_distribution<> filt_reso (param_limits.filt_reso_min, param_limits.filt_reso_max - 0.35);
-    static std::uniform_real_distribution<> filt_drive (param_limits.filt_drive_min, param_limits.filt_drive_max - 8);
+    const juce::ScopedLock sl (builder_lock);
+    builder_base.numChains = chains.size();
+    std::copy (message_values.begin(), message_values.end(), builder_base.chains.begin());
+}
 
-    juce::ValueTree filt_state = state.getChildWithName (IDs::FILT).getChild (index);
+void MainComponent::buildPatches()
+{
+    auto getBase = [this]
+    {
+        const juce::ScopedLock sl (builder_lock);
+        return builder_base;
+    };
 
-    if (suppressed)
+    // the played steps wait in the backlog for the message thread, however long it takes
+    Patch* played = nullptr;
+    while (sequence_played.pop (played))
     {
+        const juce::ScopedLock sl (builder_lock);
+        played_backlog.push_back (played);
     }
-    else
+
+    if (random_requested.exchange (false))
     {
-        // filt_state.setProperty (IDs::enabled, (filt_enabled (gen) != 0 ? true : false), undoManager.getManagerPtr());
-        filt_state.setProperty (IDs::filtType, filt_type (gen), undoManager.getManagerPtr());
-        filt_state.setProperty (IDs::cutOff, filt_cutOff (gen), undoManager.getManagerPtr());
-        filt_state.setProperty (IDs::reso, filt_reso (gen), undoManager.getManagerPtr());
-        filt_state.setProperty (IDs::drive, filt_drive (gen), undoManager.getManagerPtr());
+        // it's for a button press, so it only has to beat the next press
+        auto patch = std::make_shared<Patch> (getBase());
+        buildScreenedPatch (*patch, juce::Time::getMillisecondCounterHiRes() + seq.getTime() * screening.budget);
+
+        juce::MessageManager::callAsync (
+            [safe = juce::Component::SafePointer<MainComponent> (this), patch]
+            {
+                if (safe != nullptr)
+                    safe->commitPatch (*patch);
+            });
+    }
+
+    // the only producer, and it never builds more than there's room for
+    while (seq.isEnabled() && sequence_ready.getNumReady() < screening.lookahead && !patch_builder.threadShouldExit())
+    {
+        auto patch = std::make_unique<Patch> (getBase());
+        buildScreenedPatch (*patch, juce::Time::getMillisecondCounterHiRes() + seq.getTime() * screening.budget);
+
+        if (sequence_ready.push (patch.get()))
+            patch.release();
     }
 }
 
-void MainComponent::generateRandomDelayParameters (const int index, const bool suppressed)
+void MainComponent::buildScreenedPatch (Patch& patch, double deadline)
 {
-    static std::uniform_real_distribution<> del_mix (param_limits.delay_mix_min, param_limits.delay_mix_max);
-    static std::uniform_real_distribution<> del_time (param_limits.delay_time_min, param_limits.delay_time_max);
-    static std::uniform_real_distribution<> del_feedback (param_limits.delay_feedback_min,
-                                                          param_limits.delay_feedback_max - 0.1);
+    auto base = patch;
 
-    juce::ValueTree del_state = state.getChildWithName (IDs::DELAY).getChild (index);
+    // with a fixed seed every candidate gets scored however long it takes, or how far the screening
+    // got before the deadline would change which one wins
+    if (Rng::isGlobalSeedFixed())
+        deadline = std::numeric_limits<double>::max();
 
-    if (suppressed)
-    {
-    }
-    else
+    std::vector<Patch> candidates (screening.num_candidates, patch);
+    for (auto& c : candidates)
+        buildRandomPatch (c);
+
+    patch = candidates[screener->pickBest (candidates, deadline)];
+
+    // only what the randomizer changed goes out, a patch that waits in the sequence doesn't
+    // undo the changes made in the meantime
+    for (size_t c = 0; c < patch.numChains; ++c)
+        for (auto p = (size_t)ParamId::CHAN_GAIN; p < (size_t)ParamId::NUM_PARAMS; ++p)
+            if (patch.chains[c].values[p] == base.chains[c].values[p])
+                patch.chains[c].values[p] = std::numeric_limits<float>::quiet_NaN();
+}
+
+void MainComponent::buildRandomPatch (Patch& patch)
+{
+    // half of the chains get suppressed parameters
+    std::vector<size_t> indexs_range (patch.numChains);
+    std::iota (indexs_range.begin(), indexs_range.end(), 0);
+    std::shuffle (indexs_range.begin(), indexs_range.end(), rng);
+    std::vector<size_t> indexes (indexs_range.begin(), indexs_range.begin() + (long)(patch.numChains / 2));
+
+    for (size_t i = 0; i < patch.numChains; i++)
     {
-        del_state.setProperty (IDs::mix, del_mix (gen), undoManager.getManagerPtr());
-        del_state.setProperty (IDs::time, del_time (gen), undoManager.getManagerPtr());
-        del_state.setProperty (IDs::feedback, del_feedback (gen), undoManager.getManagerPtr());
+        auto suppressed = std::find (indexes.begin(), indexes.end(), i) != indexes.end();
+        generateRandomChainParameters (patch.chains[i], suppressed);
     }
 }
 
+void MainComponent::generateRandomChainParameters (ParamValues& values, const bool suppressed)
+{
+    for (const auto& r : random_specs)
+        values[r.id] = drawRandomValue (rng, getSpec (r.id), suppressed ? r.suppressed : r.range);
+
+    if (lfo_routes[(size_t)values[ParamId::LFO_ROUTE] - 1].param == ParamId::OSC_GAIN)
+        values[ParamId::LFO_GAIN] = drawRandomValue (rng, getSpec (ParamId::LFO_GAIN), random_tremolo_gain);
+}
+
 void MainComponent::oscOn()
 {
     for (auto&& chain : chains)
@@ -749,12 +1276,38 @@ void MainComponent::resized()
         output_comp->setBounds (output_bound);
     }
 
+    auto morph_bound = seq_bound.withTrimmedLeft (getComponentWidth (seq_comp) + gui_sizes.yGap_between_components);
+
     if (seq_comp.get() != nullptr)
     {
         seq_bound.setWidth (seq_comp->getWidthNeeded());
         seq_comp->setBounds (seq_bound);
     }
 
+    auto pattern_bound =
+        morph_bound.withTrimmedLeft (getComponentWidth (morph_comp) + gui_sizes.yGap_between_components);
+
+    if (morph_comp.get() != nullptr)
+    {
+        morph_bound.setWidth (morph_comp->getWidthNeeded());
+        morph_comp->setBounds (morph_bound);
+    }
+
+    auto record_bound =
+        pattern_bound.withTrimmedLeft (getComponentWidth (pattern_comp) + gui_sizes.yGap_between_components);
+
+    if (pattern_comp.get() != nullptr)
+    {
+        pattern_bound.setWidth (pattern_comp->getWidthNeeded());
+        pattern_comp->setBounds (pattern_bound);
+    }
+
+    if (record_comp.get() != nullptr)
+    {
+        record_bound.setWidth (record_comp->getWidthNeeded());
+        record_comp->setBounds (record_bound);
+    }
+
     bounds.removeFromTop (gui_sizes.yGap_between_components);
     auto osc_bound = bounds.removeFromTop (getComponentHeight (osc_comp.back())).reduced (xPadding, 0);
 
@@ -811,6 +1364,29 @@ void MainComponent::resized()
         del_bound.removeFromLeft (c->getWidthNeeded() + gui_sizes.yGap_between_components);
     }
 
+    bounds.removeFromTop (gui_sizes.yGap_between_components);
+    auto rev_bound = bounds.removeFromTop (getComponentHeight (rev_comp.back())).reduced (xPadding, 0);
+
+    for (auto& c : rev_comp)
+    {
+        if (c.get() == nullptr)
+            continue;
+
+        c->setSize (c->getWidthNeeded(), c->getHeightNeeded());
+        auto pos = rev_bound.getTopLeft();
+        c->setTopLeftPosition (pos);
+        rev_bound.removeFromLeft (c->getWidthNeeded() + gui_sizes.yGap_between_components);
+    }
+
+    bounds.removeFromTop (gui_sizes.yGap_between_components);
+    auto scope_bound = bounds.removeFromTop (getComponentHeight (scope_comp)).reduced (xPadding, 0);
+
+    if (scope_comp.get() != nullptr)
+    {
+        scope_bound.setWidth (scope_comp->getWidthNeeded());
+        scope_comp->setBounds (scope_bound);
+    }
+
     // auto adsc_bounds = getLocalBounds().removeFromLeft (70 * 4);
     // adsc.setBounds (adsc_bounds);
     // adsc.setCentrePosition (adsc_bounds.getCentre().translated (70 * 4 + 20, 0));
@@ -1,30 +1,41 @@
 #pragma once
 
 #include "Chain.h"
+#include "CommandQueue.h"
 #include "ComponentWrappers.h"
 #include "Constants.h"
 #include "GuiComponents.h"
 #include "Lfo.h"
+#include "Parameters.h"
+#include "PatchScreener.h"
 #include "RandSequencer.h"
+#include "Random.h"
+#include "Recorder.h"
+#include "Routing.h"
+#include "Scope.h"
+#include "StepPattern.h"
 #include "Utils.h"
 
 #include <JuceHeader.h>
 #include <algorithm>
 #include <array>
-#include <map>
+#include <atomic>
+#include <cmath>
+#include <limits>
 #include <memory>
-#include <random>
 #include <vector>
 
 // TODO: add reset to defaults button
 
 class MainComponent : public juce::AudioAppComponent,
                       public juce::ChangeListener, // listening to the state envtes
-                      public juce::KeyListener     // add keyboard events to the app
+                      public juce::KeyListener,    // add keyboard events to the app
+                      private juce::MidiInputCallback
 {
 public:
     //==============================================================================
-    MainComponent (juce::ValueTree st, juce::ValueTree selectors_st);
+    MainComponent (juce::ValueTree st, juce::ValueTree selectors_st,
+                   size_t numAudioWorkers = DEFAULT_NUM_AUDIO_WORKERS);
     ~MainComponent() override;
 
     //==============================================================================
@@ -40,35 +51,172 @@ public:
     void paint (juce::Graphics& g) override;
     void resized() override;
 
+    /** Compiles graph and hands it to the audio thread in place of the default routing, for good.
+        Returns false and changes nothing if it has a cycle or too many nodes */
+    bool setRoutingGraph (const RoutingGraph& graph);
+
 private:
+    /** MIDI thread, stamps the note ons for the latency measurement and hands everything to midi_collector */
+    void handleIncomingMidiMessage (juce::MidiInput* source, const juce::MidiMessage& message) override;
+
     //==============================================================================
-    std::array<std::unique_ptr<Chain>, NUM_OUTPUT_CHANNELS / 2> chains;
-    std::array<juce::dsp::AudioBlock<float>, NUM_OUTPUT_CHANNELS / 2> audio_blocks;
+    // one allocation for every delay line, it has to outlive the chains
+    DelayArena<float> delay_arena;
+    // the filters of all the chains, one SIMD lane per channel, it has to outlive the chains
+    FilterBank<float> filter_bank;
+    // one per chain of the state tree, never resized after construction (the LFOs refer to them)
+    std::vector<std::unique_ptr<Chain>> chains;
+
+    // taps the routing processor writes to, they outlive it
+    ScopeAnalyser scope_analyser;
+    LevelMeters level_meters;
+    Recorder recorder;
+
+    // how the stages of the chains are wired, edited here and run by the routing processor. The default
+    // one follows the output pairs of the device until setRoutingGraph() replaces it
+    RoutingGraph routing_graph;
+    bool custom_routing = false;
+    std::unique_ptr<WorkerPool> worker_pool;
+    std::unique_ptr<RoutingProcessor> routing;
+
+    // parameter changes from the message thread, drained and applied at the top of every block
+    CommandQueue command_queue{1 << 15};
+    std::vector<ParamCommand> block_commands;
+    // and back: the values the audio thread set on its own, for message_values and the GUI. Room for a
+    // whole settled morph and a few pattern steps with every lock, between two collections
+    CommandQueue feedback_queue{1 << 14};
+    // what the audio thread last applied, per chain, the LFOs modulate around it
+    std::vector<ParamValues> param_values;
+    // what the schema setters write to, one per chain
+    std::vector<ParamTarget> targets;
+    std::atomic<bool> reset_pending{false};
+
+    // a whole patch, swapped in by the audio thread at the top of a block
+    std::atomic<Patch*> pending_patch{nullptr};
+    std::atomic<Patch*> retired_patch{nullptr};
+    juce::uint32 patch_fade_samples = 0;
+    // what the message thread has sent so far, per chain, so the echoes of a patch aren't sent twice
+    std::vector<ParamValues> message_values;
+
+    // A/B morphing. The pair is swapped in like a patch, the position glides to its target on the audio thread
+    std::array<Patch, 2> morph_snapshots;
+    std::array<bool, 2> morph_captured{};
+    std::atomic<MorphPair*> pending_morph{nullptr};
+    std::atomic<MorphPair*> retired_morph{nullptr};
+    std::atomic<float> morph_target{0};
+    std::atomic<bool> morph_reported{false}; // CC1 moved morph_target, the message thread shows it
+    std::atomic<float> morph_time{0}; // seconds
+    MorphPair* active_morph = nullptr;
+    float morph_position = 0;
+    bool morph_changed = false;  // morph_values not applied yet, kept until they are
+    bool morph_switches = false; // and some discrete parameter switches with them, they wait for a dip
+    bool morph_moving = false;   // since the last time the values were reported
+    std::array<ParamValues, MAX_NUM_CHAINS> morph_values;
+    double sample_rate = 0;
+
+    // MIDI from every input device, stamped on arrival and played at the same position one block later
+    juce::MidiMessageCollector midi_collector;
+    juce::MidiBuffer midi_block;
+    int midi_note = -1; // the note playing, the last one wins
+
+    // note to sound latency, measured for every note on: from its arrival to the time its first sample
+    // leaves the device
+    std::atomic<double> note_arrival{0}; // seconds, Time::getMillisecondCounterHiRes based, 0 when measured
+    double block_heard = 0;              // seconds, when the first sample of the block leaves the device
+    int output_latency = 0;              // samples the device adds
+    std::atomic<float> latency_last{0}, latency_max{0}; // ms
+    std::atomic<int> latency_count{0};
+    int latency_logged = 0; // message thread
 
     // LFO
     size_t lfoUpdateCounter = def_params.lfoUpdateRate;
-    std::array<std::unique_ptr<Lfo<float>>, NUM_OUTPUT_CHANNELS / 2> lfo;
+    std::vector<std::unique_ptr<Lfo<float>>> lfo;
 
-    // sequencer
+    // sequencer. Its steps are built ahead on patch_builder and played on the audio thread, sample accurately.
+    // The builder is woken by the audio thread for every step, so a busy message thread doesn't starve it
     RandSequencer seq;
+    PatchQueue sequence_ready{4};   // built, waiting for their step
+    PatchQueue sequence_played{16}; // handed back, collected by the builder at every step
+    bool step_pending = false;
+
+    // the gain dip a patch is swapped in at, faded out, switched while silent, faded back in.
+    // It can span several blocks
+    struct Dip
+    {
+        enum Stage
+        {
+            NONE,
+            OUT,
+            IN
+        } stage = NONE;
+
+        juce::uint32 done = 0, length = 0;
+        Patch* patch = nullptr;
+        bool sequenced = false;
+        bool morph = false;
+    } dip;
+
+    // p-lock step sequencer. The message thread edits pattern_edit and hands copies of it to the player
+    PatternPlayer pattern;
+    StepPattern pattern_edit;
+    bool pattern_recording = false;
+    std::vector<ParamCommand> pattern_commands;
 
     std::vector<std::unique_ptr<Broadcaster>> broadcasters;
+    std::vector<std::unique_ptr<ParamListener>> param_listeners;
     juce::ValueTree state;
     juce::ValueTree selectors_state;
+    // the parameters are undone through it, not through a juce::UndoManager on the tree
     undoMan undoManager;
+    bool restoring = false;
+
+    // the randomizer only runs on patch_builder, which runs buildPatches every time it's notified
+    class PatchBuilder : public juce::Thread
+    {
+    public:
+        explicit PatchBuilder (std::function<void()> work) : juce::Thread ("patch builder"), build (std::move (work))
+        {
+        }
 
-    std::random_device rd;
-    std::mt19937 gen;
-    RAND_HELPER rand;
+        void run() override
+        {
+            // a notify that comes while it builds isn't lost, the wait returns right away
+            while (!threadShouldExit())
+            {
+                build();
+                wait (-1);
+            }
+        }
+
+    private:
+        std::function<void()> build;
+    };
+
+    Rng rng;
+    // renders the candidates of patch_builder, it has to outlive it
+    std::unique_ptr<PatchScreener> screener;
+    PatchBuilder patch_builder{[this] { buildPatches(); }};
+    std::atomic<bool> random_requested{false};
+
+    // what the builder starts from (message_values, refreshed by the message thread) and the played
+    // steps it collected for the message thread
+    juce::CriticalSection builder_lock;
+    Patch builder_base;
+    std::vector<Patch*> played_backlog;
 
     // GUI controllers
     std::unique_ptr<ButtonsGui> btn_comp;
     std::unique_ptr<OutputGui> output_comp;
     std::unique_ptr<SequencerGui> seq_comp;
-    std::array<std::unique_ptr<OscGui>, NUM_OUTPUT_CHANNELS / 4> osc_comp;
-    std::array<std::unique_ptr<LfoGui>, NUM_OUTPUT_CHANNELS / 4> lfo_comp;
-    std::array<std::unique_ptr<FiltGui>, NUM_OUTPUT_CHANNELS / 4> filt_comp;
-    std::array<std::unique_ptr<DelayGui>, NUM_OUTPUT_CHANNELS / 4> del_comp;
+    std::unique_ptr<MorphGui> morph_comp;
+    std::unique_ptr<PatternGui> pattern_comp;
+    std::unique_ptr<ScopeGui> scope_comp;
+    std::unique_ptr<RecordGui> record_comp;
+    std::array<std::unique_ptr<OscGui>, NUM_CHAIN_PANELS> osc_comp;
+    std::array<std::unique_ptr<LfoGui>, NUM_CHAIN_PANELS> lfo_comp;
+    std::array<std::unique_ptr<FiltGui>, NUM_CHAIN_PANELS> filt_comp;
+    std::array<std::unique_ptr<DelayGui>, NUM_CHAIN_PANELS> del_comp;
+    std::array<std::unique_ptr<ReverbGui>, NUM_CHAIN_PANELS> rev_comp;
     // juce::AudioDeviceSelectorComponent adsc;
 
     //==============================================================================
@@ -77,13 +225,36 @@ private:
 
     void initGuiComponents (const juce::ValueTree& v, const juce::ValueTree& vs);
     void initBroadcasters (const juce::ValueTree& v, const juce::ValueTree& vs);
-    void setLfoRoute (const size_t lfo_idx, const size_t val);
 
     juce::var getStateParamValue (const juce::ValueTree& v, const juce::Identifier& parent,
                                   const juce::Identifier& node, const juce::Identifier& propertie);
 
     template <typename T>
-    void setParam (const size_t idx, const juce::Identifier& comp_type, const juce::Identifier& propertie, T val);
+    void setParam (const juce::Identifier& comp_type, const juce::Identifier& propertie, T val);
+    void sendParam (const size_t idx, const ParamId param, const float val);
+    juce::ValueTree getParamNode (const size_t idx, const ParamId param) const;
+    void restoreParam (const size_t idx, const ParamId param, const float val);
+    void undo();
+    void redo();
+    /** The current state to a new file in the Patches folder, for --render */
+    void saveCurrentPatch();
+    void pushParam (const size_t idx, const ParamId param, const float val, const juce::uint32 sampleOffset = 0);
+
+    // audio thread
+    void drainCommands (const juce::uint32 numSamples) noexcept;
+    void applyParam (const ParamCommand& command) noexcept;
+    void reportParam (const ParamCommand& command) noexcept;
+    void applyMidi (const juce::MidiMessage& message, const juce::uint32 samplePosition) noexcept;
+    void renderSegment (juce::AudioBuffer<float>& buffer, const int startSample, const int numSamples) noexcept;
+    void applyPatch (const Patch& patch) noexcept;
+    void startDip (Patch* patch, const bool sequenced, const bool morph) noexcept;
+    void advanceDip() noexcept;
+    void commitPatch (const Patch& patch);
+    void publishPatch (const Patch& patch);
+    /** True while there are morph values to apply that switch a discrete parameter */
+    bool updateMorph (const juce::uint32 numSamples) noexcept;
+    void applyMorph() noexcept;
+    void captureMorph (const size_t slot);
 
     void setDefaultParameterValues();
 
@@ -94,10 +265,14 @@ private:
     int getComponentHeight (const std::unique_ptr<T>& comp) const;
 
     void generateRandomParameters();
-    void generateRandomOscParameters (const int index, const bool suppressed = false);
-    void generateRandomLfoParameters (const int index, const bool suppressed = false);
-    void generateRandomFilterParameters (const int index, const bool suppressed = false);
-    void generateRandomDelayParameters (const int index, const bool suppressed = false);
+    void updateSequence();
+    void collectFeedback();
+    void logMidiLatency();
+    void updateBuilderBase();
+    void buildPatches();
+    void buildRandomPatch (Patch& patch);
+    void buildScreenedPatch (Patch& patch, double deadline);
+    void generateRandomChainParameters (ParamValues& values, const bool suppressed = false);
 
     void oscOn();
     void oscOff();
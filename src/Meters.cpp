@@ -0,0 +1,81 @@
+#include "Meters.h"
+
+LevelMeters::LevelMeters (size_t numSources) : levels (numSources)
+{
+}
+
+LevelMeters::Reading LevelMeters::read (const size_t source) noexcept
+{
+    if (source >= levels.size())
+        return {};
+
+    auto& level = levels[source];
+    return {level.peak.exchange (0.0f, std::memory_order_relaxed),
+            std::sqrt (level.mean_square.load (std::memory_order_relaxed))};
+}
+
+void LevelMeters::prepare (double sampleRate)
+{
+    sample_rate = sampleRate;
+
+    for (auto& level : levels)
+        level.smoothed = 0;
+}
+
+bool LevelMeters::isActive() const noexcept
+{
+    return true;
+}
+
+void LevelMeters::write (size_t source, const float* left, const float* right, int numSamples) noexcept
+{
+    using Vec = juce::dsp::SIMDRegister<float>;
+    constexpr auto lanes = Vec::SIMDNumElements;
+
+    if (source >= levels.size() || numSamples <= 0)
+        return;
+
+    auto n = (size_t)numSamples;
+    size_t i = 0;
+    auto peak = 0.0f, sum = 0.0f;
+
+    // the chain buffers are aligned, the outputs only are when the chunk starts on a register
+    if (Vec::isSIMDAligned (left) && Vec::isSIMDAligned (right))
+    {
+        auto peaks = Vec::expand (0.0f), squares = Vec::expand (0.0f);
+
+        for (; i + lanes <= n; i += lanes)
+        {
+            auto l = Vec::fromRawArray (left + i);
+            auto r = Vec::fromRawArray (right + i);
+
+            peaks = Vec::max (peaks, Vec::max (Vec::abs (l), Vec::abs (r)));
+            squares += l * l + r * r;
+        }
+
+        for (size_t k = 0; k < lanes; ++k)
+            peak = juce::jmax (peak, peaks.get (k));
+
+        sum = squares.sum();
+    }
+
+    for (; i < n; ++i)
+    {
+        peak = juce::jmax (peak, std::abs (left[i]), std::abs (right[i]));
+        sum += left[i] * left[i] + right[i] * right[i];
+    }
+
+    auto& level = levels[source];
+
+    // the GUI resets it when it reads, a peak of this chunk replaces anything lower. A plain store
+    // could put back an older peak over that reset, the exchange only succeeds on the value it saw
+    auto current = level.peak.load (std::memory_order_relaxed);
+    while (peak > current && !level.peak.compare_exchange_weak (current, peak, std::memory_order_relaxed))
+    {
+    }
+
+    // one pole over the whole chunk, as if its mean square had come sample by sample
+    auto coeff = (float)std::exp (-(double)n / (meter.rms_time * sample_rate));
+    level.smoothed = sum / (float)(2 * n) + coeff * (level.smoothed - sum / (float)(2 * n));
+    level.mean_square.store (level.smoothed, std::memory_order_relaxed);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Constants.h"
+#include "Routing.h"
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <vector>
+
+/** Peak and rms of the outputs and of every chain, measured on the audio thread and read by the GUI.
+
+    Every chunk the routing renders gets one SIMD pass per source for both values. The peak is the
+    highest since the GUI last read it, the rms is smoothed over meter.rms_time, and both are
+    published with relaxed atomics, the GUI doesn't need more than the latest values. The peak is
+    raised with compare-and-swap, so it never overwrites the reset of a read that came in between.
+*/
+class LevelMeters : public RoutingTap
+{
+public:
+    struct Reading
+    {
+        float peak = 0; // linear
+        float rms = 0;  // linear
+    };
+
+    /** One source for the outputs and one per chain, like the RoutingTap sources */
+    explicit LevelMeters (size_t numSources);
+
+    // message thread
+    size_t getNumSources() const noexcept
+    {
+        return levels.size();
+    }
+
+    /** The peak since the last call and the current rms */
+    Reading read (const size_t source) noexcept;
+
+    // audio thread
+    void prepare (double sampleRate);
+    bool isActive() const noexcept override;
+    void write (size_t source, const float* left, const float* right, int numSamples) noexcept override;
+
+private:
+    struct Level
+    {
+        std::atomic<float> peak{0};
+        std::atomic<float> mean_square{0};
+        float smoothed = 0; // audio thread
+    };
+
+    std::vector<Level> levels;
+    double sample_rate = 44100;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LevelMeters)
+};
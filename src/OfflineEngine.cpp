@@ -0,0 +1,123 @@
+#include "OfflineEngine.h"
+#include "Random.h"
+
+OfflineEngine::OfflineEngine (size_t numChains) : bank (numChains * 2), chains (numChains), values (numChains)
+{
+    lfo.resize (numChains);
+    targets.reserve (numChains);
+
+    for (size_t i = 0; i < numChains; ++i)
+    {
+        chains[i] = std::make_unique<Chain>();
+        chains[i]->get<ProcIdx::FILT>().attach (bank, i * 2);
+        lfo[i] = std::make_unique<Lfo<float>> (*chains[i], values[i]);
+        targets.push_back ({*chains[i], *lfo[i]});
+    }
+
+    scratch.setSize (2, (int)def_params.lfoUpdateRate);
+}
+
+size_t OfflineEngine::getNumChains() const noexcept
+{
+    return chains.size();
+}
+
+void OfflineEngine::load (const Patch& patch, double sampleRate)
+{
+    juce::dsp::ProcessSpec spec{sampleRate, (juce::uint32)def_params.lfoUpdateRate, 2};
+
+    // the delay memory follows the highest rate rendered so far, not MAX_SAMPLE_RATE, that's
+    // several times less for every screener voice and batch worker
+    if (sampleRate > arenaSampleRate)
+        allocateArena (sampleRate);
+
+    // preparing clears whatever the previous patch left in the delays and filters
+    bank.prepare (spec.sampleRate);
+    for (size_t i = 0; i < chains.size(); ++i)
+    {
+        chains[i]->prepare (spec);
+        chains[i]->get<ProcIdx::OSC>().setBypass (false);
+        lfo[i]->prepare ({spec.sampleRate / def_params.lfoUpdateRate, spec.maximumBlockSize, spec.numChannels});
+    }
+
+    auto numChains = juce::jmin (patch.numChains, chains.size());
+
+    for (const auto& p : param_specs)
+    {
+        for (size_t c = 0; c < numChains; ++c)
+        {
+            auto value = patch.chains[isPerChain (p.id) ? c : 0][p.id];
+            if (std::isnan (value))
+                continue;
+
+            values[c][p.id] = value;
+            p.apply (targets[c], value);
+        }
+    }
+}
+
+void OfflineEngine::load (const Patch& patch, double sampleRate, std::uint64_t seed)
+{
+    // only the random tables, everything else is the same for any seed
+    Rng::forThread().seed (seed);
+    bank.rebuildRandomWave();
+
+    for (size_t i = 0; i < chains.size(); ++i)
+    {
+        chains[i]->get<ProcIdx::OSC>().rebuildRandomWave();
+        lfo[i]->rebuildRandomWave();
+    }
+
+    load (patch, sampleRate);
+}
+
+//==============================================================================
+void OfflineEngine::allocateArena (double maxSampleRate)
+{
+    jassert (maxSampleRate <= MAX_SAMPLE_RATE);
+    size_t arena_size = 0;
+
+    for (auto& chain : chains)
+    {
+        arena_size += chain->get<ProcIdx::DEL>().getArenaSize (maxSampleRate);
+        arena_size += chain->get<ProcIdx::REV>().getArenaSize (maxSampleRate);
+    }
+
+    arena.allocate (arena_size);
+    for (auto& chain : chains)
+    {
+        chain->get<ProcIdx::DEL>().setStorage (arena, maxSampleRate);
+        chain->get<ProcIdx::REV>().setStorage (arena, maxSampleRate);
+    }
+
+    arenaSampleRate = maxSampleRate;
+}
+
+void OfflineEngine::render (juce::AudioBuffer<float>& mix, juce::AudioBuffer<float>* stems, int startSample,
+                            int numSamples)
+{
+    jassert (stems == nullptr || stems->getNumChannels() >= (int)chains.size() * 2);
+    auto blockSize = (int)def_params.lfoUpdateRate;
+
+    for (auto pos = startSample; pos < startSample + numSamples; pos += blockSize)
+    {
+        auto n = juce::jmin (blockSize, startSample + numSamples - pos);
+
+        for (auto& l : lfo)
+            l->process();
+
+        for (size_t c = 0; c < chains.size(); ++c)
+        {
+            scratch.clear();
+            auto block = juce::dsp::AudioBlock<float> (scratch).getSubBlock (0, (size_t)n);
+            chains[c]->process (juce::dsp::ProcessContextReplacing<float> (block));
+
+            for (auto ch = 0; ch < mix.getNumChannels(); ++ch)
+                mix.addFrom (ch, pos, scratch, ch, 0, n);
+
+            if (stems != nullptr)
+                for (auto ch = 0; ch < 2; ++ch)
+                    stems->copyFrom ((int)c * 2 + ch, pos, scratch, ch, 0, n);
+        }
+    }
+}
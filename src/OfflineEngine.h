@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Chain.h"
+#include "Constants.h"
+#include "Filter.h"
+#include "Lfo.h"
+#include "Parameters.h"
+
+#include <JuceHeader.h>
+#include <memory>
+#include <vector>
+
+/** A private copy of the chains (filter bank, delay memory and LFOs included) that renders patches
+    offline, away from the audio thread. Nothing in it is shared, so every thread that renders gets
+    its own.
+*/
+class OfflineEngine
+{
+public:
+    explicit OfflineEngine (size_t numChains);
+
+    size_t getNumChains() const noexcept;
+
+    /** Clears whatever the previous patch left in the delays and filters and applies patch, the NaN
+        values keep what the previous patch set. The delay memory is reallocated if sampleRate is
+        higher than any rate loaded before */
+    void load (const Patch& patch, double sampleRate);
+    /** load() after reseeding the stream of the calling thread with seed and drawing every random
+        wave again from it, so a patch renders the same whatever the engine rendered before */
+    void load (const Patch& patch, double sampleRate, std::uint64_t seed);
+
+    /** Renders numSamples from startSample on, the chains summed into mix (stereo) and, if stems isn't
+        null, every chain into its own pair of channels of stems. The LFOs run every lfoUpdateRate
+        samples, like on the audio thread */
+    void render (juce::AudioBuffer<float>& mix, juce::AudioBuffer<float>* stems, int startSample, int numSamples);
+
+private:
+    FilterBank<float> bank;
+    DelayArena<float> arena;
+    double arenaSampleRate = 0; // the rate the arena is sized for, 0 before the first load
+    std::vector<std::unique_ptr<Chain>> chains;
+    std::vector<ParamValues> values;
+    std::vector<std::unique_ptr<Lfo<float>>> lfo;
+    std::vector<ParamTarget> targets;
+
+    juce::AudioBuffer<float> scratch;
+
+    //==============================================================================
+    void allocateArena (double maxSampleRate);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OfflineEngine)
+};
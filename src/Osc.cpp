@@ -1,16 +1,22 @@
 #include "Osc.h"
+#include "Random.h"
 
 template <typename Type>
 Osc<Type>::Osc()
 {
+    for (size_t i = 0; i < waves.size(); ++i)
+        initialiseWave (waves[i], static_cast<WaveType> (i + 1));
 }
 
 template <typename Type>
-void Osc<Type>::setWaveType (const WaveType choice)
+void Osc<Type>::rebuildRandomWave()
 {
-    auto& osc = pc.template get<ProcIdx::OSC>();
-    // Type dutyCycle = 0.25;
+    initialiseWave (waves[WaveType::RAND - 1], WaveType::RAND);
+}
 
+template <typename Type>
+void Osc<Type>::initialiseWave (juce::dsp::Oscillator<Type>& osc, const WaveType choice)
+{
     switch (choice)
     {
     case WaveType::SIN:
@@ -30,10 +36,7 @@ void Osc<Type>::setWaveType (const WaveType choice)
             [] (Type x)
             {
                 juce::ignoreUnused (x);
-                static std::random_device rd;
-                static std::mt19937 gen (rd());
-                static std::uniform_real_distribution<Type> dist (-1.0f, 1.0f);
-                return dist (gen);
+                return (Type)Rng::forThread().uniform (-1.0f, 1.0f);
             },
             2048);
         return;
@@ -56,6 +59,13 @@ void Osc<Type>::setWaveType (const WaveType choice)
     }
 }
 
+template <typename Type>
+void Osc<Type>::setWaveType (const WaveType choice)
+{
+    auto idx = static_cast<size_t> (choice) - 1;
+    wave = idx < waves.size() ? idx : 0;
+}
+
 template <typename Type>
 Type Osc<Type>::getBaseFrequency()
 {
@@ -71,13 +81,13 @@ void Osc<Type>::setBaseFrequency (const Type newValue)
 template <typename Type>
 Type Osc<Type>::getFrequency()
 {
-    return pc.template get<ProcIdx::OSC>().getFrequency();
+    return waves[wave].getFrequency();
 }
 
 template <typename Type>
 void Osc<Type>::setFrequency (const Type newValue)
 {
-    pc.template get<ProcIdx::OSC>().setFrequency (newValue);
+    waves[wave].setFrequency (newValue);
 }
 
 template <typename Type>
@@ -123,6 +133,13 @@ void Osc<Type>::setBypass (const bool b)
     bypass.store (b);
 }
 
+template <typename Type>
+void Osc<Type>::setNote (const Type ratio, const Type velocity)
+{
+    note_ratio = ratio;
+    note_velocity = velocity;
+}
+
 template <typename Type>
 void Osc<Type>::setPanner (const Type newValue)
 {
@@ -132,13 +149,14 @@ void Osc<Type>::setPanner (const Type newValue)
 template <typename Type>
 Type Osc<Type>::processSample (const Type input)
 {
-    return pc.template get<ProcIdx::OSC>().processSample (input);
+    return waves[wave].processSample (input);
 }
 
 template <typename Type>
 void Osc<Type>::reset() noexcept
 {
     pc.reset();
+    waves[wave].reset();
 }
 
 template <typename Type>
@@ -157,11 +175,12 @@ void Osc<Type>::process (const ProcessContext& context) noexcept
     for (size_t i = 0; i < numSamples; ++i)
     {
         Type fm_val = fm.processSample (0.f);
-        Type cur_max = param_limits.osc_freq_max - freq_base;
+        Type freq = juce::jmin (freq_base * note_ratio, (Type)getSpec (ParamId::OSC_FREQ).max);
+        Type cur_max = getSpec (ParamId::OSC_FREQ).max - freq;
         Type mod = fm.getFrequency() != 0 ? juce::jmap (fm_val, -1.f, 1.f, 0.f, cur_max) : 0;
 
-        pc.template get<ProcIdx::OSC>().setFrequency (freq_base + mod * fm_depth);
-        Type samp = pc.template get<ProcIdx::OSC>().processSample (left_in[i]);
+        waves[wave].setFrequency (freq + mod * fm_depth);
+        Type samp = waves[wave].processSample (left_in[i]) * note_velocity;
 
         if (!bypass.load())
         {
@@ -181,7 +200,10 @@ void Osc<Type>::prepare (const juce::dsp::ProcessSpec& spec)
     pc.prepare (spec);
     fm.prepare (spec);
 
-    pc.template get<ProcIdx::OSC>().initialise ([] (float x) { return std::sin (x); });
+    for (auto& w : waves)
+        w.prepare (spec);
+
+    wave = 0;
     pc.template get<ProcIdx::GAIN>().setGainDecibels (-100.0);
     pc.template get<ProcIdx::PAN>().setPan (0);
 
@@ -189,6 +211,8 @@ void Osc<Type>::prepare (const juce::dsp::ProcessSpec& spec)
     freq_base = 440;
     fm_freq = 0;
     fm_depth = 0;
+    note_ratio = 1;
+    note_velocity = 1;
 }
 
 // Explicit template instantiations to satisfy the linker
@@ -1,9 +1,10 @@
 #pragma once
 
 #include "Constants.h"
+#include "Parameters.h"
 #include <JuceHeader.h>
+#include <array>
 #include <atomic>
-#include <random>
 
 template <typename Type>
 class Osc
@@ -12,6 +13,8 @@ public:
     Osc<Type>();
 
     void setWaveType (const WaveType choice);
+    /** Draws the random wave again from the stream of the calling thread, allocates */
+    void rebuildRandomWave();
 
     Type getBaseFrequency();
     void setBaseFrequency (const Type newValue);
@@ -28,6 +31,8 @@ public:
     void setFmFreq (const Type freq);
     void setFmDepth (const Type depth);
     void setBypass (const bool b);
+    /** A played note, ratio scales the base frequency and velocity (0 to 1) the level */
+    void setNote (const Type ratio, const Type velocity);
 
     void setPanner (const Type newValue);
 
@@ -41,17 +46,25 @@ public:
 private:
     enum ProcIdx
     {
-        OSC,
         GAIN,
         PAN
     };
 
-    juce::dsp::ProcessorChain<juce::dsp::Oscillator<Type>, juce::dsp::Gain<Type>, juce::dsp::Panner<Type>> pc;
+    // one oscillator per wave type, built up front so switching the wave on the audio thread doesn't allocate
+    static constexpr size_t numWaves = WaveType::WSQR;
+    std::array<juce::dsp::Oscillator<Type>, numWaves> waves;
+    size_t wave = 0;
+
+    juce::dsp::ProcessorChain<juce::dsp::Gain<Type>, juce::dsp::Panner<Type>> pc;
     juce::dsp::Oscillator<Type> fm;
 
+    static void initialiseWave (juce::dsp::Oscillator<Type>& osc, const WaveType choice);
+
     Type freq_base;
     Type fm_freq;
     Type fm_depth;
+    Type note_ratio;
+    Type note_velocity;
 
     std::atomic<bool> bypass = false;
 };
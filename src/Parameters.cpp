@@ -0,0 +1,229 @@
+#include "Parameters.h"
+#include "Chain.h"
+#include "Lfo.h"
+
+//==============================================================================
+namespace ParamSetters
+{
+void masterGain (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::MASTER_GAIN>().setGainLinear (v);
+}
+
+void chanGain (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::CHAN_GAIN>().setGainDecibels (v);
+}
+
+void oscWaveType (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::OSC>().setWaveType (static_cast<WaveType> (juce::roundToInt (v)));
+}
+
+void oscFreq (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::OSC>().setBaseFrequency (v);
+}
+
+void oscGain (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::OSC>().setGainDecibels (v);
+}
+
+void oscFmFreq (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::OSC>().setFmFreq (v);
+}
+
+void oscFmDepth (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::OSC>().setFmDepth (v);
+}
+
+void oscPan (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::OSC>().setPanner (v);
+}
+
+void lfoWaveType (ParamTarget& t, float v)
+{
+    t.lfo.setWaveType (static_cast<WaveType> (juce::roundToInt (v)));
+}
+
+void lfoFreq (ParamTarget& t, float v)
+{
+    t.lfo.setFrequency (v);
+}
+
+void lfoGain (ParamTarget& t, float v)
+{
+    t.lfo.setGain (v);
+}
+
+void lfoRoute (ParamTarget& t, float v)
+{
+    t.lfo.setRoute ((size_t)juce::jmax (0, juce::roundToInt (v)));
+}
+
+void filtEnabled (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::FILT>().setEnabled (v >= 0.5f);
+}
+
+void filtType (ParamTarget& t, float v)
+{
+    static constexpr std::array<juce::dsp::LadderFilterMode, 6> ladder_types{
+        juce::dsp::LadderFilterMode::LPF12, juce::dsp::LadderFilterMode::LPF24, juce::dsp::LadderFilterMode::BPF12,
+        juce::dsp::LadderFilterMode::BPF24, juce::dsp::LadderFilterMode::HPF12, juce::dsp::LadderFilterMode::HPF24};
+
+    static constexpr std::array<SvfMode, 5> svf_types{SvfMode::LPF, SvfMode::BPF, SvfMode::HPF, SvfMode::NOTCH,
+                                                      SvfMode::PEAK};
+
+    constexpr auto& spec = getSpec (ParamId::FILT_TYPE);
+    auto k = (size_t)(juce::jlimit ((int)spec.min, (int)spec.max, juce::roundToInt (v)) - (int)spec.min);
+
+    if (k < ladder_types.size())
+        t.chain.get<ProcIdx::FILT>().setMode (ladder_types[k]);
+    else
+        t.chain.get<ProcIdx::FILT>().setMode (svf_types[k - ladder_types.size()]);
+}
+
+void filtCutoff (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::FILT>().setCutoffFrequencyHz (v);
+}
+
+void filtReso (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::FILT>().setResonance (v);
+}
+
+void filtDrive (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::FILT>().setDrive (v);
+}
+
+void delMix (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::DEL>().setWetLevel (v);
+}
+
+void delTime (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::DEL>().setDelayTime (0, v);
+    t.chain.get<ProcIdx::DEL>().setDelayTime (1, v + def_params.del_stereo_offset);
+}
+
+void delFeedback (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::DEL>().setFeedback (v);
+}
+
+void delDamping (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::DEL>().setDamping (v);
+}
+
+void delLowCut (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::DEL>().setLowCut (v);
+}
+
+void delTaps (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::DEL>().setNumTaps ((size_t)juce::jmax (0, juce::roundToInt (v)));
+}
+
+void delSpread (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::DEL>().setTapSpread (v);
+}
+
+void delPingPong (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::DEL>().setPingPong (v >= 0.5f);
+}
+
+void revMix (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::REV>().setWetLevel (v);
+}
+
+void revSize (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::REV>().setSize (v);
+}
+
+void revDecay (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::REV>().setDecayTime (v);
+}
+
+void revDamping (ParamTarget& t, float v)
+{
+    t.chain.get<ProcIdx::REV>().setDamping (v);
+}
+}; // namespace ParamSetters
+
+//==============================================================================
+const juce::Identifier& getPropertyId (const ParamId param)
+{
+    static const auto ids = []
+    {
+        std::array<juce::Identifier, (size_t)ParamId::NUM_PARAMS> a;
+        for (size_t i = 0; i < a.size(); ++i)
+            a[i] = param_specs[i].prop;
+        return a;
+    }();
+
+    return ids[(size_t)param];
+}
+
+const juce::Identifier& getModuleId (const Module module)
+{
+    static const auto ids = []
+    {
+        std::array<juce::Identifier, (size_t)Module::NUM_MODULES> a;
+        for (size_t i = 0; i < a.size(); ++i)
+            a[i] = module_specs[i].node;
+        return a;
+    }();
+
+    return ids[(size_t)module];
+}
+
+juce::Identifier getModuleChildId (const Module module, const size_t chain)
+{
+    jassert (module_specs[(size_t)module].group != nullptr);
+    return IDs::Group::IdsList{module_specs[(size_t)module].group}[chain];
+}
+
+float getDefaultValue (const ParamId param, const size_t chain)
+{
+    auto def = (float)getSpec (param).def;
+
+    // every chain starts on its own pitch and with its own LFO route
+    if (param == ParamId::OSC_FREQ)
+        return def + 10.0f * (float)chain;
+
+    // the routes go round, so a chain past the last one starts again at the first
+    if (param == ParamId::LFO_ROUTE)
+    {
+        const auto& spec = getSpec (param);
+        auto numRoutes = (size_t)(spec.max - spec.min) + 1;
+        return (float)spec.min + (float)(((size_t)(spec.def - spec.min) + chain) % numRoutes);
+    }
+
+    return def;
+}
+
+juce::var toVar (const ParamId param, const float value)
+{
+    switch (getSpec (param).kind)
+    {
+    case ParamKind::CHOICE: return juce::roundToInt (value);
+    case ParamKind::TOGGLE: return value >= 0.5f;
+    case ParamKind::REAL:
+    default: return (double)value;
+    }
+}
@@ -0,0 +1,346 @@
+#pragma once
+
+#include "Constants.h"
+#include <JuceHeader.h>
+#include <array>
+#include <cstddef>
+
+/** Every parameter the audio thread knows about, the index of a ParamCommand */
+enum class ParamId : juce::uint16
+{
+    MASTER_GAIN,
+    CHAN_GAIN,
+
+    OSC_WAVE_TYPE,
+    OSC_FREQ,
+    OSC_GAIN,
+    OSC_FM_FREQ,
+    OSC_FM_DEPTH,
+    OSC_PAN,
+
+    LFO_WAVE_TYPE,
+    LFO_FREQ,
+    LFO_GAIN,
+    LFO_ROUTE,
+
+    FILT_ENABLED,
+    FILT_TYPE,
+    FILT_CUTOFF,
+    FILT_RESO,
+    FILT_DRIVE,
+
+    DEL_MIX,
+    DEL_TIME,
+    DEL_FEEDBACK,
+    DEL_DAMPING,
+    DEL_LOWCUT,
+    DEL_TAPS,
+    DEL_SPREAD,
+    DEL_PINGPONG,
+
+    REV_MIX,
+    REV_SIZE,
+    REV_DECAY,
+    REV_DAMPING,
+
+    NUM_PARAMS
+};
+
+//==============================================================================
+/** How a parameter is stored in the state tree and shown by the GUI */
+enum class ParamKind
+{
+    REAL,
+    CHOICE, // a combo box item id
+    TOGGLE
+};
+
+/** The state tree node of a group of parameters, with one child per chain unless group is null */
+enum class Module
+{
+    MASTER,
+    CHAN,
+    OSC,
+    LFO,
+    FILT,
+    DELAY,
+    REVERB,
+
+    NUM_MODULES
+};
+
+struct ModuleSpec
+{
+    const char* node;  // the child of the root
+    const char* group; // the prefix of its per chain children, see IDs::Group
+};
+
+inline constexpr std::array<ModuleSpec, (size_t)Module::NUM_MODULES> module_specs{{
+    {"OUTPUT_GAIN", nullptr},
+    {"OUTPUT_GAIN", "CHAN"},
+    {"OSC", "OSC"},
+    {"LFO", "LFO"},
+    {"FILT", "FILT"},
+    {"DELAY", "DELAY"},
+    {"REVERB", "REVERB"},
+}};
+
+//==============================================================================
+/** The processors the parameters of one chain land on, defined in Chain.h */
+struct ParamTarget;
+using ParamSetter = void (*) (ParamTarget&, float);
+
+/** Where each parameter goes on the audio thread, defined in Parameters.cpp */
+namespace ParamSetters
+{
+void masterGain (ParamTarget&, float);
+void chanGain (ParamTarget&, float);
+
+void oscWaveType (ParamTarget&, float);
+void oscFreq (ParamTarget&, float);
+void oscGain (ParamTarget&, float);
+void oscFmFreq (ParamTarget&, float);
+void oscFmDepth (ParamTarget&, float);
+void oscPan (ParamTarget&, float);
+
+void lfoWaveType (ParamTarget&, float);
+void lfoFreq (ParamTarget&, float);
+void lfoGain (ParamTarget&, float);
+void lfoRoute (ParamTarget&, float);
+
+void filtEnabled (ParamTarget&, float);
+void filtType (ParamTarget&, float);
+void filtCutoff (ParamTarget&, float);
+void filtReso (ParamTarget&, float);
+void filtDrive (ParamTarget&, float);
+
+void delMix (ParamTarget&, float);
+void delTime (ParamTarget&, float);
+void delFeedback (ParamTarget&, float);
+void delDamping (ParamTarget&, float);
+void delLowCut (ParamTarget&, float);
+void delTaps (ParamTarget&, float);
+void delSpread (ParamTarget&, float);
+void delPingPong (ParamTarget&, float);
+
+void revMix (ParamTarget&, float);
+void revSize (ParamTarget&, float);
+void revDecay (ParamTarget&, float);
+void revDamping (ParamTarget&, float);
+}; // namespace ParamSetters
+
+//==============================================================================
+/** Everything about one parameter. The state tree, the broadcasters, the GUI ranges, the defaults
+    and the audio thread dispatch are all generated from param_specs
+*/
+struct ParamSpec
+{
+    ParamId id;
+    Module module;
+    const char* prop; // the property in the state tree
+    double min, max, def;
+    double skew;
+    const char* unit;
+    ParamKind kind;
+    ParamSetter apply;
+};
+
+// clang-format off
+inline constexpr std::array<ParamSpec, (size_t)ParamId::NUM_PARAMS> param_specs{{
+    // id                       module          prop        min     max     default skew  unit  kind               setter
+    {ParamId::MASTER_GAIN,      Module::MASTER, "master",   0,      1,      0.5,    1,    "%",  ParamKind::REAL,   ParamSetters::masterGain}, // linear
+    {ParamId::CHAN_GAIN,        Module::CHAN,   "gain",     -100,   0,      0,      3,    "dB", ParamKind::REAL,   ParamSetters::chanGain},
+
+    {ParamId::OSC_WAVE_TYPE,    Module::OSC,    "waveType", 1,      7,      1,      1,    "",   ParamKind::CHOICE, ParamSetters::oscWaveType}, // WaveType
+    {ParamId::OSC_FREQ,         Module::OSC,    "freq",     0,      22000,  440,    0.4,  "Hz", ParamKind::REAL,   ParamSetters::oscFreq},
+    {ParamId::OSC_GAIN,         Module::OSC,    "gain",     -100,   0,      -25,    3,    "dB", ParamKind::REAL,   ParamSetters::oscGain},
+    {ParamId::OSC_FM_FREQ,      Module::OSC,    "fm_freq",  0,      150,    0,      1,    "Hz", ParamKind::REAL,   ParamSetters::oscFmFreq},
+    {ParamId::OSC_FM_DEPTH,     Module::OSC,    "fm_depth", 0,      1,      0,      0.3,  "",   ParamKind::REAL,   ParamSetters::oscFmDepth},
+    {ParamId::OSC_PAN,          Module::OSC,    "pan",      -1,     1,      0,      1,    "",   ParamKind::REAL,   ParamSetters::oscPan},
+
+    {ParamId::LFO_WAVE_TYPE,    Module::LFO,    "waveType", 1,      4,      1,      1,    "",   ParamKind::CHOICE, ParamSetters::lfoWaveType}, // WaveType
+    {ParamId::LFO_FREQ,         Module::LFO,    "freq",     0,      30,     0,      0.6,  "Hz", ParamKind::REAL,   ParamSetters::lfoFreq},
+    {ParamId::LFO_GAIN,         Module::LFO,    "gain",     0,      1,      0,      0.3,  "",   ParamKind::REAL,   ParamSetters::lfoGain}, // linear
+    {ParamId::LFO_ROUTE,        Module::LFO,    "route",    1,      8,      2,      1,    "",   ParamKind::CHOICE, ParamSetters::lfoRoute}, // lfo_routes
+
+    {ParamId::FILT_ENABLED,     Module::FILT,   "enabled",  0,      1,      0,      1,    "",   ParamKind::TOGGLE, ParamSetters::filtEnabled},
+    {ParamId::FILT_TYPE,        Module::FILT,   "filtType", 1,      11,     1,      1,    "",   ParamKind::CHOICE, ParamSetters::filtType}, // 1-6 ladder, 7-11 SVF
+    {ParamId::FILT_CUTOFF,      Module::FILT,   "cutOff",   0.1,    22000,  0.1,    0.4,  "Hz", ParamKind::REAL,   ParamSetters::filtCutoff},
+    {ParamId::FILT_RESO,        Module::FILT,   "reso",     0,      1,      0,      1,    "",   ParamKind::REAL,   ParamSetters::filtReso},
+    {ParamId::FILT_DRIVE,       Module::FILT,   "drive",    1,      10,     1,      0.7,  "",   ParamKind::REAL,   ParamSetters::filtDrive},
+
+    {ParamId::DEL_MIX,          Module::DELAY,  "mix",      0,      1,      0,      1,    "",   ParamKind::REAL,   ParamSetters::delMix},
+    {ParamId::DEL_TIME,         Module::DELAY,  "time",     0,      1.79,   0.7,    1,    "",   ParamKind::REAL,   ParamSetters::delTime}, // seconds
+    {ParamId::DEL_FEEDBACK,     Module::DELAY,  "feedback", 0,      1,      0.5,    1,    "",   ParamKind::REAL,   ParamSetters::delFeedback},
+    {ParamId::DEL_DAMPING,      Module::DELAY,  "damping",  200,    20000,  20000,  0.4,  "Hz", ParamKind::REAL,   ParamSetters::delDamping}, // feedback low-pass, the max leaves the repeats untouched
+    {ParamId::DEL_LOWCUT,       Module::DELAY,  "lowCut",   20,     2000,   20,     0.4,  "Hz", ParamKind::REAL,   ParamSetters::delLowCut}, // feedback high-pass, the min leaves the repeats untouched
+    {ParamId::DEL_TAPS,         Module::DELAY,  "taps",     1,      8,      1,      1,    "",   ParamKind::CHOICE, ParamSetters::delTaps},
+    {ParamId::DEL_SPREAD,       Module::DELAY,  "spread",   0,      1,      0,      1,    "",   ParamKind::REAL,   ParamSetters::delSpread},
+    {ParamId::DEL_PINGPONG,     Module::DELAY,  "pingPong", 0,      1,      0,      1,    "",   ParamKind::TOGGLE, ParamSetters::delPingPong},
+
+    {ParamId::REV_MIX,          Module::REVERB, "mix",      0,      1,      0,      1,    "",   ParamKind::REAL,   ParamSetters::revMix},
+    {ParamId::REV_SIZE,         Module::REVERB, "size",     0,      1,      0.5,    1,    "",   ParamKind::REAL,   ParamSetters::revSize},
+    {ParamId::REV_DECAY,        Module::REVERB, "decay",    0.1,    10,     2,      0.5,  "s",  ParamKind::REAL,   ParamSetters::revDecay}, // RT60
+    {ParamId::REV_DAMPING,      Module::REVERB, "damping",  500,    20000,  8000,   0.4,  "Hz", ParamKind::REAL,   ParamSetters::revDamping},
+}};
+// clang-format on
+
+constexpr const ParamSpec& getSpec (const ParamId param)
+{
+    return param_specs[(size_t)param];
+}
+
+constexpr bool isSchemaOrdered()
+{
+    for (size_t i = 0; i < param_specs.size(); ++i)
+        if ((size_t)param_specs[i].id != i)
+            return false;
+
+    return true;
+}
+
+static_assert (isSchemaOrdered(), "param_specs has to be in ParamId order");
+
+/** False for the parameters with one value for every chain, like the master gain */
+constexpr bool isPerChain (const ParamId param)
+{
+    return module_specs[(size_t)getSpec (param).module].group != nullptr;
+}
+
+// message thread helpers, built from param_specs
+const juce::Identifier& getPropertyId (const ParamId param);
+const juce::Identifier& getModuleId (const Module module);
+juce::Identifier getModuleChildId (const Module module, const size_t chain);
+float getDefaultValue (const ParamId param, const size_t chain);
+juce::var toVar (const ParamId param, const float value);
+
+//==============================================================================
+/** The current value of every parameter of one chain */
+struct ParamValues
+{
+    std::array<float, (size_t)ParamId::NUM_PARAMS> values{};
+
+    float& operator[] (const ParamId param) noexcept
+    {
+        return values[(size_t)param];
+    }
+
+    float operator[] (const ParamId param) const noexcept
+    {
+        return values[(size_t)param];
+    }
+};
+
+/** Every parameter of every chain, a whole patch handed to the audio thread in one pointer swap */
+struct Patch
+{
+    std::array<ParamValues, MAX_NUM_CHAINS> chains;
+    size_t numChains = 0;
+};
+
+/** Two patches to morph between. B is kept as its difference from A, so a morph position t is
+    a + t * delta, one multiply-add per value */
+struct MorphPair
+{
+    Patch a;
+    std::array<ParamValues, MAX_NUM_CHAINS> delta;
+};
+
+//==============================================================================
+/** A parameter change for the audio thread, applied sampleOffset samples into the next block */
+struct ParamCommand
+{
+    juce::uint32 sampleOffset;
+    juce::uint16 chain;
+    ParamId param;
+    float value;
+};
+
+//==============================================================================
+/** The parameters an LFO can modulate, indexed by route - 1, and the limit it modulates towards */
+struct LfoRoute
+{
+    ParamId param;
+    double limit;
+};
+
+inline constexpr std::array<LfoRoute, 8> lfo_routes{{
+    // ch
+    {ParamId::CHAN_GAIN, getSpec (ParamId::CHAN_GAIN).min},
+    // osc
+    {ParamId::OSC_FREQ, getSpec (ParamId::OSC_FREQ).max},
+    {ParamId::OSC_GAIN, getSpec (ParamId::OSC_GAIN).min},
+    {ParamId::OSC_FM_FREQ, getSpec (ParamId::OSC_FM_FREQ).max},
+    {ParamId::OSC_FM_DEPTH, getSpec (ParamId::OSC_FM_DEPTH).max},
+    // filter
+    {ParamId::FILT_CUTOFF, getSpec (ParamId::FILT_CUTOFF).max},
+    {ParamId::FILT_RESO, getSpec (ParamId::FILT_RESO).max},
+    {ParamId::FILT_DRIVE, getSpec (ParamId::FILT_DRIVE).max},
+}};
+
+static_assert (lfo_routes.size() == (size_t)getSpec (ParamId::LFO_ROUTE).max, "the route range has to match lfo_routes");
+
+//==============================================================================
+/** A range the randomizer draws from, in the units of the spec. A CHOICE is drawn as a whole
+    number and never lands on skip (0 for none), a TOGGLE is on with the probability max */
+struct RandomRange
+{
+    double min, max;
+    double skip = 0;
+};
+
+/** How the randomizer draws a parameter of a chain, half of the chains get the suppressed range.
+    The draws are clamped to the spec range, and the parameters not listed aren't randomized */
+struct RandomSpec
+{
+    ParamId id;
+    RandomRange range, suppressed;
+};
+
+// clang-format off
+inline constexpr std::array<RandomSpec, 21> random_specs{{
+    // id                       range                       suppressed
+    {ParamId::OSC_WAVE_TYPE,    {1,     3},                 {1,     3}},                // SIN to SQR
+    {ParamId::OSC_FREQ,         {0,     param_limits.C8},   {0,     param_limits.C8 * 0.05}},
+    {ParamId::OSC_FM_FREQ,      {0,     75},                {0,     15}},
+    {ParamId::OSC_FM_DEPTH,     {0,     0.25},              {0,     0.05}},
+    {ParamId::OSC_PAN,          {-1,    1},                 {-0.1,  0.1}},
+
+    {ParamId::LFO_ROUTE,        {2,     5},                 {2,     5}},                // OSC_FREQ to OSC_FM_DEPTH
+    {ParamId::LFO_WAVE_TYPE,    {1,     4},                 {1,     4, WaveType::SQR}}, // no square on slow LFOs
+    {ParamId::LFO_FREQ,         {0,     15},                {0,     0.3}},
+    {ParamId::LFO_GAIN,         {0,     0.05},              {0,     0.5}},              // see random_tremolo_gain
+
+    // the filter isn't randomized
+
+    {ParamId::DEL_MIX,          {0,     1},                 {0,     1}},
+    {ParamId::DEL_TIME,         {0,     1.79},              {0,     1.79}},
+    {ParamId::DEL_FEEDBACK,     {0,     0.9},               {0,     0.9}},
+    {ParamId::DEL_DAMPING,      {200,   20000},             {200,   20000}},
+    {ParamId::DEL_LOWCUT,       {20,    220},               {20,    220}},
+    {ParamId::DEL_TAPS,         {1,     4},                 {1,     4}},
+    {ParamId::DEL_SPREAD,       {0,     1},                 {0,     1}},
+    {ParamId::DEL_PINGPONG,     {0,     0.25},              {0,     0.25}},
+
+    {ParamId::REV_MIX,          {0,     0.5},               {0,     0.5}},
+    {ParamId::REV_SIZE,         {0,     1},                 {0,     1}},
+    {ParamId::REV_DECAY,        {0.1,   3.4},               {0.1,   3.4}},
+    {ParamId::REV_DAMPING,      {500,   20000},             {500,   20000}},
+}};
+// clang-format on
+
+// an LFO on the oscillator gain is a tremolo, it gets the whole gain range with either range
+inline constexpr RandomRange random_tremolo_gain{0, 1};
+
+constexpr bool isRandomSpecFilled()
+{
+    // a row left out of the count would default to MASTER_GAIN
+    for (size_t i = 0; i < random_specs.size(); ++i)
+        for (size_t j = 0; j < i; ++j)
+            if (random_specs[i].id == random_specs[j].id)
+                return false;
+
+    return true;
+}
+
+static_assert (isRandomSpecFilled(), "every row of random_specs has to be a different parameter");
@@ -0,0 +1,138 @@
+#include "PatchScreener.h"
+
+//==============================================================================
+class PatchScreener::Voice
+{
+public:
+    explicit Voice (size_t numChains) : engine (numChains)
+    {
+        auto numSamples = (int)(screening.sample_rate * screening.length);
+        mix.setSize (2, numSamples);
+        spectrum.resize ((size_t)fft.getSize() * 2);
+    }
+
+    Analysis render (const Patch& patch)
+    {
+        engine.load (patch, screening.sample_rate);
+
+        mix.clear();
+        engine.render (mix, nullptr, 0, mix.getNumSamples());
+
+        return analyse();
+    }
+
+private:
+    OfflineEngine engine;
+
+    juce::AudioBuffer<float> mix;
+    juce::dsp::FFT fft{11};
+    juce::dsp::WindowingFunction<float> window{(size_t)fft.getSize(), juce::dsp::WindowingFunction<float>::hann};
+    std::vector<float> spectrum;
+
+    Analysis analyse()
+    {
+        Analysis a;
+        auto numSamples = mix.getNumSamples();
+        auto quarter = numSamples / 4;
+
+        auto getRms = [this] (int start, int num)
+        {
+            auto sum = 0.0f;
+            for (auto ch = 0; ch < mix.getNumChannels(); ++ch)
+                sum += juce::square (mix.getRMSLevel (ch, start, num));
+            return std::sqrt (sum / (float)mix.getNumChannels());
+        };
+
+        for (auto ch = 0; ch < mix.getNumChannels(); ++ch)
+            a.peak = juce::jmax (a.peak, mix.getMagnitude (ch, 0, numSamples));
+
+        a.rms = getRms (0, numSamples);
+        auto second = getRms (quarter, quarter);
+        a.growth = second > 0 ? getRms (numSamples - quarter, quarter) / second : 0;
+
+        // spectral flatness of the last fft window, both channels summed
+        auto size = juce::jmin (fft.getSize(), numSamples);
+        std::fill (spectrum.begin(), spectrum.end(), 0.0f);
+        for (auto ch = 0; ch < mix.getNumChannels(); ++ch)
+            juce::FloatVectorOperations::add (spectrum.data(), mix.getReadPointer (ch, numSamples - size), size);
+
+        window.multiplyWithWindowingTable (spectrum.data(), (size_t)size);
+        fft.performFrequencyOnlyForwardTransform (spectrum.data());
+
+        auto numBins = (size_t)fft.getSize() / 2;
+        double logSum = 0, sum = 0;
+        for (size_t i = 1; i <= numBins; ++i)
+        {
+            auto power = (double)juce::square (spectrum[i]) + 1e-12;
+            logSum += std::log (power);
+            sum += power;
+        }
+
+        a.flatness = (float)(std::exp (logSum / (double)numBins) / (sum / (double)numBins));
+        return a;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Voice)
+};
+
+//==============================================================================
+PatchScreener::PatchScreener (size_t numChains, size_t numWorkers) : pool ((int)juce::jmax (numWorkers, (size_t)1))
+{
+    for (size_t i = 0; i < juce::jmax (numWorkers, (size_t)1); ++i)
+        voices.push_back (std::make_unique<Voice> (numChains));
+}
+
+PatchScreener::~PatchScreener()
+{
+    pool.removeAllJobs (true, 2000);
+}
+
+size_t PatchScreener::pickBest (const std::vector<Patch>& candidates, double deadline)
+{
+    std::vector<float> scores (candidates.size(), std::numeric_limits<float>::lowest());
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> running{voices.size()};
+    juce::WaitableEvent done;
+
+    for (auto& v : voices)
+    {
+        pool.addJob (
+            [&, voice = v.get()]
+            {
+                for (auto i = next++; i < candidates.size(); i = next++)
+                {
+                    if (juce::Time::getMillisecondCounterHiRes() > deadline)
+                        break;
+
+                    scores[i] = score (voice->render (candidates[i]));
+                }
+
+                if (--running == 0)
+                    done.signal();
+            });
+    }
+
+    done.wait();
+
+    // an unrendered candidate only wins if none of them were rendered
+    return (size_t)std::distance (scores.begin(), std::max_element (scores.begin(), scores.end()));
+}
+
+float PatchScreener::score (const Analysis& analysis) noexcept
+{
+    auto rms = juce::Decibels::gainToDecibels (analysis.rms, -120.0f);
+
+    // silence loses to anything that makes a sound
+    if (rms < screening.silence)
+        return -1000.0f + rms;
+
+    auto total = -std::abs (rms - screening.target_rms) - analysis.flatness * screening.flatness_cost;
+
+    if (analysis.peak > screening.clip)
+        total -= 100.0f;
+
+    if (analysis.growth > screening.runaway)
+        total -= 100.0f;
+
+    return total;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Constants.h"
+#include "OfflineEngine.h"
+#include "Parameters.h"
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/** Renders a short snippet of candidate patches offline and picks the best one, so the randomizer
+    doesn't send silent, clipping or runaway patches to the audio thread.
+
+    Every worker has its own OfflineEngine and renders at screening.sample_rate, which is plenty to
+    judge the level and the spectrum. The candidates are shared between the workers until they're
+    all done or the deadline passes.
+*/
+class PatchScreener
+{
+public:
+    PatchScreener (size_t numChains, size_t numWorkers);
+    ~PatchScreener();
+
+    /** Blocks until every candidate is scored or deadline (Time::getMillisecondCounterHiRes) passes,
+        the candidates that didn't make it score the lowest. Only call it from one thread at a time */
+    size_t pickBest (const std::vector<Patch>& candidates, double deadline);
+
+    struct Analysis
+    {
+        float peak = 0;     // linear, both channels
+        float rms = 0;      // linear, both channels
+        float growth = 0;   // rms of the last quarter over the rms of the second one
+        float flatness = 0; // spectral flatness of the end of the snippet, 0 (tonal) to 1 (noise)
+    };
+
+    static float score (const Analysis& analysis) noexcept;
+
+private:
+    //==============================================================================
+    class Voice;
+    std::vector<std::unique_ptr<Voice>> voices;
+    juce::ThreadPool pool;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PatchScreener)
+};
@@ -1,34 +1,66 @@
 #include "RandSequencer.h"
 
-RandSequencer::RandSequencer (std::function<void()> func) : setRandParams (func)
+StepClock::StepClock (const int t)
 {
-    time = 1000;
+    time = t;
     enabled = false;
 }
 
-void RandSequencer::start()
+void StepClock::setEnabled (const bool b)
 {
-    startTimer (time);
+    enabled = b;
 }
 
-void RandSequencer::stop()
+bool StepClock::isEnabled() const
 {
-    stopTimer();
+    return enabled;
 }
 
-void RandSequencer::setEnabled (const bool b)
+void StepClock::setTime (const int t)
 {
-    enabled = b;
+    time = t;
 }
 
-void RandSequencer::setTime (const int t)
+int StepClock::getTime() const
 {
-    time = t;
-    start();
+    return time;
+}
+
+void StepClock::prepare (double sampleRate)
+{
+    sample_rate = sampleRate;
+    countdown = 0;
+}
+
+juce::uint32 StepClock::advance (juce::uint32 numSamples) noexcept
+{
+    // the first step comes right when it's enabled
+    if (!enabled.load (std::memory_order_relaxed))
+    {
+        countdown = 0;
+        return numSamples;
+    }
+
+    if (countdown >= numSamples)
+    {
+        countdown -= numSamples;
+        return numSamples;
+    }
+
+    auto step = static_cast<juce::uint32> (juce::jmax (0.0, countdown));
+
+    // one step per block at most, an interval shorter than the rest of the block waits for the next one
+    countdown = juce::jmax (0.0, countdown + time.load (std::memory_order_relaxed) * sample_rate / 1000.0 - numSamples);
+    return step;
+}
+
+//==============================================================================
+RandSequencer::RandSequencer (std::function<void()> func) : housekeeping (func)
+{
+    startTimerHz (30);
 }
 
 void RandSequencer::timerCallback()
 {
-    if (enabled)
-        setRandParams();
+    housekeeping();
 }
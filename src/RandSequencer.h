@@ -1,22 +1,50 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <atomic>
 #include <functional>
 
-class RandSequencer : private juce::Timer
+/** Counts the samples to the next step on the audio thread. The interval and the on/off state can be
+    changed from any thread */
+class StepClock
 {
 public:
-    RandSequencer (std::function<void()> func);
-    void start();
-    void stop();
+    StepClock (const int t = 1000);
 
     void setEnabled (const bool b);
+    bool isEnabled() const;
     void setTime (const int t);
+    int getTime() const;
+
+    // audio thread
+    void prepare (double sampleRate);
+    /** Moves the clock numSamples on, returns the offset of the step in this block or numSamples if there's none */
+    juce::uint32 advance (juce::uint32 numSamples) noexcept;
+
+private:
+    std::atomic<int> time;
+    std::atomic<bool> enabled;
+
+    double sample_rate = 44100;
+    double countdown = 0; // samples to the next step
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StepClock)
+};
+
+//==============================================================================
+/** The clock of the randomizing sequencer.
+
+    The audio thread advances it every block and gets the exact sample of the next step, so the steps
+    don't depend on the message thread at all. The message thread only gets a housekeeping call
+    (picking up the played patches) at a steady rate.
+*/
+class RandSequencer : public StepClock, private juce::Timer
+{
+public:
+    RandSequencer (std::function<void()> func);
 
 private:
-    int time;
-    bool enabled;
-    std::function<void()> setRandParams;
+    std::function<void()> housekeeping;
 
     void timerCallback() override;
 
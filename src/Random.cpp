@@ -0,0 +1,109 @@
+#include "Random.h"
+#include <atomic>
+#include <random>
+
+namespace
+{
+std::uint64_t splitmix64 (std::uint64_t& x) noexcept
+{
+    auto z = (x += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+std::uint64_t getStartupSeed()
+{
+    std::random_device rd;
+    return ((std::uint64_t)rd() << 32) ^ rd();
+}
+
+std::atomic<std::uint64_t> global_seed{getStartupSeed()};
+// streams made since the global seed was set, each one is jumped that many times
+std::atomic<std::uint64_t> num_streams{0};
+std::atomic<bool> seed_fixed{false};
+} // namespace
+
+//==============================================================================
+Rng::Rng (std::uint64_t seed) noexcept
+{
+    this->seed (seed);
+}
+
+void Rng::seed (std::uint64_t seed) noexcept
+{
+    for (auto& word : s)
+        word = splitmix64 (seed);
+}
+
+void Rng::jump() noexcept
+{
+    static constexpr std::uint64_t jumps[] = {0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa,
+                                              0x39abdc4529b1661c};
+
+    std::uint64_t t[4]{};
+
+    for (auto jump : jumps)
+    {
+        for (auto b = 0; b < 64; ++b)
+        {
+            if (jump & (std::uint64_t (1) << b))
+                for (size_t i = 0; i < 4; ++i)
+                    t[i] ^= s[i];
+
+            (*this)();
+        }
+    }
+
+    for (size_t i = 0; i < 4; ++i)
+        s[i] = t[i];
+}
+
+void Rng::fill (float* dest, size_t num) noexcept
+{
+    for (size_t i = 0; i < num; ++i)
+        dest[i] = nextFloat();
+}
+
+int Rng::uniformInt (const int min, const int max) noexcept
+{
+    jassert (min <= max);
+
+    // Lemire's multiply-shift, the bias of a range this small against 2^32 doesn't matter here
+    auto range = (std::uint64_t)((std::int64_t)max - (std::int64_t)min + 1);
+    return min + (int)((((*this)() >> 32) * range) >> 32);
+}
+
+//==============================================================================
+void Rng::setGlobalSeed (std::uint64_t seed) noexcept
+{
+    global_seed.store (seed);
+    num_streams.store (0);
+    seed_fixed.store (true);
+}
+
+std::uint64_t Rng::getGlobalSeed() noexcept
+{
+    return global_seed.load();
+}
+
+bool Rng::isGlobalSeedFixed() noexcept
+{
+    return seed_fixed.load();
+}
+
+Rng Rng::createStream() noexcept
+{
+    Rng rng (global_seed.load());
+
+    for (auto n = num_streams.fetch_add (1); n > 0; --n)
+        rng.jump();
+
+    return rng;
+}
+
+Rng& Rng::forThread() noexcept
+{
+    thread_local Rng rng = createStream();
+    return rng;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <cstdint>
+
+/** [0, 1) to [min, max), so one batch of uniforms can serve any number of ranges */
+constexpr float mapRange (const float u, const float min, const float max) noexcept
+{
+    return min + u * (max - min);
+}
+
+//==============================================================================
+/** xoshiro256** generator (Blackman & Vigna), 256 bits of state and a handful of shifts per draw.
+
+    It's a UniformRandomBitGenerator, so the std algorithms take it, but the members below draw
+    directly without any std distribution. Streams made by createStream() are the global seed
+    jumped 2^128 draws apart once per stream, so they never overlap and the same seed gives the
+    same streams in the same order.
+*/
+class Rng
+{
+public:
+    using result_type = std::uint64_t;
+
+    explicit Rng (std::uint64_t seed = 0) noexcept;
+
+    /** The state is expanded from the seed with splitmix64, so any seed (0 included) is fine */
+    void seed (std::uint64_t seed) noexcept;
+    /** Same as 2^128 draws */
+    void jump() noexcept;
+
+    static constexpr result_type min() noexcept
+    {
+        return 0;
+    }
+
+    static constexpr result_type max() noexcept
+    {
+        return ~result_type (0);
+    }
+
+    result_type operator()() noexcept
+    {
+        const auto result = rotl (s[1] * 5, 7) * 9;
+        const auto t = s[1] << 17;
+
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl (s[3], 45);
+
+        return result;
+    }
+
+    /** [0, 1), from the top 24 bits so every value is exact in a float */
+    float nextFloat() noexcept
+    {
+        return (float)((*this)() >> 40) * 0x1.0p-24f;
+    }
+
+    /** num values in [0, 1) */
+    void fill (float* dest, size_t num) noexcept;
+
+    float uniform (const float min, const float max) noexcept
+    {
+        return mapRange (nextFloat(), min, max);
+    }
+
+    /** [min, max], both included */
+    int uniformInt (const int min, const int max) noexcept;
+
+    bool chance (const float probability) noexcept
+    {
+        return nextFloat() < probability;
+    }
+
+    //==============================================================================
+    /** Every stream made after this starts from the new seed */
+    static void setGlobalSeed (std::uint64_t seed) noexcept;
+    static std::uint64_t getGlobalSeed() noexcept;
+    /** True once setGlobalSeed() was called, the startup seed is a random one */
+    static bool isGlobalSeedFixed() noexcept;
+
+    /** The next independent stream of the global seed */
+    static Rng createStream() noexcept;
+    /** One stream per thread, made the first time the thread asks for it */
+    static Rng& forThread() noexcept;
+
+private:
+    std::uint64_t s[4];
+
+    static constexpr std::uint64_t rotl (const std::uint64_t x, const int k) noexcept
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+};
@@ -0,0 +1,144 @@
+#include "Recorder.h"
+
+Recorder::Recorder (size_t numSources) : num_sources (numSources)
+{
+    writer_thread.startThread();
+}
+
+Recorder::~Recorder()
+{
+    // the audio has stopped by now, nothing else can hold a session
+    delete pending_session.exchange (nullptr);
+    delete retired_session.exchange (nullptr);
+    delete active_session;
+    writer_thread.stopThread (2000);
+}
+
+bool Recorder::start (const juce::File& directory, const Format format, const bool withChains)
+{
+    stop();
+
+    if (!directory.createDirectory())
+        return false;
+
+    std::unique_ptr<juce::AudioFormat> audio_format;
+    if (format == Format::FLAC)
+        audio_format = std::make_unique<juce::FlacAudioFormat>();
+    else
+        audio_format = std::make_unique<juce::WavAudioFormat>();
+
+    auto quality = format == Format::FLAC ? recording.flac_quality : 0;
+    auto stamp = juce::Time::getCurrentTime().formatted ("%Y-%m-%d_%H-%M-%S");
+    auto name = stamp;
+
+    auto getFile = [&] (size_t source)
+    {
+        return directory.getChildFile (name + (source == 0 ? juce::String ("_out") : "_ch" + juce::String (source)))
+            .withFileExtension (audio_format->getFileExtensions()[0]);
+    };
+
+    // the names only change every second and an output stream appends to what's there, so a quick
+    // restart gets a name of its own instead of writing into the files the last session may still hold
+    for (auto n = 2; getFile (0).exists(); ++n)
+        name = stamp + "_" + juce::String (n);
+
+    auto session = std::make_unique<Session>();
+    session->writers.resize (num_sources);
+
+    for (size_t s = 0; s < (withChains ? num_sources : 1); ++s)
+    {
+        auto file = getFile (s).getNonexistentSibling (false);
+
+        auto stream = file.createOutputStream();
+        if (stream == nullptr)
+            continue;
+
+        std::unique_ptr<juce::AudioFormatWriter> writer (audio_format->createWriterFor (
+            stream.get(), sample_rate.load(), 2, recording.bit_depth, {}, quality));
+
+        // the writer owns the stream once it's created
+        if (writer == nullptr)
+            continue;
+
+        stream.release();
+        session->writers[s] = std::make_unique<juce::AudioFormatWriter::ThreadedWriter> (
+            writer.release(), writer_thread, recording.fifo_size);
+    }
+
+    if (std::none_of (session->writers.begin(), session->writers.end(), [] (auto& w) { return w != nullptr; }))
+        return false;
+
+    dropped = 0;
+    is_recording = true;
+    handOver (session.release());
+    return true;
+}
+
+void Recorder::stop()
+{
+    if (!is_recording)
+        return;
+
+    is_recording = false;
+    handOver (new Session());
+}
+
+bool Recorder::isRecording() const noexcept
+{
+    return is_recording;
+}
+
+int Recorder::getNumDropped() const noexcept
+{
+    return dropped.load (std::memory_order_relaxed);
+}
+
+void Recorder::handOver (Session* session)
+{
+    // a session the audio thread never picked up is closed right away
+    delete retired_session.exchange (nullptr);
+    delete pending_session.exchange (session);
+
+    startTimerHz (10);
+}
+
+/** Closes the session the audio thread handed back, its writers flush what's left to disk */
+void Recorder::timerCallback()
+{
+    delete retired_session.exchange (nullptr);
+
+    // the audio thread retires the old session before it clears the pending one
+    if (pending_session.load() == nullptr && retired_session.load() == nullptr)
+        stopTimer();
+}
+
+//==============================================================================
+void Recorder::prepare (double sampleRate)
+{
+    sample_rate = sampleRate;
+}
+
+void Recorder::update() noexcept
+{
+    // only one session is handed back at a time, a newer one waits for the message thread to collect it
+    if (pending_session.load() != nullptr && retired_session.load() == nullptr)
+    {
+        retired_session.store (active_session);
+        active_session = pending_session.exchange (nullptr);
+    }
+}
+
+bool Recorder::isActive() const noexcept
+{
+    return active_session != nullptr && !active_session->writers.empty();
+}
+
+void Recorder::write (size_t source, const float* left, const float* right, int numSamples) noexcept
+{
+    if (source >= active_session->writers.size() || active_session->writers[source] == nullptr)
+        return;
+
+    const float* channels[] = {left, right};
+    if (!active_session->writers[source]->write (channels, numSamples))
+        dropped.fetch_add (numSamples, std::memory_order_relaxed);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Constants.h"
+#include "Routing.h"
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/** Records the outputs, and the chains if asked, to WAV or FLAC files.
+
+    The audio thread only pushes its blocks into the FIFO of a juce::AudioFormatWriter::ThreadedWriter
+    per file, the encoding and the disk writes happen on the writer thread. If the disk is too slow for
+    a while the FIFO fills up and the samples that don't fit are dropped (and counted), the audio thread
+    never waits.
+
+    A recording is a session of writers handed to the audio thread like a patch, with one atomic swap
+    at the top of a block. Stopping hands over an empty one, the old session is closed (and its files
+    flushed) on the message thread.
+*/
+class Recorder : public RoutingTap, private juce::Timer
+{
+public:
+    enum class Format
+    {
+        WAV,
+        FLAC
+    };
+
+    /** One source for the outputs and one per chain, like the RoutingTap sources */
+    explicit Recorder (size_t numSources);
+    ~Recorder() override;
+
+    // message thread
+    /** Starts writing to a new set of files in directory, false if none of them could be created */
+    bool start (const juce::File& directory, const Format format, const bool withChains);
+    void stop();
+    bool isRecording() const noexcept;
+    /** Samples dropped because a writer's FIFO was full, since the recording started */
+    int getNumDropped() const noexcept;
+
+    // audio thread
+    void prepare (double sampleRate);
+    /** Takes the newest session, at the top of a block */
+    void update() noexcept;
+    bool isActive() const noexcept override;
+    void write (size_t source, const float* left, const float* right, int numSamples) noexcept override;
+
+private:
+    struct Session
+    {
+        std::vector<std::unique_ptr<juce::AudioFormatWriter::ThreadedWriter>> writers; // nullptr if not recorded
+    };
+
+    size_t num_sources;
+    std::atomic<double> sample_rate{44100};
+    bool is_recording = false;
+
+    juce::TimeSliceThread writer_thread{"disk writer"};
+    std::atomic<Session*> pending_session{nullptr};
+    std::atomic<Session*> retired_session{nullptr};
+    Session* active_session = nullptr; // audio thread
+    std::atomic<int> dropped{0};
+
+    void handOver (Session* session);
+    void timerCallback() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Recorder)
+};
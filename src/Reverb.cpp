@@ -0,0 +1,350 @@
+#include "Reverb.h"
+#include <JuceHeader.h>
+
+namespace
+{
+// mutually prime-ish delay times (ms), for the smallest room size
+constexpr std::array<double, 16> baseDelayTimes{23.3, 29.1, 31.7, 37.9, 41.3, 43.9, 47.3, 53.9,
+                                                59.3, 61.7, 67.1, 71.9, 73.7, 79.1, 83.9, 89.3};
+
+template <size_t numLines>
+double getBaseDelayTime (size_t line) noexcept
+{
+    // spread the lines over the whole table
+    return baseDelayTimes[line * (baseDelayTimes.size() / numLines)];
+}
+} // namespace
+
+//==============================================================================
+template <typename Type, size_t numLines>
+FdnReverb<Type, numLines>::FdnReverb()
+{
+    constexpr auto lanes = Vec::SIMDNumElements;
+    const auto outGain = Type (1) / std::sqrt (Type (numLines / 2));
+
+    for (size_t g = 0; g < numGroups; ++g)
+    {
+        dampingStates[g] = Vec::expand (Type (0));
+        leftOutGains[g] = Vec::expand (Type (0));
+        rightOutGains[g] = Vec::expand (Type (0));
+
+        // even lines go to the left, odd lines to the right, with alternating signs
+        for (size_t lane = 0; lane < lanes; ++lane)
+        {
+            auto line = g * lanes + lane;
+            auto sign = (line / 2) % 2 == 0 ? Type (1) : Type (-1);
+
+            if (line % 2 == 0)
+                leftOutGains[g].set (lane, sign * outGain);
+            else
+                rightOutGains[g].set (lane, sign * outGain);
+        }
+    }
+
+    updateDelayTimes();
+    updateDecayGains();
+    updateDamping();
+}
+
+//==============================================================================
+/** The amount of arena samples needed to run the reverb at the biggest size at any rate up to maxSampleRate */
+template <typename Type, size_t numLines>
+size_t FdnReverb<Type, numLines>::getArenaSize (double maxSampleRate) const noexcept
+{
+    size_t total = 0;
+
+    for (size_t k = 0; k < numLines; ++k)
+        total += DelayArena<Type>::getAlignedSize (getDelayLineSize (k, getSizeScale (Type (1)), maxSampleRate));
+
+    return total;
+}
+
+//==============================================================================
+/** Takes getArenaSize (maxSampleRate) samples of arena, prepare() can't go past that rate */
+template <typename Type, size_t numLines>
+void FdnReverb<Type, numLines>::setStorage (DelayArena<Type>& arena, double maxSampleRate) noexcept
+{
+    for (size_t k = 0; k < numLines; ++k)
+    {
+        auto lineCapacity = getDelayLineSize (k, getSizeScale (Type (1)), maxSampleRate);
+        delayLines[k].setStorage (arena.acquire (lineCapacity), lineCapacity);
+    }
+}
+
+//==============================================================================
+template <typename Type, size_t numLines>
+void FdnReverb<Type, numLines>::prepare (const juce::dsp::ProcessSpec& spec)
+{
+    jassert (spec.numChannels <= 2);
+    jassert (spec.sampleRate <= MAX_SAMPLE_RATE);
+    sampleRate = (Type)spec.sampleRate;
+
+    // the lines are sized for the biggest room, so changing the size never resizes them
+    for (size_t k = 0; k < numLines; ++k)
+        delayLines[k].resize (
+            juce::jmin (getDelayLineSize (k, getSizeScale (Type (1)), sampleRate), delayLines[k].getCapacity()));
+
+    updateDelayTimes();
+    updateDecayGains();
+    updateDamping();
+    reset();
+}
+
+//==============================================================================
+template <typename Type, size_t numLines>
+void FdnReverb<Type, numLines>::reset() noexcept
+{
+    for (auto& dline : delayLines)
+        dline.clear();
+
+    for (auto& state : dampingStates)
+        state = Vec::expand (Type (0));
+}
+
+//==============================================================================
+template <typename Type, size_t numLines>
+void FdnReverb<Type, numLines>::setWetLevel (Type newValue) noexcept
+{
+    jassert (newValue >= Type (0) && newValue <= Type (1));
+    wetLevel = newValue;
+}
+
+//==============================================================================
+template <typename Type, size_t numLines>
+void FdnReverb<Type, numLines>::setSize (Type newValue) noexcept
+{
+    jassert (newValue >= Type (0) && newValue <= Type (1));
+    size = juce::jlimit (Type (0), Type (1), newValue);
+    updateDelayTimes();
+    updateDecayGains();
+}
+
+//==============================================================================
+/** The time (seconds) it takes the tail to decay by 60 dB */
+template <typename Type, size_t numLines>
+void FdnReverb<Type, numLines>::setDecayTime (Type newValue) noexcept
+{
+    jassert (newValue > Type (0));
+    decayTime = juce::jmax (Type (0.01), newValue);
+    updateDecayGains();
+}
+
+//==============================================================================
+template <typename Type, size_t numLines>
+void FdnReverb<Type, numLines>::setDamping (Type newValue) noexcept
+{
+    dampingFreq = newValue;
+    updateDamping();
+}
+
+//==============================================================================
+template <typename Type, size_t numLines>
+template <typename ProcessContext>
+void FdnReverb<Type, numLines>::process (const ProcessContext& context) noexcept
+{
+    auto& inputBlock = context.getInputBlock();
+    auto& outputBlock = context.getOutputBlock();
+    auto numSamples = outputBlock.getNumSamples();
+    auto numChannels = outputBlock.getNumChannels();
+
+    jassert (inputBlock.getNumSamples() == numSamples);
+    jassert (inputBlock.getNumChannels() == numChannels);
+
+    // no storage attached or nothing to add, pass the input through
+    if (delayLines[0].size() == 0 || wetLevel == Type (0))
+    {
+        if (context.usesSeparateInputAndOutputBlocks())
+            outputBlock.copyFrom (inputBlock);
+        return;
+    }
+
+    juce::ScopedNoDenormals noDenormals;
+    constexpr auto lanes = Vec::SIMDNumElements;
+    constexpr auto householder = Type (-2) / Type (numLines);
+    constexpr auto inputGain = Type (0.5);
+
+    const auto* left_in = inputBlock.getChannelPointer (0);
+    const auto* right_in = inputBlock.getChannelPointer (numChannels > 1 ? 1 : 0);
+    auto* left_out = outputBlock.getChannelPointer (0);
+    auto* right_out = outputBlock.getChannelPointer (numChannels > 1 ? 1 : 0);
+
+    alignas (Vec::SIMDRegisterSize) Type lines[numLines]{};
+
+    for (size_t i = 0; i < numSamples; ++i)
+    {
+        auto inL = left_in[i];
+        auto inR = right_in[i];
+
+        for (size_t k = 0; k < numLines; ++k)
+            lines[k] = delayLines[k].get (delayTimesSample[k]);
+
+        Type outL = 0, outR = 0, total = 0;
+
+        for (size_t g = 0; g < numGroups; ++g)
+        {
+            auto x = Vec::fromRawArray (lines + g * lanes);
+
+            outL += (x * leftOutGains[g]).sum();
+            outR += (x * rightOutGains[g]).sum();
+
+            dampingStates[g] += (x - dampingStates[g]) * dampingCoef;
+            total += dampingStates[g].sum();
+        }
+
+        // Householder feedback: y = x - 2/N * sum(x), then the per-line decay
+        for (size_t g = 0; g < numGroups; ++g)
+        {
+            auto y = (dampingStates[g] + total * householder) * decayGains[g];
+            y.copyToRawArray (lines + g * lanes);
+        }
+
+        // the left input goes into the even lines and the right input into the odd ones
+        for (size_t k = 0; k < numLines; ++k)
+            delayLines[k].push (lines[k] + inputGain * (k % 2 == 0 ? inL : inR));
+
+        left_out[i] = inL + wetLevel * outL;
+
+        if (numChannels > 1)
+            right_out[i] = inR + wetLevel * outR;
+    }
+}
+
+//==============================================================================
+/** Maps the size parameter [0, 1] to a multiplier of the base delay times */
+template <typename Type, size_t numLines>
+Type FdnReverb<Type, numLines>::getSizeScale (Type newSize) noexcept
+{
+    return juce::jmap (newSize, Type (0.3), Type (1.5));
+}
+
+//==============================================================================
+template <typename Type, size_t numLines>
+size_t FdnReverb<Type, numLines>::getDelayLineSize (size_t line, Type scale, double rate) noexcept
+{
+    return (size_t)std::ceil (getBaseDelayTime<numLines> (line) * 0.001 * scale * rate) + 1;
+}
+
+//==============================================================================
+template <typename Type, size_t numLines>
+void FdnReverb<Type, numLines>::updateDelayTimes() noexcept
+{
+    auto scale = getSizeScale (size);
+
+    for (size_t k = 0; k < numLines; ++k)
+    {
+        auto maxDelaySamples = delayLines[k].size() > 0 ? delayLines[k].size() - 1 : 0;
+        auto samples = (size_t)juce::roundToInt (getBaseDelayTime<numLines> (k) * 0.001 * scale * sampleRate);
+        delayTimesSample[k] = juce::jmin (samples, maxDelaySamples);
+    }
+}
+
+//==============================================================================
+template <typename Type, size_t numLines>
+void FdnReverb<Type, numLines>::updateDecayGains() noexcept
+{
+    constexpr auto lanes = Vec::SIMDNumElements;
+    auto scale = getSizeScale (size);
+
+    // every line loses 60 dB over decayTime, whatever its length
+    for (size_t k = 0; k < numLines; ++k)
+    {
+        auto lineSeconds = (Type)(getBaseDelayTime<numLines> (k) * 0.001) * scale;
+        decayGains[k / lanes].set (k % lanes, std::pow (Type (10), Type (-3) * lineSeconds / decayTime));
+    }
+}
+
+//==============================================================================
+template <typename Type, size_t numLines>
+void FdnReverb<Type, numLines>::updateDamping() noexcept
+{
+    if (dampingFreq >= (Type)getSpec (ParamId::REV_DAMPING).max)
+    {
+        dampingCoef = Type (1);
+        return;
+    }
+
+    auto freq = juce::jmin (dampingFreq, sampleRate * Type (0.49));
+    dampingCoef = Type (1) - std::exp (-juce::MathConstants<Type>::twoPi * freq / sampleRate);
+}
+
+template class FdnReverb<float, 8>;
+template void FdnReverb<float, 8>::process<juce::dsp::ProcessContextReplacing<float>> (
+    const juce::dsp::ProcessContextReplacing<float>& context);
+
+template class FdnReverb<float, 16>;
+template void FdnReverb<float, 16>::process<juce::dsp::ProcessContextReplacing<float>> (
+    const juce::dsp::ProcessContextReplacing<float>& context);
+
+// BENCHMARKS
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+/** The reverb of every chain at its most expensive settings, against its budget of 10% of a core */
+class FdnReverbBenchmark : public juce::UnitTest
+{
+public:
+    FdnReverbBenchmark() : juce::UnitTest ("FdnReverb load", "Benchmarks")
+    {
+    }
+
+    void runTest() override
+    {
+        benchmark<8> (DEFAULT_NUM_CHAINS);
+        benchmark<16> (DEFAULT_NUM_CHAINS);
+    }
+
+private:
+    template <size_t numLines>
+    void benchmark (size_t numChains)
+    {
+        constexpr double sampleRate = 48000, seconds = 10;
+        constexpr int blockSize = 256;
+        constexpr auto numBlocks = (int)(sampleRate * seconds) / blockSize;
+
+        beginTest (juce::String (numChains) + " chains, " + juce::String (numLines) + " lines");
+
+        std::vector<FdnReverb<float, numLines>> reverbs (numChains);
+        DelayArena<float> arena;
+        arena.allocate (reverbs.size() * reverbs[0].getArenaSize (sampleRate));
+
+        for (auto& reverb : reverbs)
+        {
+            reverb.setStorage (arena, sampleRate);
+            reverb.prepare ({sampleRate, (juce::uint32)blockSize, 2});
+            reverb.setWetLevel (0.5f);
+            reverb.setSize (1.0f);
+            reverb.setDecayTime (10.0f);
+        }
+
+        juce::AudioBuffer<float> buffer ((int)numChains * 2, blockSize);
+        auto random = getRandom();
+
+        // an impulse now and then keeps the tails going without the noise dominating the time
+        auto start = juce::Time::getHighResolutionTicks();
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            buffer.clear();
+            if (b % 64 == 0)
+                for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+                    buffer.setSample (ch, 0, random.nextFloat());
+
+            for (size_t c = 0; c < numChains; ++c)
+            {
+                auto block = juce::dsp::AudioBlock<float> (buffer).getSubsetChannelBlock (c * 2, 2);
+                reverbs[c].process (juce::dsp::ProcessContextReplacing<float> (block));
+            }
+        }
+        auto elapsed = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+
+        auto load = elapsed / seconds * 100.0;
+        logMessage (juce::String (load, 2) + "% of a core, " + juce::String (load / (double)numChains, 2)
+                    + "% per chain");
+
+        if constexpr (numLines == 8) // the one the chains use
+            expectLessThan (load, 10.0, "the reverbs of " + juce::String (numChains) + " chains");
+    }
+};
+
+static FdnReverbBenchmark fdnReverbBenchmark;
+
+#endif
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Constants.h"
+#include "Delay.h"
+#include "Parameters.h"
+#include <JuceHeader.h>
+
+/** Feedback delay network reverb.
+
+    numLines delay lines are fed back into each other through a Householder matrix
+    (I - 2/N * 1 * 1^T), which only needs the sum of all the lines, so the whole
+    feedback path (damping, mixing and decay) runs on SIMD registers, SIMDNumElements lines at a time.
+    The delay lines are carved out of a DelayArena, like the ones of Delay.
+*/
+template <typename Type, size_t numLines = 8>
+class FdnReverb
+{
+public:
+    using Vec = juce::dsp::SIMDRegister<Type>;
+    static_assert (numLines % Vec::SIMDNumElements == 0, "numLines must fill whole SIMD registers");
+    static_assert (numLines <= 16, "there are only 16 base delay times");
+
+    //==============================================================================
+    FdnReverb();
+    size_t getArenaSize (double maxSampleRate) const noexcept;
+    void setStorage (DelayArena<Type>& arena, double maxSampleRate) noexcept;
+    void prepare (const juce::dsp::ProcessSpec& spec);
+    void reset() noexcept;
+
+    void setWetLevel (Type newValue) noexcept;
+    void setSize (Type newValue) noexcept;
+    void setDecayTime (Type newValue) noexcept;
+    void setDamping (Type newValue) noexcept;
+
+    template <typename ProcessContext>
+    void process (const ProcessContext& context) noexcept;
+
+private:
+    //==============================================================================
+    static constexpr size_t numGroups = numLines / Vec::SIMDNumElements;
+
+    std::array<DelayLine<Type>, numLines> delayLines;
+    std::array<size_t, numLines> delayTimesSample{};
+
+    std::array<Vec, numGroups> decayGains;
+    std::array<Vec, numGroups> dampingStates;
+    std::array<Vec, numGroups> leftOutGains;
+    std::array<Vec, numGroups> rightOutGains;
+
+    Type wetLevel{(Type)getSpec (ParamId::REV_MIX).def};
+    Type size{(Type)getSpec (ParamId::REV_SIZE).def};
+    Type decayTime{(Type)getSpec (ParamId::REV_DECAY).def};
+    Type dampingFreq{(Type)getSpec (ParamId::REV_DAMPING).def};
+    Type dampingCoef{Type (1)};
+
+    Type sampleRate{Type (44.1e3)};
+
+    //==============================================================================
+    static Type getSizeScale (Type newSize) noexcept;
+    static size_t getDelayLineSize (size_t line, Type scale, double rate) noexcept;
+    void updateDelayTimes() noexcept;
+    void updateDecayGains() noexcept;
+    void updateDamping() noexcept;
+};
@@ -0,0 +1,686 @@
+#include "Routing.h"
+
+namespace
+{
+// how RoutingNode::Kind and ProcIdx are written in a ROUTING tree, in enum order
+const char* const kind_names[] = {"stage", "mix", "output"};
+const char* const stage_names[] = {"OSC", "FILT", "DEL", "REV", "CHAN_GAIN", "MASTER_GAIN"};
+
+template <size_t numNames>
+int findName (const char* const (&names)[numNames], const juce::String& name)
+{
+    for (size_t i = 0; i < numNames; ++i)
+        if (name == names[i])
+            return (int)i;
+
+    return -1;
+}
+} // namespace
+
+// ROUTING GRAPH
+//==============================================================================
+void RoutingGraph::clear()
+{
+    nodes.clear();
+    connections.clear();
+}
+
+RoutingGraph::NodeId RoutingGraph::addNode (const RoutingNode& node)
+{
+    nodes.push_back (node);
+    return nodes.size() - 1;
+}
+
+/** Connecting the same nodes again only changes the gain */
+void RoutingGraph::connect (NodeId source, NodeId destination, float gain)
+{
+    jassert (source < nodes.size() && destination < nodes.size() && source != destination);
+    if (source >= nodes.size() || destination >= nodes.size() || source == destination)
+        return;
+
+    for (auto& c : connections)
+    {
+        if (c.source == source && c.destination == destination)
+        {
+            c.gain = gain;
+            return;
+        }
+    }
+
+    connections.push_back ({source, destination, gain});
+}
+
+void RoutingGraph::disconnect (NodeId source, NodeId destination)
+{
+    connections.erase (std::remove_if (connections.begin(), connections.end(),
+                                       [&] (const Connection& c)
+                                       { return c.source == source && c.destination == destination; }),
+                       connections.end());
+}
+
+size_t RoutingGraph::getNumNodes() const noexcept
+{
+    return nodes.size();
+}
+
+std::unique_ptr<RoutingPlan> RoutingGraph::compile (size_t maxNumNodes) const
+{
+    if (nodes.size() > maxNumNodes || !hasValidNodes())
+        return nullptr;
+
+    // Kahn's algorithm, a node's level is one more than the deepest of its sources
+    std::vector<size_t> inDegree (nodes.size(), 0), level (nodes.size(), 0), order;
+    std::vector<std::vector<NodeId>> destinations (nodes.size());
+
+    for (auto& c : connections)
+    {
+        destinations[c.source].push_back (c.destination);
+        ++inDegree[c.destination];
+    }
+
+    for (NodeId id = 0; id < nodes.size(); ++id)
+        if (inDegree[id] == 0)
+            order.push_back (id);
+
+    for (size_t k = 0; k < order.size(); ++k)
+    {
+        for (auto dest : destinations[order[k]])
+        {
+            level[dest] = std::max (level[dest], level[order[k]] + 1);
+
+            if (--inDegree[dest] == 0)
+                order.push_back (dest);
+        }
+    }
+
+    if (order.size() != nodes.size())
+        return nullptr; // there's a cycle
+
+    std::stable_sort (order.begin(), order.end(), [&] (NodeId a, NodeId b) { return level[a] < level[b]; });
+
+    auto plan = std::make_unique<RoutingPlan>();
+    plan->steps.reserve (nodes.size());
+    plan->inputs.reserve (connections.size());
+
+    for (auto id : order)
+    {
+        RoutingPlan::Step step{nodes[id], id, plan->inputs.size(), 0};
+
+        for (auto& c : connections)
+            if (c.destination == id)
+                plan->inputs.push_back ({c.source, c.gain});
+
+        step.numInputs = plan->inputs.size() - step.firstInput;
+
+        if (plan->levels.empty() || level[id] != level[plan->steps.back().slot])
+            plan->levels.push_back ({plan->steps.size(), 0});
+
+        ++plan->levels.back().numSteps;
+        plan->steps.push_back (step);
+
+        // in topological order, the last stage seen of a chain is the one nothing of it comes after
+        if (step.node.kind == RoutingNode::Kind::STAGE)
+        {
+            if (step.node.index >= plan->chainOutputs.size())
+                plan->chainOutputs.resize (step.node.index + 1, RoutingPlan::noSlot);
+
+            plan->chainOutputs[step.node.index] = step.slot;
+        }
+    }
+
+    return plan;
+}
+
+/** A stage that runs twice a block would process its state twice, and the indices size the plan */
+bool RoutingGraph::hasValidNodes() const
+{
+    constexpr size_t numStages = (size_t)ProcIdx::MASTER_GAIN + 1;
+    std::vector<bool> used ((size_t)MAX_NUM_CHAINS * numStages, false);
+
+    for (auto& node : nodes)
+    {
+        if (node.kind == RoutingNode::Kind::OUTPUT && node.index >= maxNumOutputPairs)
+            return false;
+
+        if (node.kind != RoutingNode::Kind::STAGE)
+            continue;
+
+        if (node.index >= (size_t)MAX_NUM_CHAINS || (size_t)node.stage >= numStages)
+            return false;
+
+        auto slot = node.index * numStages + (size_t)node.stage;
+        if (used[slot])
+            return false;
+
+        used[slot] = true;
+    }
+
+    return true;
+}
+
+RoutingGraph RoutingGraph::createDefault (size_t numChains, size_t numOutputPairs)
+{
+    RoutingGraph graph;
+    std::vector<NodeId> outputs;
+
+    for (size_t pair = 0; pair < juce::jmax (numOutputPairs, (size_t)1); ++pair)
+        outputs.push_back (graph.addNode ({RoutingNode::Kind::OUTPUT, ProcIdx::OSC, pair}));
+
+    for (size_t i = 0; i < numChains; ++i)
+    {
+        auto previous = graph.addNode ({RoutingNode::Kind::STAGE, ProcIdx::OSC, i});
+
+        for (auto stage : {ProcIdx::FILT, ProcIdx::DEL, ProcIdx::REV, ProcIdx::CHAN_GAIN, ProcIdx::MASTER_GAIN})
+        {
+            auto next = graph.addNode ({RoutingNode::Kind::STAGE, stage, i});
+            graph.connect (previous, next);
+            previous = next;
+        }
+
+        graph.connect (previous, outputs[i % outputs.size()]);
+    }
+
+    return graph;
+}
+
+juce::ValueTree RoutingGraph::toValueTree() const
+{
+    juce::ValueTree tree (IDs::ROUTING);
+
+    for (auto& node : nodes)
+        tree.appendChild (juce::ValueTree (IDs::NODE, {{IDs::kind, kind_names[(size_t)node.kind]},
+                                                       {IDs::stage, stage_names[(size_t)node.stage]},
+                                                       {IDs::index, (int)node.index}}),
+                          nullptr);
+
+    for (auto& c : connections)
+        tree.appendChild (juce::ValueTree (IDs::CONNECTION, {{IDs::source, (int)c.source},
+                                                             {IDs::destination, (int)c.destination},
+                                                             {IDs::gain, c.gain}}),
+                          nullptr);
+
+    return tree;
+}
+
+RoutingGraph RoutingGraph::fromValueTree (const juce::ValueTree& tree)
+{
+    if (!tree.hasType (IDs::ROUTING))
+        return {};
+
+    RoutingGraph graph;
+
+    for (const auto& child : tree)
+    {
+        if (child.hasType (IDs::NODE))
+        {
+            auto kind = findName (kind_names, child[IDs::kind].toString());
+            auto stage = findName (stage_names, child.getProperty (IDs::stage, stage_names[0]).toString());
+            auto index = (int)child[IDs::index];
+
+            if (kind < 0 || stage < 0 || index < 0)
+                return {};
+
+            graph.addNode ({(RoutingNode::Kind)kind, (ProcIdx)stage, (size_t)index});
+        }
+        else if (child.hasType (IDs::CONNECTION))
+        {
+            // only the nodes that came before it, connect() would assert on the others
+            auto source = (int)child[IDs::source];
+            auto destination = (int)child[IDs::destination];
+            auto numNodes = (int)graph.getNumNodes();
+
+            if (source < 0 || destination < 0 || source >= numNodes || destination >= numNodes || source == destination)
+                return {};
+
+            graph.connect ((NodeId)source, (NodeId)destination, (float)child.getProperty (IDs::gain, 1.0f));
+        }
+    }
+
+    // a huge index or the same stage twice, the ones compile() would refuse
+    if (!graph.hasValidNodes())
+        return {};
+
+    return graph;
+}
+
+// ROUTING PROCESSOR
+//==============================================================================
+RoutingProcessor::RoutingProcessor (std::vector<Chain*> chainsToRun, FilterBank<float>& bank)
+    : chains (std::move (chainsToRun)), filterBank (bank), filterChannels (bank.getNumLanes(), nullptr)
+{
+}
+
+RoutingProcessor::~RoutingProcessor()
+{
+    delete pendingPlan.exchange (nullptr);
+    delete retiredPlan.exchange (nullptr);
+}
+
+void RoutingProcessor::prepare (const juce::dsp::ProcessSpec& spec)
+{
+    maxBlockSize = (int)spec.maximumBlockSize;
+
+    // every channel is rounded up to whole cache lines, so they all start aligned and the
+    // mixer can run over whole SIMD registers past the end of a block
+    slotChannels.resize (maxNumNodes * 2);
+    slotArena.allocate ((slotChannels.size() + tapChannels.size())
+                        * DelayArena<float>::getAlignedSize ((size_t)maxBlockSize));
+
+    for (auto& ch : slotChannels)
+        ch = slotArena.acquire ((size_t)maxBlockSize);
+
+    for (auto& ch : tapChannels)
+        ch = slotArena.acquire ((size_t)maxBlockSize);
+}
+
+/** The pool has to outlive this processor, nullptr runs everything on the audio thread */
+void RoutingProcessor::setWorkerPool (WorkerPool* newPool) noexcept
+{
+    workerPool = newPool;
+}
+
+/** Called from the message thread */
+void RoutingProcessor::setPlan (std::unique_ptr<RoutingPlan> newPlan)
+{
+    jassert (newPlan != nullptr);
+    if (newPlan == nullptr)
+        return;
+
+    // the plan the audio thread handed back last time, and a pending one it never picked up
+    delete retiredPlan.exchange (nullptr);
+    delete pendingPlan.exchange (newPlan.release());
+}
+
+void RoutingProcessor::addTap (RoutingTap* tap)
+{
+    jassert (tap != nullptr);
+    taps.push_back (tap);
+}
+
+void RoutingProcessor::process (juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) noexcept
+{
+    // only swap when the previous plan has been collected, so there's never more than one to hand back
+    if (pendingPlan.load() != nullptr && retiredPlan.load() == nullptr)
+    {
+        if (auto* next = pendingPlan.exchange (nullptr))
+        {
+            retiredPlan.store (activePlan.release());
+            activePlan.reset (next);
+        }
+    }
+
+    if (activePlan == nullptr || maxBlockSize == 0)
+    {
+        outputBuffer.clear (startSample, numSamples);
+        return;
+    }
+
+    juce::ScopedNoDenormals noDenormals;
+
+    for (int done = 0; done < numSamples; done += maxBlockSize)
+        processPlan (*activePlan, outputBuffer, startSample + done, std::min (maxBlockSize, numSamples - done));
+}
+
+//==============================================================================
+template <typename Fn>
+void RoutingProcessor::forEach (size_t numTasks, Fn&& fn) noexcept
+{
+    if (workerPool != nullptr)
+    {
+        workerPool->run (numTasks, fn);
+        return;
+    }
+
+    for (size_t t = 0; t < numTasks; ++t)
+        fn (t);
+}
+
+void RoutingProcessor::processPlan (const RoutingPlan& plan, juce::AudioBuffer<float>& outputBuffer, int startSample,
+                                    int numSamples) noexcept
+{
+    auto n = (size_t)numSamples;
+    auto numVecs = (n + Vec::SIMDNumElements - 1) / Vec::SIMDNumElements;
+    constexpr auto lanesPerGroup = FilterBank<float>::lanesPerGroup;
+
+    for (auto& level : plan.levels)
+    {
+        std::fill (filterChannels.begin(), filterChannels.end(), nullptr);
+
+        // the nodes of a level don't depend on each other, so they can run on any thread
+        forEach (level.numSteps,
+                 [&] (size_t s)
+                 {
+                     auto& step = plan.steps[level.firstStep + s];
+                     float* channels[] = {slotChannels[step.slot * 2], slotChannels[step.slot * 2 + 1]};
+
+                     for (size_t ch = 0; ch < 2; ++ch)
+                         mixInputs (plan, step, ch, numVecs);
+
+                     if (step.node.kind != RoutingNode::Kind::STAGE || step.node.index >= chains.size())
+                         return;
+
+                     // the filters are left to the bank, every node writes its own lanes
+                     if (step.node.stage == ProcIdx::FILT)
+                     {
+                         auto lane = chains[step.node.index]->get<ProcIdx::FILT>().getFirstLane();
+                         filterChannels[lane] = channels[0];
+                         filterChannels[lane + 1] = channels[1];
+                         return;
+                     }
+
+                     juce::dsp::AudioBlock<float> block (channels, 2, n);
+                     processStage (step.node, block);
+                 });
+
+        // then the filters of the level, one SIMD group per task
+        auto numFilterGroups = (filterChannels.size() + lanesPerGroup - 1) / lanesPerGroup;
+
+        forEach (numFilterGroups,
+                 [&] (size_t group)
+                 {
+                     auto firstLane = group * lanesPerGroup;
+                     auto numLanes = std::min (lanesPerGroup, filterChannels.size() - firstLane);
+
+                     if (std::any_of (filterChannels.begin() + (long)firstLane,
+                                      filterChannels.begin() + (long)(firstLane + numLanes),
+                                      [] (float* ch) { return ch != nullptr; }))
+                         filterBank.process (firstLane, filterChannels.data() + firstLane, numLanes, n);
+                 });
+    }
+
+    outputBuffer.clear (startSample, numSamples);
+
+    for (auto& step : plan.steps)
+    {
+        if (step.node.kind != RoutingNode::Kind::OUTPUT)
+            continue;
+
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            auto dest = (int)step.node.index * 2 + ch;
+
+            if (dest < outputBuffer.getNumChannels())
+                outputBuffer.addFrom (dest, startSample, slotChannels[step.slot * 2 + (size_t)ch], numSamples);
+        }
+    }
+
+    writeTaps (plan, outputBuffer, startSample, numSamples);
+}
+
+void RoutingProcessor::writeTaps (const RoutingPlan& plan, const juce::AudioBuffer<float>& outputBuffer,
+                                  int startSample, int numSamples) noexcept
+{
+    auto numOutputs = outputBuffer.getNumChannels();
+    bool outputsMixed = false;
+
+    for (auto* tap : taps)
+    {
+        if (!tap->isActive())
+            continue;
+
+        // every pair the device has, even and odd channels summed apart, a mono device goes to both sides
+        if (numOutputs > 0 && !std::exchange (outputsMixed, true))
+        {
+            for (int ch = 0; ch < 2; ++ch)
+            {
+                auto* mix = tapChannels[(size_t)ch];
+                juce::FloatVectorOperations::clear (mix, numSamples);
+
+                for (auto source = juce::jmin (ch, numOutputs - 1); source < numOutputs; source += 2)
+                    juce::FloatVectorOperations::add (mix, outputBuffer.getReadPointer (source, startSample),
+                                                      numSamples);
+            }
+        }
+
+        if (numOutputs > 0)
+            tap->write (0, tapChannels[0], tapChannels[1], numSamples);
+
+        for (size_t c = 0; c < plan.chainOutputs.size() && c < chains.size(); ++c)
+        {
+            auto slot = plan.chainOutputs[c];
+            if (slot != RoutingPlan::noSlot)
+                tap->write (c + 1, slotChannels[slot * 2], slotChannels[slot * 2 + 1], numSamples);
+        }
+    }
+}
+
+/** Writes the gain-weighted sum of the inputs of a node into its buffer, four inputs per pass */
+void RoutingProcessor::mixInputs (const RoutingPlan& plan, const RoutingPlan::Step& step, size_t channel,
+                                  size_t numVecs) noexcept
+{
+    constexpr size_t inputsPerPass = 4;
+    constexpr auto lanes = Vec::SIMDNumElements;
+    auto* dest = slotChannels[step.slot * 2 + channel];
+
+    if (step.numInputs == 0)
+    {
+        std::fill (dest, dest + numVecs * lanes, 0.0f);
+        return;
+    }
+
+    for (auto first = step.firstInput; first < step.firstInput + step.numInputs; first += inputsPerPass)
+    {
+        auto count = std::min (inputsPerPass, step.firstInput + step.numInputs - first);
+        const float* sources[inputsPerPass]{};
+        Vec gains[inputsPerPass];
+
+        for (size_t k = 0; k < count; ++k)
+        {
+            sources[k] = slotChannels[plan.inputs[first + k].slot * 2 + channel];
+            gains[k] = Vec::expand (plan.inputs[first + k].gain);
+        }
+
+        const bool accumulate = first != step.firstInput;
+
+        for (size_t v = 0; v < numVecs; ++v)
+        {
+            auto offset = v * lanes;
+            auto sum = accumulate ? Vec::fromRawArray (dest + offset) : Vec::expand (0.0f);
+
+            for (size_t k = 0; k < count; ++k)
+                sum += Vec::fromRawArray (sources[k] + offset) * gains[k];
+
+            sum.copyToRawArray (dest + offset);
+        }
+    }
+}
+
+void RoutingProcessor::processStage (const RoutingNode& node, juce::dsp::AudioBlock<float>& block) noexcept
+{
+    auto& chain = *chains[node.index];
+    juce::dsp::ProcessContextReplacing<float> context (block);
+
+    switch (node.stage)
+    {
+    case ProcIdx::OSC: chain.get<ProcIdx::OSC>().process (context); break;
+    case ProcIdx::FILT: chain.get<ProcIdx::FILT>().process (context); break;
+    case ProcIdx::DEL: chain.get<ProcIdx::DEL>().process (context); break;
+    case ProcIdx::REV: chain.get<ProcIdx::REV>().process (context); break;
+    case ProcIdx::CHAN_GAIN: chain.get<ProcIdx::CHAN_GAIN>().process (context); break;
+    case ProcIdx::MASTER_GAIN: chain.get<ProcIdx::MASTER_GAIN>().process (context); break;
+    default: jassertfalse; break;
+    }
+}
+
+// TESTS
+//==============================================================================
+#if JUCE_UNIT_TESTS
+
+class RoutingGraphTests : public juce::UnitTest
+{
+public:
+    RoutingGraphTests() : juce::UnitTest ("RoutingGraph", "OneButtonKiller")
+    {
+    }
+
+    void runTest() override
+    {
+        beginTest ("A graph compiles the same after a round trip through a tree");
+        {
+            auto graph = RoutingGraph::createDefault (3, 2);
+            auto mix = graph.addNode ({RoutingNode::Kind::MIX, ProcIdx::OSC, 0});
+            graph.connect (2, mix, 0.5f);
+
+            auto copy = RoutingGraph::fromValueTree (juce::ValueTree::fromXml (*graph.toValueTree().createXml()));
+            auto plan = graph.compile (RoutingProcessor::maxNumNodes);
+            auto copied = copy.compile (RoutingProcessor::maxNumNodes);
+
+            expect (plan != nullptr && copied != nullptr);
+            expectEquals ((int)copy.getNumNodes(), (int)graph.getNumNodes());
+            expectEquals ((int)copied->steps.size(), (int)plan->steps.size());
+            expectEquals ((int)copied->levels.size(), (int)plan->levels.size());
+
+            for (size_t i = 0; i < plan->inputs.size() && i < copied->inputs.size(); ++i)
+            {
+                expectEquals ((int)copied->inputs[i].slot, (int)plan->inputs[i].slot);
+                expectEquals (copied->inputs[i].gain, plan->inputs[i].gain);
+            }
+        }
+
+        beginTest ("Cycles and broken trees are rejected");
+        {
+            RoutingGraph graph;
+            auto a = graph.addNode ({RoutingNode::Kind::MIX, ProcIdx::OSC, 0});
+            auto b = graph.addNode ({RoutingNode::Kind::MIX, ProcIdx::OSC, 0});
+            graph.connect (a, b);
+            graph.connect (b, a);
+            expect (graph.compile (RoutingProcessor::maxNumNodes) == nullptr);
+
+            auto tree = RoutingGraph::createDefault (1, 1).toValueTree();
+            tree.appendChild (juce::ValueTree (IDs::CONNECTION, {{IDs::source, 0}, {IDs::destination, 99}}), nullptr);
+            expectEquals ((int)RoutingGraph::fromValueTree (tree).getNumNodes(), 0);
+
+            tree = RoutingGraph::createDefault (1, 1).toValueTree();
+            tree.getChild (1).setProperty (IDs::stage, "CHORUS", nullptr);
+            expectEquals ((int)RoutingGraph::fromValueTree (tree).getNumNodes(), 0);
+        }
+
+        beginTest ("Indices out of range and stages used twice are rejected");
+        {
+            // child 0 is the output pair, child 1 the OSC of chain 0
+            auto tree = RoutingGraph::createDefault (1, 1).toValueTree();
+            tree.getChild (1).setProperty (IDs::index, 1 << 30, nullptr);
+            expectEquals ((int)RoutingGraph::fromValueTree (tree).getNumNodes(), 0);
+
+            tree = RoutingGraph::createDefault (1, 1).toValueTree();
+            tree.getChild (0).setProperty (IDs::index, (int)RoutingGraph::maxNumOutputPairs, nullptr);
+            expectEquals ((int)RoutingGraph::fromValueTree (tree).getNumNodes(), 0);
+
+            tree = RoutingGraph::createDefault (1, 1).toValueTree();
+            tree.appendChild (tree.getChild (1).createCopy(), nullptr);
+            expectEquals ((int)RoutingGraph::fromValueTree (tree).getNumNodes(), 0);
+
+            auto graph = RoutingGraph::createDefault (2, 1);
+            graph.addNode ({RoutingNode::Kind::STAGE, ProcIdx::REV, 1});
+            expect (graph.compile (RoutingProcessor::maxNumNodes) == nullptr);
+
+            graph = RoutingGraph::createDefault (2, 1);
+            graph.addNode ({RoutingNode::Kind::STAGE, ProcIdx::OSC, (size_t)MAX_NUM_CHAINS});
+            expect (graph.compile (RoutingProcessor::maxNumNodes) == nullptr);
+        }
+    }
+};
+
+static RoutingGraphTests routingGraphTests;
+
+//==============================================================================
+
+/** How the default routing of many chains scales with the number of WorkerPool threads */
+class RoutingBenchmark : public juce::UnitTest
+{
+public:
+    RoutingBenchmark() : juce::UnitTest ("Routing worker scaling", "Benchmarks")
+    {
+    }
+
+    void runTest() override
+    {
+        auto maxNumWorkers = (size_t)juce::jmax (0, juce::SystemStats::getNumCpus() - 1);
+
+        for (auto numChains : {(size_t)DEFAULT_NUM_CHAINS, (size_t)16, (size_t)MAX_NUM_CHAINS})
+        {
+            beginTest (juce::String (numChains) + " chains");
+            double single = 0;
+
+            // 0 is the audio thread alone, then doubling up to one worker per spare core
+            for (size_t numWorkers = 0; numWorkers <= maxNumWorkers;
+                 numWorkers = juce::jmax ((size_t)1, numWorkers * 2))
+            {
+                auto elapsed = measure (numChains, numWorkers);
+                if (numWorkers == 0)
+                    single = elapsed;
+
+                logMessage (juce::String (numWorkers) + " workers: " + juce::String (elapsed / seconds * 100.0, 2)
+                            + "% of the audio thread, " + juce::String (single / juce::jmax (elapsed, 1e-9), 2)
+                            + "x speedup");
+            }
+
+            expect (single > 0);
+        }
+    }
+
+private:
+    static constexpr double sampleRate = 48000, seconds = 5;
+    static constexpr int blockSize = 256;
+
+    static double measure (size_t numChains, size_t numWorkers)
+    {
+        FilterBank<float> bank (numChains * 2);
+        std::vector<std::unique_ptr<Chain>> chains;
+        std::vector<Chain*> routed;
+        DelayArena<float> arena;
+        size_t arenaSize = 0;
+
+        for (size_t i = 0; i < numChains; ++i)
+        {
+            routed.push_back (chains.emplace_back (std::make_unique<Chain>()).get());
+            arenaSize += routed.back()->get<ProcIdx::DEL>().getArenaSize (sampleRate);
+            arenaSize += routed.back()->get<ProcIdx::REV>().getArenaSize (sampleRate);
+        }
+
+        // every stage busy, the way a random patch leaves a chain
+        juce::dsp::ProcessSpec spec{sampleRate, (juce::uint32)blockSize, 2};
+        arena.allocate (arenaSize);
+        bank.prepare (sampleRate);
+
+        for (size_t i = 0; i < numChains; ++i)
+        {
+            auto& chain = *chains[i];
+            chain.get<ProcIdx::FILT>().attach (bank, i * 2);
+            chain.get<ProcIdx::DEL>().setStorage (arena, sampleRate);
+            chain.get<ProcIdx::REV>().setStorage (arena, sampleRate);
+            chain.prepare (spec);
+
+            chain.get<ProcIdx::OSC>().setBypass (false);
+            chain.get<ProcIdx::FILT>().setEnabled (true);
+            chain.get<ProcIdx::DEL>().setWetLevel (0.5f);
+            chain.get<ProcIdx::REV>().setWetLevel (0.5f);
+        }
+
+        std::unique_ptr<WorkerPool> pool;
+        RoutingProcessor routing (routed, bank);
+        routing.prepare (spec);
+
+        if (numWorkers > 0)
+        {
+            pool = std::make_unique<WorkerPool> (numWorkers);
+            routing.setWorkerPool (pool.get());
+        }
+
+        routing.setPlan (RoutingGraph::createDefault (numChains, 1).compile (RoutingProcessor::maxNumNodes));
+
+        // the first block picks the plan up
+        juce::AudioBuffer<float> output (2, blockSize);
+        routing.process (output, 0, blockSize);
+
+        auto start = juce::Time::getHighResolutionTicks();
+        for (auto b = 0; b < (int)(sampleRate * seconds) / blockSize; ++b)
+            routing.process (output, 0, blockSize);
+
+        return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+    }
+};
+
+static RoutingBenchmark routingBenchmark;
+
+#endif
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "Chain.h"
+#include "Constants.h"
+#include "WorkerPool.h"
+#include <JuceHeader.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/** A node of the routing graph: a stage of a chain, a mixer, or a pair of device outputs */
+struct RoutingNode
+{
+    enum class Kind
+    {
+        STAGE,
+        MIX,
+        OUTPUT
+    };
+
+    Kind kind = Kind::MIX;
+    ProcIdx stage = ProcIdx::OSC; // only for STAGE
+    size_t index = 0;             // the chain of a STAGE, the output pair of an OUTPUT
+};
+
+//==============================================================================
+/** The compiled form of a RoutingGraph.
+
+    The nodes are in topological order, grouped in levels of nodes that don't depend on each
+    other. Every node owns a buffer slot and reads a range of the flat (slot, gain) input list,
+    so running a plan needs no allocation and no lookups.
+*/
+struct RoutingPlan
+{
+    struct Input
+    {
+        size_t slot;
+        float gain;
+    };
+
+    struct Step
+    {
+        RoutingNode node;
+        size_t slot;
+        size_t firstInput, numInputs;
+    };
+
+    struct Level
+    {
+        size_t firstStep, numSteps;
+    };
+
+    std::vector<Input> inputs;
+    std::vector<Step> steps;
+    std::vector<Level> levels;
+
+    // the slot of the last stage of every chain, what the chain puts out. noSlot if it has no stage
+    static constexpr size_t noSlot = ~(size_t)0;
+    std::vector<size_t> chainOutputs;
+};
+
+//==============================================================================
+/** Gets the signal of the outputs and of every chain as it's rendered, on the audio thread */
+class RoutingTap
+{
+public:
+    virtual ~RoutingTap() = default;
+
+    /** Checked once per processed chunk, nothing is written while it's false */
+    virtual bool isActive() const noexcept = 0;
+    /** source is 0 for the mix of all the output pairs, chain + 1 for the last stage of a chain */
+    virtual void write (size_t source, const float* left, const float* right, int numSamples) noexcept = 0;
+};
+
+//==============================================================================
+/** The editable routing, owned by the message thread.
+
+    Any node can feed any other one with a gain, across chains too, as long as it doesn't make
+    a cycle. A node processes the sum of its inputs.
+*/
+class RoutingGraph
+{
+public:
+    using NodeId = size_t;
+
+    void clear();
+    NodeId addNode (const RoutingNode& node);
+    void connect (NodeId source, NodeId destination, float gain = 1.0f);
+    void disconnect (NodeId source, NodeId destination);
+    size_t getNumNodes() const noexcept;
+
+    // OUTPUT nodes past this pair are refused, more than any device has
+    static constexpr size_t maxNumOutputPairs = MAX_NUM_CHAINS;
+
+    /** nullptr if the graph has a cycle, more than maxNumNodes nodes, a stage of a chain past
+        MAX_NUM_CHAINS, an output pair past maxNumOutputPairs or the same stage of a chain twice */
+    std::unique_ptr<RoutingPlan> compile (size_t maxNumNodes) const;
+
+    /** Every chain in series, OSC -> FILT -> DEL -> REV -> CHAN_GAIN -> MASTER_GAIN,
+        with chain i mixed into output pair i % numOutputPairs */
+    static RoutingGraph createDefault (size_t numChains, size_t numOutputPairs);
+
+    /** A ROUTING tree with a NODE child per node (kind, stage, index) and then a CONNECTION child per
+        connection (source, destination, gain), the nodes numbered in the order they come in */
+    juce::ValueTree toValueTree() const;
+    /** An empty graph if anything in the tree doesn't make sense or compile() would refuse a node */
+    static RoutingGraph fromValueTree (const juce::ValueTree& tree);
+
+private:
+    struct Connection
+    {
+        NodeId source, destination;
+        float gain;
+    };
+
+    bool hasValidNodes() const;
+
+    std::vector<RoutingNode> nodes;
+    std::vector<Connection> connections;
+};
+
+//==============================================================================
+/** Runs the current RoutingPlan on the audio thread.
+
+    Plans are compiled on the message thread and handed over with setPlan(). The audio thread
+    swaps the new one in at the start of a block with an atomic exchange and hands the old one
+    back, to be destroyed by the next setPlan() call, so it never allocates or frees anything.
+    The nodes of a level run in parallel when a WorkerPool is set, with a join after each level,
+    and then the filter stages of the level run together, one FilterBank SIMD group per task.
+
+    The node buffers are cache-aligned slices of one arena, so a node sums its inputs on SIMD
+    registers, four inputs per pass over its buffer. That's what mixes many chains down to the
+    device outputs: one OUTPUT node per pair, fed by the chains.
+*/
+class RoutingProcessor
+{
+public:
+    using Vec = juce::dsp::SIMDRegister<float>;
+    static constexpr size_t maxNumNodes = MAX_NUM_CHAINS * 8;
+
+    RoutingProcessor (std::vector<Chain*> chainsToRun, FilterBank<float>& bank);
+    ~RoutingProcessor();
+
+    /** Allocates the buffers of maxNumNodes nodes, whatever the plan */
+    void prepare (const juce::dsp::ProcessSpec& spec);
+    void setWorkerPool (WorkerPool* newPool) noexcept;
+    void setPlan (std::unique_ptr<RoutingPlan> newPlan);
+    /** Before the audio starts, the tap has to outlive this processor */
+    void addTap (RoutingTap* tap);
+    void process (juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) noexcept;
+
+private:
+    std::vector<Chain*> chains;
+    FilterBank<float>& filterBank;
+
+    WorkerPool* workerPool = nullptr;
+
+    DelayArena<float> slotArena;
+    std::vector<float*> slotChannels; // two channels per slot
+    std::array<float*, 2> tapChannels{}; // the output pairs mixed down for the taps
+    std::vector<float*> filterChannels;
+    int maxBlockSize = 0;
+    std::vector<RoutingTap*> taps;
+
+    std::unique_ptr<RoutingPlan> activePlan; // audio thread only
+    std::atomic<RoutingPlan*> pendingPlan{nullptr};
+    std::atomic<RoutingPlan*> retiredPlan{nullptr};
+
+    //==============================================================================
+    template <typename Fn>
+    void forEach (size_t numTasks, Fn&& fn) noexcept;
+    void mixInputs (const RoutingPlan& plan, const RoutingPlan::Step& step, size_t channel, size_t numVecs) noexcept;
+    void processPlan (const RoutingPlan& plan, juce::AudioBuffer<float>& outputBuffer, int startSample,
+                      int numSamples) noexcept;
+    void processStage (const RoutingNode& node, juce::dsp::AudioBlock<float>& block) noexcept;
+    void writeTaps (const RoutingPlan& plan, const juce::AudioBuffer<float>& outputBuffer, int startSample,
+                    int numSamples) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE (RoutingProcessor)
+};
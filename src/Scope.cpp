@@ -0,0 +1,294 @@
+#include "Scope.h"
+
+ScopeAnalyser::ScopeAnalyser() : juce::Thread ("scope analyser")
+{
+    fifo_data.resize ((size_t)fifo.getTotalSize());
+    history.resize (juce::jmax (fft_size, scope.wave_size * 2));
+    fft_data.resize (fft_size * 2);
+}
+
+ScopeAnalyser::~ScopeAnalyser()
+{
+    stopThread (1000);
+}
+
+void ScopeAnalyser::setActive (const bool b)
+{
+    if (b == active.load())
+        return;
+
+    active = b;
+
+    if (b)
+        startThread();
+    else
+        stopThread (1000);
+}
+
+void ScopeAnalyser::setSource (const size_t s)
+{
+    source = s;
+}
+
+const ScopeAnalyser::Frame* ScopeAnalyser::getFrame()
+{
+    if ((ready.load() & new_frame) == 0)
+        return nullptr;
+
+    front = ready.exchange (front) & ~new_frame;
+    return &frames[(size_t)front];
+}
+
+//==============================================================================
+void ScopeAnalyser::prepare (double sampleRate)
+{
+    sample_rate = sampleRate / scope.decimation;
+    sum = 0;
+    num_summed = 0;
+}
+
+bool ScopeAnalyser::isActive() const noexcept
+{
+    return active.load (std::memory_order_relaxed);
+}
+
+void ScopeAnalyser::write (size_t s, const float* left, const float* right, int numSamples) noexcept
+{
+    if (s != source.load (std::memory_order_relaxed))
+        return;
+
+    // when the analyser falls behind, what doesn't fit is dropped
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite ((num_summed + numSamples) / scope.decimation, start1, size1, start2, size2);
+
+    auto written = 0;
+    for (auto i = 0; i < numSamples; ++i)
+    {
+        sum += left[i] + right[i];
+
+        if (++num_summed < scope.decimation)
+            continue;
+
+        auto value = sum / (float)(2 * scope.decimation);
+        sum = 0;
+        num_summed = 0;
+
+        if (written < size1)
+            fifo_data[(size_t)(start1 + written)] = value;
+        else if (written < size1 + size2)
+            fifo_data[(size_t)(start2 + written - size1)] = value;
+
+        ++written;
+    }
+
+    fifo.finishedWrite (juce::jmin (written, size1 + size2));
+}
+
+//==============================================================================
+void ScopeAnalyser::run()
+{
+    while (!threadShouldExit())
+    {
+        wait (1000 / scope.refresh_rate);
+
+        // another source, the samples of the previous one are of no use
+        if (auto s = source.load(); s != analysed_source)
+        {
+            analysed_source = s;
+            fifo.finishedRead (fifo.getNumReady());
+            std::fill (history.begin(), history.end(), 0.0f);
+            continue;
+        }
+
+        if (readFifo() == 0)
+            continue;
+
+        analyse (frames[(size_t)back]);
+        back = ready.exchange (back | new_frame) & ~new_frame;
+    }
+}
+
+/** Moves what the audio thread wrote to the end of the history, returns how many samples that was */
+size_t ScopeAnalyser::readFifo()
+{
+    auto num = (size_t)fifo.getNumReady();
+
+    // more than the history holds, only the newest ones matter
+    if (num > history.size())
+    {
+        fifo.finishedRead ((int)(num - history.size()));
+        num = history.size();
+    }
+
+    std::move (history.begin() + (long)num, history.end(), history.begin());
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead ((int)num, start1, size1, start2, size2);
+
+    auto dest = history.end() - (long)num;
+    dest = std::copy_n (fifo_data.begin() + start1, size1, dest);
+    std::copy_n (fifo_data.begin() + start2, size2, dest);
+    fifo.finishedRead (size1 + size2);
+
+    return num;
+}
+
+void ScopeAnalyser::analyse (Frame& frame) noexcept
+{
+    frame.sampleRate = sample_rate.load();
+
+    // the waveform starts on the last rising zero crossing that leaves a whole one after it,
+    // so a periodic sound stands still
+    auto last = history.size() - scope.wave_size;
+    auto start = last;
+    for (auto i = last; i > last - scope.wave_size && i > 0; --i)
+    {
+        if (history[i - 1] < 0.0f && history[i] >= 0.0f)
+        {
+            start = i;
+            break;
+        }
+    }
+
+    std::copy_n (history.begin() + (long)start, scope.wave_size, frame.wave.begin());
+
+    // the spectrum of the newest fft_size samples
+    std::copy (history.end() - (long)fft_size, history.end(), fft_data.begin());
+    std::fill (fft_data.begin() + (long)fft_size, fft_data.end(), 0.0f);
+    window.multiplyWithWindowingTable (fft_data.data(), fft_size);
+    fft.performFrequencyOnlyForwardTransform (fft_data.data());
+
+    // a full scale sine reads 0 dB, the hann window halves the amplitude
+    for (size_t i = 0; i < frame.spectrum.size(); ++i)
+        frame.spectrum[i] = juce::Decibels::gainToDecibels (fft_data[i] * 4.0f / (float)fft_size, scope.min_db);
+}
+
+//==============================================================================
+ScopeGui::ScopeGui (ScopeAnalyser& scopeAnalyser, size_t numChains) : Panel ("Scope"), analyser (scopeAnalyser)
+{
+    onOff_btn.onClick = [this] { updateActive(); };
+    addAndMakeVisible (onOff_btn);
+
+    source_box.addItem ("Out", 1);
+    for (size_t i = 0; i < numChains; ++i)
+        source_box.addItem ("Ch" + juce::String (i + 1), (int)i + 2);
+
+    source_box.setSelectedId (1, juce::dontSendNotification);
+    source_box.onChange = [this] { analyser.setSource ((size_t)(source_box.getSelectedId() - 1)); };
+    addAndMakeVisible (source_box);
+}
+
+ScopeGui::~ScopeGui()
+{
+    analyser.setActive (false);
+}
+
+void ScopeGui::paint (juce::Graphics& g)
+{
+    Panel::paint (g);
+
+    if (!has_frame)
+        return;
+
+    g.setColour (juce::Colours::lightgreen);
+
+    // the waveform, -1 to 1
+    juce::Path wave;
+    auto dx = (float)wave_area.getWidth() / (float)(frame.wave.size() - 1);
+    for (size_t i = 0; i < frame.wave.size(); ++i)
+    {
+        auto y = juce::jmap (juce::jlimit (-1.0f, 1.0f, frame.wave[i]), 1.0f, -1.0f, (float)wave_area.getY(),
+                             (float)wave_area.getBottom());
+        auto x = (float)wave_area.getX() + (float)i * dx;
+
+        if (i == 0)
+            wave.startNewSubPath (x, y);
+        else
+            wave.lineTo (x, y);
+    }
+
+    g.strokePath (wave, juce::PathStrokeType (1.0f));
+
+    // the spectrum, on a log frequency axis from 20 Hz
+    juce::Path spectrum;
+    auto nyquist = frame.sampleRate / 2;
+    auto binWidth = nyquist / (double)frame.spectrum.size();
+    auto started = false;
+
+    for (size_t i = 1; i < frame.spectrum.size(); ++i)
+    {
+        auto freq = (double)i * binWidth;
+        if (freq < 20)
+            continue;
+
+        auto x = (float)juce::jmap (std::log (freq / 20.0) / std::log (nyquist / 20.0), (double)spectrum_area.getX(),
+                                    (double)spectrum_area.getRight());
+        auto y = juce::jmap (frame.spectrum[i], scope.min_db, 0.0f, (float)spectrum_area.getBottom(),
+                             (float)spectrum_area.getY());
+
+        if (!started)
+            spectrum.startNewSubPath (x, y);
+        else
+            spectrum.lineTo (x, y);
+
+        started = true;
+    }
+
+    g.strokePath (spectrum, juce::PathStrokeType (1.0f));
+}
+
+void ScopeGui::resized()
+{
+    auto pos = getLocalBounds().withTrimmedTop (5).withTrimmedRight (5).getTopRight();
+    onOff_btn.setSize (btn_width, btn_height);
+    onOff_btn.setTopRightPosition (pos.x, pos.y);
+
+    source_box.setSize (70, btn_height);
+    source_box.setTopRightPosition (pos.x - btn_width - 5, pos.y);
+
+    auto bounds = getLocalBounds().withTrimmedTop (38).reduced (10, 5);
+    wave_area = bounds.removeFromLeft (bounds.getWidth() / 2).withTrimmedRight (5);
+    spectrum_area = bounds.withTrimmedLeft (5);
+}
+
+void ScopeGui::visibilityChanged()
+{
+    updateActive();
+}
+
+int ScopeGui::getWidthNeeded()
+{
+    return 72 * 8;
+}
+
+int ScopeGui::getHeightNeeded()
+{
+    return 70 + 60;
+}
+
+/** The analyser only runs while there's something to see */
+void ScopeGui::updateActive()
+{
+    auto on = onOff_btn.getToggleState() && isShowing();
+    analyser.setActive (on);
+
+    if (on)
+    {
+        startTimerHz (scope.refresh_rate);
+        return;
+    }
+
+    stopTimer();
+    has_frame = false;
+    repaint();
+}
+
+void ScopeGui::timerCallback()
+{
+    if (auto* f = analyser.getFrame())
+    {
+        frame = *f;
+        has_frame = true;
+        repaint (wave_area.getUnion (spectrum_area));
+    }
+}
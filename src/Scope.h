@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Constants.h"
+#include "GuiComponents.h"
+#include "Routing.h"
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <vector>
+
+/** Turns one source of the routing (the outputs or a chain) into frames for the scope panel.
+
+    The audio thread averages the source down by scope.decimation and writes it to a wait-free FIFO,
+    nothing else. A background thread reads it, finds a stable start for the waveform and runs a
+    windowed FFT, then publishes the frame through a triple buffer the GUI picks the newest one from.
+    While the panel is off, the audio thread skips the copy and the thread is stopped.
+*/
+class ScopeAnalyser : public RoutingTap, private juce::Thread
+{
+public:
+    static constexpr size_t fft_size = (size_t)1 << scope.fft_order;
+
+    struct Frame
+    {
+        std::array<float, scope.wave_size> wave{};
+        std::array<float, fft_size / 2> spectrum{}; // dB, from 0 to half the sample rate
+        double sampleRate = 0;                      // of the decimated samples
+    };
+
+    ScopeAnalyser();
+    ~ScopeAnalyser() override;
+
+    // message thread
+    void setActive (const bool b);
+    /** 0 for the outputs, chain + 1 for a chain */
+    void setSource (const size_t s);
+    /** The newest frame, nullptr if there's none since the last call. Valid until the next call */
+    const Frame* getFrame();
+
+    // audio thread
+    void prepare (double sampleRate);
+    bool isActive() const noexcept override;
+    void write (size_t s, const float* left, const float* right, int numSamples) noexcept override;
+
+private:
+    std::atomic<bool> active{false};
+    std::atomic<size_t> source{0};
+    std::atomic<double> sample_rate{44100};
+
+    // audio thread, the average carried over between writes
+    float sum = 0;
+    int num_summed = 0;
+
+    juce::AbstractFifo fifo{scope.fifo_size};
+    std::vector<float> fifo_data;
+
+    // analyser thread
+    size_t analysed_source = 0;
+    std::vector<float> history;
+    std::vector<float> fft_data;
+    juce::dsp::FFT fft{scope.fft_order};
+    juce::dsp::WindowingFunction<float> window{fft_size, juce::dsp::WindowingFunction<float>::hann};
+
+    // the analyser fills frames[back], the GUI reads frames[front], ready is the newest finished one
+    static constexpr int new_frame = 4;
+    std::array<Frame, 3> frames;
+    std::atomic<int> ready{1};
+    int back = 0, front = 2;
+
+    void run() override;
+    size_t readFifo();
+    void analyse (Frame& frame) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ScopeAnalyser)
+};
+
+//==============================================================================
+class ScopeGui : public Panel, private juce::Timer
+{
+public:
+    ScopeGui (ScopeAnalyser& scopeAnalyser, size_t numChains);
+    ~ScopeGui() override;
+
+    void paint (juce::Graphics& g) override;
+    void resized() override;
+    void visibilityChanged() override;
+    int getWidthNeeded();
+    int getHeightNeeded();
+
+private:
+    ScopeAnalyser& analyser;
+    ScopeAnalyser::Frame frame;
+    bool has_frame = false;
+
+    juce::ToggleButton onOff_btn;
+    juce::ComboBox source_box;
+    juce::Rectangle<int> wave_area, spectrum_area;
+    int btn_width = 25, btn_height = 20;
+
+    void updateActive();
+    void timerCallback() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ScopeGui)
+};
@@ -0,0 +1,178 @@
+#include "StepPattern.h"
+
+namespace
+{
+bool isSameParam (const StepLock& a, const StepLock& b) noexcept
+{
+    return a.chain == b.chain && a.param == b.param;
+}
+
+bool isBefore (const StepLock& a, const StepLock& b) noexcept
+{
+    return a.chain < b.chain || (a.chain == b.chain && a.param < b.param);
+}
+} // namespace
+
+//==============================================================================
+void StepPattern::setNumSteps (const size_t num)
+{
+    num_steps = juce::jlimit ((size_t)param_limits.pattern_steps_min, max_steps, num);
+}
+
+bool StepPattern::setLock (const size_t step, const StepLock& lock)
+{
+    jassert (step < max_steps && lock.chain < MAX_NUM_CHAINS && lock.param != ParamId::NUM_PARAMS);
+
+    auto first = locks.begin() + step_begin[step];
+    auto last = locks.begin() + step_begin[step + 1];
+
+    auto it = std::lower_bound (first, last, lock, isBefore);
+    if (it != last && isSameParam (*it, lock))
+    {
+        it->value = lock.value;
+        return true;
+    }
+
+    if (num_locks == max_locks)
+        return false;
+
+    // the locks after it move up one
+    std::move_backward (it, locks.begin() + (long)num_locks, locks.begin() + (long)num_locks + 1);
+    *it = lock;
+    ++num_locks;
+
+    for (auto s = step + 1; s < step_begin.size(); ++s)
+        ++step_begin[s];
+
+    return true;
+}
+
+void StepPattern::clearStep (const size_t step)
+{
+    jassert (step < max_steps);
+
+    auto first = locks.begin() + step_begin[step];
+    auto last = locks.begin() + step_begin[step + 1];
+    auto num = (juce::uint16)std::distance (first, last);
+
+    std::move (last, locks.begin() + (long)num_locks, first);
+    num_locks -= num;
+
+    for (auto s = step + 1; s < step_begin.size(); ++s)
+        step_begin[s] -= num;
+}
+
+void StepPattern::clear()
+{
+    num_locks = 0;
+    step_begin.fill (0);
+}
+
+//==============================================================================
+PatternPlayer::PatternPlayer()
+{
+    // the audio thread always has a pattern, an empty one to begin with
+    active_pattern = new StepPattern();
+}
+
+PatternPlayer::~PatternPlayer()
+{
+    delete pending_pattern.exchange (nullptr);
+    delete retired_pattern.exchange (nullptr);
+    delete active_pattern;
+}
+
+void PatternPlayer::setPattern (const StepPattern& pattern)
+{
+    delete retired_pattern.exchange (nullptr);
+    delete pending_pattern.exchange (new StepPattern (pattern));
+}
+
+void PatternPlayer::prepare (double sampleRate)
+{
+    clock.prepare (sampleRate);
+    next_step = 0;
+}
+
+juce::uint32 PatternPlayer::advance (const juce::uint32 numSamples) noexcept
+{
+    // only one pattern is handed back at a time, a newer one waits for the message thread to collect it
+    if (pending_pattern.load() != nullptr && retired_pattern.load() == nullptr)
+    {
+        retired_pattern.store (active_pattern);
+        active_pattern = pending_pattern.exchange (nullptr);
+        next_step %= active_pattern->getNumSteps();
+    }
+
+    auto step_at = clock.advance (numSamples);
+
+    // stopped, the held locks are let go at the top of the block
+    if (!clock.isEnabled())
+    {
+        next_step = 0;
+        releasing = num_held > 0;
+        return releasing ? 0 : numSamples;
+    }
+
+    return step_at;
+}
+
+void PatternPlayer::step (const std::vector<ParamValues>& values, std::vector<ParamCommand>& commands) noexcept
+{
+    commands.clear();
+
+    const StepLock* first = nullptr;
+    const StepLock* last = nullptr;
+
+    if (!releasing)
+    {
+        playing_step.store (next_step, std::memory_order_relaxed);
+        first = active_pattern->begin (next_step);
+        last = active_pattern->end (next_step);
+        next_step = (next_step + 1) % active_pattern->getNumSteps();
+    }
+
+    releasing = false;
+
+    // both lists are sorted by chain and parameter, so one walk over them pairs the held locks with the
+    // ones of this step. The locks of chains the patch doesn't have sort last and are left out
+    last = std::lower_bound (first, last, StepLock{(juce::uint16)values.size(), ParamId{}, 0.0f}, isBefore);
+
+    const auto& prev = held[held_index];
+    auto& next = held[held_index ^ 1];
+    size_t i = 0;
+    size_t num_next = 0;
+
+    while (i < num_held || first != last)
+    {
+        // a held lock this step doesn't lock goes back to its value from before, if it still has the
+        // locked one
+        if (first == last || (i < num_held && isBefore (prev[i].lock, *first)))
+        {
+            const auto& h = prev[i++];
+            if (values[h.lock.chain][h.lock.param] == h.lock.value)
+                commands.push_back ({0, h.lock.chain, h.lock.param, h.base});
+
+            continue;
+        }
+
+        auto current = values[first->chain][first->param];
+        HeldLock h{*first, current};
+
+        // locked on the previous step too, the value from before stays unless something else changed it
+        if (i < num_held && isSameParam (prev[i].lock, *first))
+        {
+            if (current == prev[i].lock.value)
+                h.base = prev[i].base;
+
+            ++i;
+        }
+
+        next[num_next++] = h;
+        commands.push_back ({0, first->chain, first->param, first->value});
+        ++first;
+    }
+
+    held_index ^= 1;
+    num_held = num_next;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Constants.h"
+#include "Parameters.h"
+#include "RandSequencer.h"
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <vector>
+
+/** One parameter of one chain held at a value for one step */
+struct StepLock
+{
+    juce::uint16 chain;
+    ParamId param;
+    float value;
+};
+
+//==============================================================================
+/** A step sequencer pattern where every step can lock any parameter of the schema (p-locks).
+
+    The locks of all the steps are in one flat array sorted by step, step_begin[s] is the first lock
+    of step s, so playing a step is a walk over a contiguous range. Within a step the locks are sorted
+    by chain and parameter. Steps past the current length keep their locks, so shortening a pattern and
+    growing it back doesn't lose anything.
+*/
+class StepPattern
+{
+public:
+    static constexpr size_t max_steps = (size_t)param_limits.pattern_steps_max;
+    static constexpr size_t max_locks = def_params.pattern_locks;
+
+    void setNumSteps (const size_t num);
+    size_t getNumSteps() const noexcept
+    {
+        return num_steps;
+    }
+
+    /** Replaces the lock of the same parameter on that step, false if the pattern is full */
+    bool setLock (const size_t step, const StepLock& lock);
+    void clearStep (const size_t step);
+    void clear();
+
+    const StepLock* begin (const size_t step) const noexcept
+    {
+        return locks.data() + step_begin[step];
+    }
+
+    const StepLock* end (const size_t step) const noexcept
+    {
+        return locks.data() + step_begin[step + 1];
+    }
+
+private:
+    size_t num_steps = (size_t)def_params.pattern_steps;
+    size_t num_locks = 0;
+    std::array<StepLock, max_locks> locks;
+    std::array<juce::uint16, max_steps + 1> step_begin{};
+};
+
+//==============================================================================
+/** Plays a StepPattern on the audio thread.
+
+    The message thread edits its own copy and hands a new one over with setPattern(), swapped in at
+    the top of a block like a patch. A locked parameter goes back to the value it had before the lock
+    on the first step that doesn't lock it, unless something else changed it in the meantime.
+*/
+class PatternPlayer
+{
+public:
+    PatternPlayer();
+    ~PatternPlayer();
+
+    StepClock clock{(int)def_params.pattern_time};
+
+    // message thread
+    void setPattern (const StepPattern& pattern);
+    /** The step the audio thread played last */
+    size_t getPlayingStep() const noexcept
+    {
+        return playing_step.load (std::memory_order_relaxed);
+    }
+
+    // audio thread
+    void prepare (double sampleRate);
+    /** Returns the offset of the next step in this block, or numSamples if there's none */
+    juce::uint32 advance (const juce::uint32 numSamples) noexcept;
+    /** Moves to the next step. The locks that end and the ones that start are written to commands,
+        which has to have room for 2 * StepPattern::max_locks of them */
+    void step (const std::vector<ParamValues>& values, std::vector<ParamCommand>& commands) noexcept;
+
+private:
+    std::atomic<StepPattern*> pending_pattern{nullptr};
+    std::atomic<StepPattern*> retired_pattern{nullptr};
+    StepPattern* active_pattern = nullptr;
+
+    // the locks in effect, with what they replaced, sorted by chain and parameter like a step.
+    // Every step builds the next list in the other buffer
+    struct HeldLock
+    {
+        StepLock lock;
+        float base;
+    };
+
+    std::array<std::array<HeldLock, StepPattern::max_locks>, 2> held;
+    size_t held_index = 0;
+    size_t num_held = 0;
+    size_t next_step = 0;
+    bool releasing = false;
+    std::atomic<size_t> playing_step{0};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PatternPlayer)
+};
@@ -21,56 +21,177 @@ void Broadcaster::valueTreePropertyChanged (juce::ValueTree& v, const juce::Iden
 }
 
 //==============================================================================
-undoMan::undoMan()
+ParamListener::ParamListener (const juce::ValueTree& moduleNode, Callback callback)
+    : node (moduleNode), onParamChanged (std::move (callback))
+{
+    for (const auto& spec : param_specs)
+        if (getModuleId (spec.module) == node.getType())
+            params[getPropertyId (spec.id).getCharPointer().getAddress()] = spec.id;
+
+    node.addListener (this);
+}
+
+ParamListener::~ParamListener()
+{
+    node.removeListener (this);
+}
+
+void ParamListener::valueTreePropertyChanged (juce::ValueTree& v, const juce::Identifier& p)
+{
+    auto found = params.find (p.getCharPointer().getAddress());
+    if (found == params.end())
+        return;
+
+    auto param = found->second;
+
+    // the master is a property of the module node, the rest are properties of its chains
+    if (!isPerChain (param))
+    {
+        if (v == node)
+            onParamChanged (0, param, v[p]);
+        return;
+    }
+
+    if (v.getParent() == node)
+        onParamChanged ((size_t)node.indexOf (v), param, v[p]);
+}
+
+//==============================================================================
+undoMan::undoMan (size_t maxSteps, size_t maxDeltas)
+    : deltas (juce::jmax (maxDeltas, (size_t)1)), steps (juce::jmax (maxSteps, (size_t)1))
 {
     startTimer (500);
 }
 
-juce::UndoManager& undoMan::getManagerRef()
+void undoMan::beginNewTransaction()
 {
-    return um;
+    open = false;
 }
 
-juce::UndoManager* undoMan::getManagerPtr()
+void undoMan::record (size_t chain, ParamId param, float before, float after)
 {
-    return &um;
+    // a new change drops what was undone
+    if (cursor != steps_end)
+    {
+        steps_end = cursor;
+        deltas_end = steps_end != steps_begin ? getStep (steps_end - 1).first + getStep (steps_end - 1).size
+                                              : deltas_begin;
+        open = false;
+    }
+
+    if (!open)
+    {
+        if (steps_end - steps_begin == steps.size())
+        {
+            ++steps_begin;
+            deltas_begin = steps_begin != steps_end ? getStep (steps_begin).first : deltas_end;
+        }
+
+        getStep (steps_end++) = {deltas_end, 0};
+        cursor = steps_end;
+        open = true;
+    }
+
+    auto& step = getStep (steps_end - 1);
+
+    if (step.size > 0)
+    {
+        auto& last = getDelta (deltas_end - 1);
+        if (last.chain == chain && last.param == param)
+        {
+            last.after = after;
+            return;
+        }
+    }
+
+    // make room by dropping the oldest steps, never the current one
+    while (deltas_end - deltas_begin == deltas.size() && steps_end - steps_begin > 1)
+        deltas_begin = getStep (++steps_begin).first;
+
+    if (deltas_end - deltas_begin == deltas.size())
+    {
+        jassertfalse; // a single step bigger than the whole ring
+        return;
+    }
+
+    getDelta (deltas_end++) = {static_cast<juce::uint16> (chain), param, before, after};
+    ++step.size;
 }
 
-void undoMan::undo()
+bool undoMan::undo (const Restore& restore)
 {
-    um.undo();
+    if (cursor == steps_begin)
+        return false;
+
+    open = false;
+    const auto& step = getStep (--cursor);
+
+    for (auto i = step.size; i > 0; --i)
+    {
+        const auto& d = getDelta (step.first + i - 1);
+        restore (d.chain, d.param, d.before);
+    }
+
+    return true;
 }
 
-void undoMan::redo()
+bool undoMan::redo (const Restore& restore)
 {
-    um.redo();
+    if (cursor == steps_end)
+        return false;
+
+    open = false;
+    const auto& step = getStep (cursor++);
+
+    for (size_t i = 0; i < step.size; ++i)
+    {
+        const auto& d = getDelta (step.first + i);
+        restore (d.chain, d.param, d.after);
+    }
+
+    return true;
+}
+
+undoMan::Step& undoMan::getStep (size_t index)
+{
+    return steps[index % steps.size()];
+}
+
+undoMan::Delta& undoMan::getDelta (size_t index)
+{
+    return deltas[index % deltas.size()];
 }
 
 void undoMan::timerCallback()
 {
-    um.beginNewTransaction();
+    beginNewTransaction();
 }
 
 // clang-format off
 //==============================================================================
-juce::ValueTree createSelectorsTree()
+juce::ValueTree createSelectorsTree (size_t numChains)
 {
     juce::ValueTree oscs{IDs::OSC_GUI, {}};
     juce::ValueTree lfos{IDs::LFO_GUI, {}};
     juce::ValueTree filts{IDs::FILT_GUI, {}};
     juce::ValueTree dels{IDs::DELAY_GUI, {}};
+    juce::ValueTree revs{IDs::REVERB_GUI, {}};
 
-    for (size_t i = 0; i < NUM_OUTPUT_CHANNELS / 4; ++i)
+    for (size_t i = 0; i < NUM_CHAIN_PANELS; ++i)
     {
-        juce::ValueTree osc{IDs::Group::OSC[i], {{IDs::selector, param_limits.selector[i]}}};
-        juce::ValueTree lfo{IDs::Group::LFO[i], {{IDs::selector, param_limits.selector[i]}}};
-        juce::ValueTree filt{IDs::Group::FILT[i], {{IDs::selector, param_limits.selector[i]}}};
-        juce::ValueTree del{IDs::Group::DELAY[i], {{IDs::selector, param_limits.selector[i]}}};
+        auto selector = juce::jmin (param_limits.selector[i], (int)numChains);
+
+        juce::ValueTree osc{IDs::Group::OSC[i], {{IDs::selector, selector}}};
+        juce::ValueTree lfo{IDs::Group::LFO[i], {{IDs::selector, selector}}};
+        juce::ValueTree filt{IDs::Group::FILT[i], {{IDs::selector, selector}}};
+        juce::ValueTree del{IDs::Group::DELAY[i], {{IDs::selector, selector}}};
+        juce::ValueTree rev{IDs::Group::REVERB[i], {{IDs::selector, selector}}};
 
         oscs.addChild (osc, -1, nullptr);
         lfos.addChild (lfo, -1, nullptr);
         filts.addChild (filt, -1, nullptr);
         dels.addChild (del, -1, nullptr);
+        revs.addChild (rev, -1, nullptr);
     }
 
     juce::ValueTree root (IDs::ROOT);
@@ -78,69 +199,107 @@ juce::ValueTree createSelectorsTree()
     root.addChild (lfos, -1, nullptr);
     root.addChild (filts, -1, nullptr);
     root.addChild (dels, -1, nullptr);
+    root.addChild (revs, -1, nullptr);
 
     return root;
 }
 
-juce::ValueTree createDefaultTree()
+juce::ValueTree createDefaultTree (size_t numChains)
 {
-    juce::ValueTree outputs{IDs::OUTPUT_GAIN, {{IDs::master, def_params.master_gain}}};
-    juce::ValueTree oscs{IDs::OSC, {}};
-    juce::ValueTree lfos{IDs::LFO, {}};
-    juce::ValueTree filts{IDs::FILT, {}};
-    juce::ValueTree dels{IDs::DELAY, {}};
+    std::array<juce::ValueTree, (size_t)Module::NUM_MODULES> modules;
 
-    for (size_t i = 0; i < NUM_OUTPUT_CHANNELS / 2; ++i)
+    for (size_t m = 0; m < modules.size(); ++m)
     {
-        juce::ValueTree chan{IDs::Group::CHAN[i], {{IDs::gain, def_params.chan_gain}}};
-
-        juce::ValueTree osc{IDs::Group::OSC[i],
-                            {{IDs::waveType, def_params.osc_wavetype},
-                             {IDs::freq, def_params.osc_freq + i*10},
-                             {IDs::gain, def_params.osc_gain},
-                             {IDs::fm_freq, def_params.osc_fm_freq},
-                             {IDs::fm_depth, def_params.osc_fm_depth},
-                             {IDs::pan, def_params.osc_pan}}};
-
-        juce::ValueTree lfo{IDs::Group::LFO[i],
-                            {{IDs::waveType, def_params.lfo_wavetype},
-                             {IDs::freq, def_params.lfo_freq},
-                             {IDs::gain, def_params.lfo_gain},
-                             {IDs::route, (int)i + 2}}};
-
-        juce::ValueTree filt{IDs::Group::FILT[i],
-                            {{IDs::filtType, def_params.filt_type},
-                             {IDs::enabled, false},
-                             {IDs::cutOff, def_params.filt_cutoff},
-                             {IDs::reso, def_params.filt_reso},
-                             {IDs::drive, def_params.filt_drive}}};
-
-
-        juce::ValueTree del{IDs::Group::DELAY[i],
-                            {{IDs::mix, def_params.del_mix},
-                             {IDs::time, def_params.del_time},
-                             {IDs::feedback, def_params.del_feedback}}};
-
-        outputs.addChild (chan, -1, nullptr);
-        oscs.addChild (osc, -1, nullptr);
-        lfos.addChild (lfo, -1, nullptr);
-        filts.addChild (filt, -1, nullptr);
-        dels.addChild (del, -1, nullptr);
+        auto module = static_cast<Module> (m);
+        // the master and the channels share the OUTPUT_GAIN node
+        if (m > 0 && getModuleId (module) == getModuleId (static_cast<Module> (m - 1)))
+            modules[m] = modules[m - 1];
+        else
+            modules[m] = juce::ValueTree (getModuleId (module));
+
+        if (module_specs[m].group != nullptr)
+            for (size_t i = 0; i < numChains; ++i)
+                modules[m].addChild (juce::ValueTree (getModuleChildId (module, i)), -1, nullptr);
+    }
+
+    for (const auto& spec : param_specs)
+    {
+        auto& node = modules[(size_t)spec.module];
+
+        if (module_specs[(size_t)spec.module].group == nullptr)
+        {
+            node.setProperty (getPropertyId (spec.id), toVar (spec.id, getDefaultValue (spec.id, 0)), nullptr);
+            continue;
+        }
+
+        for (size_t i = 0; i < numChains; ++i)
+            node.getChild ((int)i).setProperty (getPropertyId (spec.id), toVar (spec.id, getDefaultValue (spec.id, i)),
+                                                nullptr);
     }
 
     juce::ValueTree seqs{IDs::SEQUENCER, {}};
     juce::ValueTree seq{IDs::SEQ1, {{IDs::enabled, false}, {IDs::time, def_params.seq_time}}};
     seqs.addChild (seq, -1, nullptr);
 
+    juce::ValueTree morph{IDs::MORPH, {{IDs::position, 0.0}, {IDs::time, def_params.morph_time}}};
+    juce::ValueTree pattern{IDs::PATTERN,
+                            {{IDs::enabled, false},
+                             {IDs::rec, false},
+                             {IDs::steps, def_params.pattern_steps},
+                             {IDs::time, def_params.pattern_time}}};
+
     juce::ValueTree root (IDs::ROOT);
-    root.addChild (outputs, -1, nullptr);
+    root.addChild (modules[(size_t)Module::MASTER], -1, nullptr);
     root.addChild (seqs, -1, nullptr);
-    root.addChild (oscs, -1, nullptr);
-    root.addChild (lfos, -1, nullptr);
-    root.addChild (filts, -1, nullptr);
-    root.addChild (dels, -1, nullptr);
+    root.addChild (morph, -1, nullptr);
+    root.addChild (pattern, -1, nullptr);
+
+    for (size_t m = 0; m < modules.size(); ++m)
+        if (!modules[m].getParent().isValid())
+            root.addChild (modules[m], -1, nullptr);
 
     return root;
 }
 
 // clang-format on
+
+//==============================================================================
+juce::File getUserFolder()
+{
+    return juce::File::getSpecialLocation (juce::File::userMusicDirectory).getChildFile ("OneButtonKiller");
+}
+
+bool savePatch (const juce::ValueTree& state, const juce::File& file)
+{
+    auto xml = state.createXml();
+    return xml != nullptr && file.getParentDirectory().createDirectory() && xml->writeTo (file);
+}
+
+juce::ValueTree loadPatch (const juce::File& file)
+{
+    auto xml = juce::parseXML (file);
+    if (xml == nullptr || !xml->hasTagName (IDs::ROOT.toString()))
+        return {};
+
+    return juce::ValueTree::fromXml (*xml);
+}
+
+Patch readPatch (const juce::ValueTree& state)
+{
+    Patch patch;
+    patch.numChains = juce::jmin ((size_t)state.getChildWithName (IDs::OSC).getNumChildren(), (size_t)MAX_NUM_CHAINS);
+
+    for (const auto& spec : param_specs)
+    {
+        auto node = state.getChildWithName (getModuleId (spec.module));
+
+        for (size_t c = 0; c < patch.numChains; ++c)
+        {
+            auto child = isPerChain (spec.id) ? node.getChildWithName (getModuleChildId (spec.module, c)) : node;
+            auto def = getDefaultValue (spec.id, c);
+            patch.chains[c][spec.id] = (float)(double)child.getProperty (getPropertyId (spec.id), def);
+        }
+    }
+
+    return patch;
+}
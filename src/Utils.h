@@ -1,8 +1,10 @@
 #pragma once
 
 #include "Constants.h"
+#include "Parameters.h"
 #include <JuceHeader.h>
-#include <random>
+#include <functional>
+#include <unordered_map>
 
 //==============================================================================
 template <typename Base, typename T>
@@ -39,82 +41,93 @@ private:
 };
 
 //==============================================================================
-class undoMan : private juce::Timer
+/** Listens to one module node of the state (OSC, LFO, ...) and every chain under it.
+
+    A property change is looked up by its identifier, checked against the level it belongs to
+    (the module node itself or one of its chains) and forwarded synchronously as (chain, ParamId, value).
+*/
+class ParamListener : private juce::ValueTree::Listener
 {
 public:
-    undoMan();
-    juce::UndoManager& getManagerRef();
-    juce::UndoManager* getManagerPtr();
-    void undo();
-    void redo();
+    using Callback = std::function<void (size_t chain, ParamId param, const juce::var& value)>;
+
+    ParamListener (const juce::ValueTree& moduleNode, Callback callback);
+    ~ParamListener() override;
 
 private:
-    juce::UndoManager um;
-    void timerCallback() override;
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (undoMan)
+    juce::ValueTree node;
+    Callback onParamChanged;
+    // the identifiers are pooled, so the address of their string is enough to tell them apart
+    std::unordered_map<const void*, ParamId> params;
+
+    void valueTreePropertyChanged (juce::ValueTree& v, const juce::Identifier& p) override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParamListener)
 };
 
 //==============================================================================
-struct RAND_HELPER
+/** Undo history of the parameters, kept as (chain, param, before, after) deltas.
+
+    A step is one randomization, or the gesture recorded since the last step was closed (by the timer,
+    as juce::UndoManager transactions used to be). Repeated changes of the same parameter in a row are
+    merged, so a slider drag is one delta. The steps and the deltas live in two rings allocated up front:
+    when either is full the oldest steps are dropped, so the memory doesn't grow with the session.
+*/
+class undoMan : private juce::Timer
 {
-    std::mt19937& gen;
-
-    std::uniform_real_distribution<> p100;
-    std::uniform_real_distribution<> p50;
-    std::uniform_real_distribution<> p33;
-    std::uniform_real_distribution<> p25;
-    std::uniform_real_distribution<> p10;
-    std::uniform_real_distribution<> p5;
-    std::uniform_real_distribution<> p1;
-    std::uniform_real_distribution<> p;
-
-    RAND_HELPER (std::mt19937& _gen) : gen (_gen)
-    {
-        p100 = std::uniform_real_distribution<> (0, 100);
-        p50 = std::uniform_real_distribution<> (0, 50);
-        p33 = std::uniform_real_distribution<> (0, 33);
-        p25 = std::uniform_real_distribution<> (0, 25);
-        p10 = std::uniform_real_distribution<> (0, 10);
-        p5 = std::uniform_real_distribution<> (0, 5);
-        p1 = std::uniform_real_distribution<> (0, 1);
-        p = p33;
-    }
-
-    double getVal (const double val)
+public:
+    using Restore = std::function<void (size_t chain, ParamId param, float value)>;
+
+    undoMan (size_t maxSteps = def_params.undo_steps, size_t maxDeltas = def_params.undo_deltas);
+
+    /** Closes the current step, the next record starts a new one */
+    void beginNewTransaction();
+    void record (size_t chain, ParamId param, float before, float after);
+
+    /** Hand the values of one step to restore, false if there's nothing to undo / redo */
+    bool undo (const Restore& restore);
+    bool redo (const Restore& restore);
+
+private:
+    struct Delta
     {
-        // return a value with range [0, val]
-        return percentageFrom (val, p100 (gen));
-    }
+        juce::uint16 chain;
+        ParamId param;
+        float before, after;
+    };
 
-    double getSup (const double val, const int per)
+    struct Step
     {
-        // reurn a suppressed value with range [0, val * max(p(gen)) / 100]
-        switch (per)
-        {
-        case 1:
-            p = p1;
-            break;
-        case 5:
-            p = p5;
-            break;
-        case 10:
-            p = p10;
-            break;
-        case 25:
-            p = p25;
-            break;
-        case 33:
-            p = p33;
-            break;
-        case 50:
-            p = p50;
-            break;
-        }
-
-        return percentageFrom (val, p (gen));
-    }
+        size_t first; // of its deltas, as a running index
+        size_t size;
+    };
+
+    // running indexes, wrapped into the rings on access
+    std::vector<Delta> deltas;
+    size_t deltas_begin = 0, deltas_end = 0;
+    std::vector<Step> steps;
+    size_t steps_begin = 0, steps_end = 0;
+    // the steps before it are done, the ones from it on were undone
+    size_t cursor = 0;
+    bool open = false;
+
+    Step& getStep (size_t index);
+    Delta& getDelta (size_t index);
+    void timerCallback() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (undoMan)
 };
 
 //==============================================================================
-juce::ValueTree createDefaultTree();
-juce::ValueTree createSelectorsTree();
+juce::ValueTree createDefaultTree (size_t numChains = DEFAULT_NUM_CHAINS);
+juce::ValueTree createSelectorsTree (size_t numChains = DEFAULT_NUM_CHAINS);
+
+/** OneButtonKiller in the music folder of the user, where the recordings and the saved patches go */
+juce::File getUserFolder();
+
+/** A saved patch is the whole state tree as XML */
+bool savePatch (const juce::ValueTree& state, const juce::File& file);
+/** An invalid tree if file isn't a saved patch */
+juce::ValueTree loadPatch (const juce::File& file);
+/** Every parameter of every chain of a state tree, the ones it's missing at their defaults */
+Patch readPatch (const juce::ValueTree& state);
@@ -0,0 +1,189 @@
+#include "WorkerPool.h"
+
+#if JUCE_INTEL
+#include <immintrin.h>
+#endif
+
+namespace
+{
+void spinPause() noexcept
+{
+#if JUCE_INTEL
+    _mm_pause();
+#elif JUCE_ARM
+    __asm__ __volatile__("yield");
+#endif
+}
+
+constexpr juce::uint64 pack (juce::uint32 gen, size_t next, size_t end) noexcept
+{
+    return ((juce::uint64)(gen & 0xffff) << 48) | ((juce::uint64)next << 24) | (juce::uint64)end;
+}
+
+constexpr juce::uint32 genOf (juce::uint64 state) noexcept { return (juce::uint32)(state >> 48); }
+constexpr size_t nextOf (juce::uint64 state) noexcept { return (size_t)((state >> 24) & 0xffffff); }
+constexpr size_t endOf (juce::uint64 state) noexcept { return (size_t)(state & 0xffffff); }
+} // namespace
+
+//==============================================================================
+class WorkerPool::Worker : public juce::Thread
+{
+public:
+    Worker (WorkerPool& owner, size_t queueIndex)
+        : juce::Thread ("audio worker " + juce::String (queueIndex)), pool (owner), queue (queueIndex)
+    {
+    }
+
+    /** Called by run() after a new batch is published, on the audio thread. Only a sleeping worker is
+        signalled, and WaitableEvent::signal() takes a mutex, so the spin in run() is what keeps that off
+        the audio thread while blocks come in quick succession */
+    void wake() noexcept
+    {
+        if (sleeping.exchange (false))
+            wakeEvent.signal();
+    }
+
+    void stop()
+    {
+        signalThreadShouldExit();
+        wakeEvent.signal();
+        stopThread (1000);
+    }
+
+    void run() override
+    {
+        // worker n goes on core n, wrapping around cores 1 and up. The workers only stay off core 0, the
+        // audio thread isn't pinned and the OS is free to run it anywhere
+        auto numCores = juce::jmin (juce::SystemStats::getNumCpus(), 32);
+        if (numCores > 1)
+            juce::Thread::setCurrentThreadAffinityMask (1u << (juce::uint32)(1 + ((int)queue - 1) % (numCores - 1)));
+
+        constexpr int spinIterations = 20000;
+        auto seen = pool.generation.load();
+
+        while (!threadShouldExit())
+        {
+            // a worker that is still spinning when the next batch comes needs no wake(), whose signal()
+            // would lock a mutex on the audio thread
+            for (int i = 0; i < spinIterations && pool.generation.load (std::memory_order_acquire) == seen; ++i)
+                spinPause();
+
+            auto gen = pool.generation.load (std::memory_order_acquire);
+
+            if (gen == seen)
+            {
+                // publish that we're about to sleep, then check once more so a batch can't slip in between
+                sleeping.store (true);
+
+                if (pool.generation.load() == seen && !threadShouldExit())
+                    wakeEvent.wait (-1);
+
+                sleeping.store (false);
+                continue;
+            }
+
+            seen = gen;
+            pool.runTasks (queue, gen);
+        }
+    }
+
+private:
+    WorkerPool& pool;
+    const size_t queue;
+    std::atomic<bool> sleeping{false};
+    juce::WaitableEvent wakeEvent;
+};
+
+//==============================================================================
+WorkerPool::WorkerPool (size_t numWorkers) : queues (new Queue[numWorkers + 1]), numQueues (numWorkers + 1)
+{
+    for (size_t w = 0; w < numWorkers; ++w)
+        workers.push_back (std::make_unique<Worker> (*this, w + 1));
+
+    for (auto& w : workers)
+        w->startRealtimeThread (juce::Thread::RealtimeOptions{});
+}
+
+WorkerPool::~WorkerPool()
+{
+    for (auto& w : workers)
+        w->stop();
+}
+
+size_t WorkerPool::getNumWorkers() const noexcept
+{
+    return workers.size();
+}
+
+/** Called from the audio thread, which works on the first range and then waits for the others */
+void WorkerPool::run (size_t numTasks, TaskFunction function, void* context) noexcept
+{
+    jassert (numTasks <= maxNumTasks);
+    numTasks = juce::jmin (numTasks, maxNumTasks);
+
+    if (numTasks == 0)
+        return;
+
+    if (workers.empty() || numTasks == 1)
+    {
+        for (size_t t = 0; t < numTasks; ++t)
+            function (context, t);
+        return;
+    }
+
+    auto gen = (generation.load() + 1) & 0xffff;
+
+    taskFunction.store (function);
+    taskContext.store (context);
+    remaining.store (numTasks);
+
+    for (size_t q = 0; q < numQueues; ++q)
+        queues[q].state.store (pack (gen, numTasks * q / numQueues, numTasks * (q + 1) / numQueues),
+                               std::memory_order_release);
+
+    generation.store (gen, std::memory_order_release);
+
+    for (auto& w : workers)
+        w->wake();
+
+    runTasks (0, gen);
+
+    // join barrier, the tasks left are already running on other threads
+    while (remaining.load (std::memory_order_acquire) != 0)
+        spinPause();
+}
+
+//==============================================================================
+bool WorkerPool::pop (size_t queue, juce::uint32 gen, size_t& task) noexcept
+{
+    auto& state = queues[queue].state;
+    auto current = state.load (std::memory_order_acquire);
+
+    while (genOf (current) == gen && nextOf (current) < endOf (current))
+    {
+        if (state.compare_exchange_weak (current, current + (juce::uint64 (1) << 24), std::memory_order_acq_rel))
+        {
+            task = nextOf (current);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WorkerPool::runTasks (size_t queue, juce::uint32 gen) noexcept
+{
+    size_t task = 0;
+
+    // own range first, then steal from the others
+    for (size_t k = 0; k < numQueues; ++k)
+    {
+        auto q = (queue + k) % numQueues;
+
+        while (pop (q, gen, task))
+        {
+            taskFunction.load() (taskContext.load(), task);
+            remaining.fetch_sub (1, std::memory_order_acq_rel);
+        }
+    }
+}
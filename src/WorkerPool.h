@@ -0,0 +1,62 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/** Real-time worker threads that run batches of tasks inside the audio callback.
+
+    run() splits the tasks in one range per thread, the calling thread included. A thread pops
+    from its own range and steals from the others once it's empty, all with compare-and-swap,
+    and run() returns once every task is done. Workers are pinned to a core each and spin for a
+    while after a batch before going to sleep, so back to back batches are handed over without
+    a wake-up.
+*/
+class WorkerPool
+{
+public:
+    using TaskFunction = void (*) (void* context, size_t task);
+
+    explicit WorkerPool (size_t numWorkers);
+    ~WorkerPool();
+
+    size_t getNumWorkers() const noexcept;
+
+    /** Calls fn (task) for every task in [0, numTasks), doesn't allocate */
+    template <typename Fn>
+    void run (size_t numTasks, Fn& fn) noexcept
+    {
+        run (numTasks, [] (void* context, size_t task) { (*static_cast<Fn*> (context)) (task); }, &fn);
+    }
+
+    void run (size_t numTasks, TaskFunction function, void* context) noexcept;
+
+private:
+    //==============================================================================
+    class Worker;
+
+    // a range of tasks packed as generation (16 bits) | next (24 bits) | end (24 bits),
+    // so a thread still busy with the previous batch can never pop from the new one
+    struct alignas (64) Queue
+    {
+        std::atomic<juce::uint64> state{0};
+    };
+
+    static constexpr size_t maxNumTasks = (1 << 24) - 1;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::unique_ptr<Queue[]> queues;
+    size_t numQueues = 1;
+
+    std::atomic<juce::uint32> generation{0};
+    std::atomic<size_t> remaining{0};
+    std::atomic<TaskFunction> taskFunction{nullptr};
+    std::atomic<void*> taskContext{nullptr};
+
+    //==============================================================================
+    bool pop (size_t queue, juce::uint32 gen, size_t& task) noexcept;
+    void runTasks (size_t queue, juce::uint32 gen) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE (WorkerPool)
+};